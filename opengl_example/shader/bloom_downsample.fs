@@ -0,0 +1,52 @@
+#version 330 core
+out vec3 fragColor;
+in vec2 texCoord;
+
+// the next larger level of the bloom chain, or the hdr frame
+uniform sampler2D tex;
+
+#ifdef KARIS_AVERAGE
+float KarisWeight(vec3 c) {
+    return 1.0 / (1.0 + dot(c, vec3(0.2126, 0.7152, 0.0722)));
+}
+#endif
+
+// 13 bilinear taps: the center 4x4 texel box plus four overlapping
+// corner boxes, weighted 0.5 and 0.125 each
+void main() {
+    vec2 t = 1.0 / vec2(textureSize(tex, 0));
+    vec3 a = texture(tex, texCoord + t * vec2(-2.0, 2.0)).rgb;
+    vec3 b = texture(tex, texCoord + t * vec2(0.0, 2.0)).rgb;
+    vec3 c = texture(tex, texCoord + t * vec2(2.0, 2.0)).rgb;
+    vec3 d = texture(tex, texCoord + t * vec2(-2.0, 0.0)).rgb;
+    vec3 e = texture(tex, texCoord).rgb;
+    vec3 f = texture(tex, texCoord + t * vec2(2.0, 0.0)).rgb;
+    vec3 g = texture(tex, texCoord + t * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(tex, texCoord + t * vec2(0.0, -2.0)).rgb;
+    vec3 i = texture(tex, texCoord + t * vec2(2.0, -2.0)).rgb;
+    vec3 j = texture(tex, texCoord + t * vec2(-1.0, 1.0)).rgb;
+    vec3 k = texture(tex, texCoord + t * vec2(1.0, 1.0)).rgb;
+    vec3 l = texture(tex, texCoord + t * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(tex, texCoord + t * vec2(1.0, -1.0)).rgb;
+
+#ifdef KARIS_AVERAGE
+    // the first level weights every box by its inverse luminance, single
+    // bright pixels would flicker through the whole chain otherwise
+    vec3 boxes[5] = vec3[](
+        (j + k + l + m) * 0.25,
+        (a + b + d + e) * 0.25, (b + c + e + f) * 0.25,
+        (d + e + g + h) * 0.25, (e + f + h + i) * 0.25);
+    float weights[5] = float[](0.5, 0.125, 0.125, 0.125, 0.125);
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int n = 0; n < 5; n++) {
+        float weight = weights[n] * KarisWeight(boxes[n]);
+        sum += boxes[n] * weight;
+        weightSum += weight;
+    }
+    fragColor = sum / weightSum;
+#else
+    fragColor = e * 0.125 + (a + c + g + i) * 0.03125 +
+        (b + d + f + h) * 0.0625 + (j + k + l + m) * 0.125;
+#endif
+}
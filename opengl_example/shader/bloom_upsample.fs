@@ -0,0 +1,24 @@
+#version 330 core
+out vec3 fragColor;
+in vec2 texCoord;
+
+// the next smaller level, blended additively onto this one
+uniform sampler2D tex;
+// tent radius in uv, the same for every level so the bloom stays round
+uniform float filterRadius;
+
+// 9 tap 3x3 tent
+void main() {
+    float x = filterRadius;
+    float y = filterRadius * float(textureSize(tex, 0).x) / float(textureSize(tex, 0).y);
+    vec3 result = texture(tex, texCoord).rgb * 4.0;
+    result += (texture(tex, texCoord + vec2(-x, 0.0)).rgb +
+        texture(tex, texCoord + vec2(x, 0.0)).rgb +
+        texture(tex, texCoord + vec2(0.0, -y)).rgb +
+        texture(tex, texCoord + vec2(0.0, y)).rgb) * 2.0;
+    result += texture(tex, texCoord + vec2(-x, -y)).rgb +
+        texture(tex, texCoord + vec2(x, -y)).rgb +
+        texture(tex, texCoord + vec2(-x, y)).rgb +
+        texture(tex, texCoord + vec2(x, y)).rgb;
+    fragColor = result / 16.0;
+}
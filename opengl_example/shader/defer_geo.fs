@@ -1,12 +1,28 @@
 #version 330 core
 
-layout (location = 0) out vec4 gPosition;
-layout (location = 1) out vec4 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
+#include "gbuffer.glsl"
+
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+// screen uv this frame minus screen uv last frame
+layout (location = 2) out vec2 gVelocity;
+#ifdef LIGHTMAP
+// ambient irradiance / pi, lighting only scales it by albedo
+layout (location = 3) out vec3 gAmbient;
+#endif
 
-in vec3 position;
 in vec3 normal;
 in vec2 texCoord;
+in vec4 currentPosition;
+in vec4 prevPosition;
+#ifdef LIGHTMAP
+in vec2 lightmapCoord;
+
+#include "spherical_harmonics.glsl"
+uniform sampler2D lightmap;
+// 0 for objects without lightmap coords, they get the unoccluded sky
+uniform int lightmapped;
+#endif
 
 struct Material {
   sampler2D diffuse;
@@ -15,12 +31,21 @@ struct Material {
 uniform Material material;
 
 void main() {
-  // store the fragment position vector in the first gbuffer texture
-  gPosition = vec4(position, 1.0);
-  // also store the per-fragment normals into the gbuffer
-  gNormal = vec4(normalize(normal), 1.0);
+  // position is not stored, it comes back from the depth buffer.
+  // store the per-fragment normals into the first gbuffer texture
+  vec3 n = normalize(normal);
+  gNormal = EncodeNormal(n);
   // and the diffuse per-fragment color
   gAlbedoSpec.rgb = texture(material.diffuse, texCoord).rgb;
   // store specular intensity in gAlbedoSpec’s alpha component
   gAlbedoSpec.a = texture(material.specular, texCoord).r;
-}
\ No newline at end of file
+  gVelocity = (currentPosition.xy / currentPosition.w - prevPosition.xy / prevPosition.w) * 0.5;
+#ifdef LIGHTMAP
+  gAmbient = IrradianceSH(n);
+  if (lightmapped != 0) {
+    // baked sky visibility and bounce light
+    vec4 baked = texture(lightmap, lightmapCoord);
+    gAmbient = gAmbient * baked.a + baked.rgb;
+  }
+#endif
+}
@@ -2,17 +2,32 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+#ifdef LIGHTMAP
+layout (location = 4) in vec2 aLightmapCoord;
+#endif
 
 uniform mat4 transform;
 uniform mat4 modelTransform;
+// both without the sub pixel jitter, their difference is the velocity
+uniform mat4 viewProjection;
+uniform mat4 prevViewProjection;
+uniform mat4 prevModelTransform;
 
 out vec3 normal;
 out vec2 texCoord;
-out vec3 position;
+out vec4 currentPosition;
+out vec4 prevPosition;
+#ifdef LIGHTMAP
+out vec2 lightmapCoord;
+#endif
 
 void main() {
   gl_Position = transform * vec4(aPos, 1.0);
   normal = (transpose(inverse(modelTransform)) * vec4(aNormal, 0.0)).xyz;
   texCoord = aTexCoord;
-  position = (modelTransform * vec4(aPos, 1.0)).xyz;
-}
\ No newline at end of file
+  currentPosition = viewProjection * modelTransform * vec4(aPos, 1.0);
+  prevPosition = prevViewProjection * prevModelTransform * vec4(aPos, 1.0);
+#ifdef LIGHTMAP
+  lightmapCoord = aLightmapCoord;
+#endif
+}
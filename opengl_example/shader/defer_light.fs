@@ -2,11 +2,27 @@
 out vec4 fragColor;
 in vec2 texCoord;
 
-uniform sampler2D gPosition;
+#include "gbuffer.glsl"
+
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseViewProjection;
+#ifdef USE_SSAO
 uniform sampler2D ssao;
-uniform int useSsao;
+#endif
+#ifdef LIGHTMAP
+// ambient irradiance / pi written by the geometry pass, already occluded
+// by the lightmap on static surfaces
+uniform sampler2D gAmbient;
+uniform float ambientIntensity;
+#endif
+#ifdef SHADOW_ATLAS
+#include "shadow_atlas.glsl"
+#endif
+#ifdef SH_AMBIENT
+#include "spherical_harmonics.glsl"
+#endif
 
 struct Light {
     vec3 position;
@@ -14,17 +30,33 @@ struct Light {
 };
 const int NR_LIGHTS = 32;
 uniform Light lights[NR_LIGHTS];
+#ifdef SHADOW_ATLAS
+// first atlas tile of every light, -1 if unshadowed
+uniform int shadowFirstTiles[NR_LIGHTS];
+#endif
 uniform vec3 viewPos;
 void main() {
     // retrieve data from G-buffer
-    vec3 fragPos = texture(gPosition, texCoord).rgb;
-    vec3 normal = texture(gNormal, texCoord).rgb;
+    float depth = texture(gDepth, texCoord).r;
     vec3 albedo = texture(gAlbedoSpec, texCoord).rgb;
     float specular = texture(gAlbedoSpec, texCoord).a;
+    if (IsBackground(depth)) {
+        fragColor = vec4(albedo * 0.4, 1.0);
+        return;
+    }
+    vec3 fragPos = ReconstructPosition(texCoord, depth, inverseViewProjection);
+    vec3 normal = DecodeNormal(texture(gNormal, texCoord).rg);
     // then calculate lighting as usual
-    vec3 ambient = useSsao == 1 ?
-        texture(ssao, texCoord).r * 0.4 * albedo :
-        albedo * 0.4; // hard-coded ambient component
+#if defined(LIGHTMAP)
+    vec3 ambient = albedo * texture(gAmbient, texCoord).rgb * ambientIntensity;
+#elif defined(SH_AMBIENT)
+    vec3 ambient = albedo * IrradianceSH(normal) * shAmbientIntensity;
+#else
+    vec3 ambient = albedo * 0.4; // hard-coded ambient component
+#endif
+#ifdef USE_SSAO
+    ambient *= texture(ssao, texCoord).r;
+#endif
     vec3 lighting = ambient; 
 
     vec3 viewDir = normalize(viewPos - fragPos);
@@ -32,6 +64,10 @@ void main() {
         // diffuse
         vec3 lightDir = normalize(lights[i].position - fragPos);
         vec3 diffuse = max(dot(normal, lightDir), 0.0) * albedo * lights[i].color;
+#ifdef SHADOW_ATLAS
+        if (shadowFirstTiles[i] >= 0)
+            diffuse *= PointShadow(shadowFirstTiles[i], lights[i].position, fragPos, normal);
+#endif
         lighting += diffuse;
     }
     fragColor = vec4(lighting, 1.0);
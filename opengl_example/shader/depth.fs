@@ -0,0 +1,5 @@
+#version 330 core
+
+// depth only, no color is written
+void main() {
+}
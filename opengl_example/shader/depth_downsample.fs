@@ -0,0 +1,17 @@
+#version 330 core
+
+out float fragColor;
+
+// only the source level is visible through the base / max level range
+uniform sampler2D tex;
+
+void main() {
+    ivec2 maxCoord = textureSize(tex, 0) - 1;
+    ivec2 coord = ivec2(gl_FragCoord.xy) * 2;
+    float d0 = texelFetch(tex, min(coord, maxCoord), 0).r;
+    float d1 = texelFetch(tex, min(coord + ivec2(1, 0), maxCoord), 0).r;
+    float d2 = texelFetch(tex, min(coord + ivec2(0, 1), maxCoord), 0).r;
+    float d3 = texelFetch(tex, min(coord + ivec2(1, 1), maxCoord), 0).r;
+    // keep the closest depth so thin occluders survive in coarse levels
+    fragColor = min(min(d0, d1), min(d2, d3));
+}
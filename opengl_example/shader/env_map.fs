@@ -6,10 +6,13 @@ in vec3 normal;
 in vec3 position;
 
 uniform vec3 cameraPos;
+// prefiltered, mip i is the GGX lobe of roughness i / maxLod
 uniform samplerCube skybox;
+uniform float roughness;
+uniform float maxLod;
 
 void main() {
     vec3 I = normalize(position - cameraPos);
     vec3 R = reflect(I, normalize(normal));
-    fragColor = vec4(texture(skybox, R).rgb, 1.0);
+    fragColor = vec4(textureLod(skybox, R, roughness * maxLod).rgb, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 330 core
+out float averageLuminance;
+
+uniform sampler2D histogram;
+uniform vec2 logRange;
+// fractions of the pixels ignored at the dark and the bright end
+uniform vec2 percentRange;
+
+void main() {
+    int binCount = textureSize(histogram, 0).x;
+    float total = 0.0;
+    for (int i = 0; i < binCount; i++)
+        total += texelFetch(histogram, ivec2(i, 0), 0).r;
+
+    // mean log luminance of the pixels between the two percentiles
+    float low = total * percentRange.x;
+    float high = total * percentRange.y;
+    float below = 0.0;
+    float sum = 0.0;
+    float weight = 0.0;
+    for (int i = 0; i < binCount; i++) {
+        float count = texelFetch(histogram, ivec2(i, 0), 0).r;
+        float used = clamp(below + count, low, high) - clamp(below, low, high);
+        below += count;
+        float logLuminance = mix(logRange.x, logRange.y, (float(i) + 0.5) / float(binCount));
+        sum += logLuminance * used;
+        weight += used;
+    }
+    averageLuminance = weight > 0.0 ? exp2(sum / weight) : 0.18;
+}
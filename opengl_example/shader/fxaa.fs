@@ -0,0 +1,134 @@
+#version 330 core
+out vec4 fragColor;
+in vec2 texCoord;
+
+// tone mapped color, perceptual luma in alpha written by the post pass
+uniform sampler2D ldrColor;
+uniform vec2 texelSize;
+// local contrast an edge needs, relative to the brightest neighbor
+uniform float edgeThreshold;
+// and in absolute terms, darker edges are left alone
+uniform float edgeThresholdMin;
+// how much of the sub pixel aliasing is smoothed
+uniform float subpixelQuality;
+
+// edge search steps in texels, growing further along the edge
+const int SEARCH_STEP_COUNT = 10;
+const float SEARCH_STEPS[SEARCH_STEP_COUNT] = float[](
+    1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 4.0, 8.0);
+
+float Luma(vec2 uv) {
+    return textureLod(ldrColor, uv, 0.0).a;
+}
+
+float LumaOffset(ivec2 offset) {
+    return textureLodOffset(ldrColor, texCoord, 0.0, offset).a;
+}
+
+void main() {
+    vec4 center = textureLod(ldrColor, texCoord, 0.0);
+    float lumaCenter = center.a;
+    float lumaDown = LumaOffset(ivec2(0, -1));
+    float lumaUp = LumaOffset(ivec2(0, 1));
+    float lumaLeft = LumaOffset(ivec2(-1, 0));
+    float lumaRight = LumaOffset(ivec2(1, 0));
+
+    // skip pixels without enough contrast
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float lumaRange = lumaMax - lumaMin;
+    if (lumaRange < max(edgeThresholdMin, lumaMax * edgeThreshold)) {
+        fragColor = vec4(center.rgb, 1.0);
+        return;
+    }
+
+    float lumaDownLeft = LumaOffset(ivec2(-1, -1));
+    float lumaUpRight = LumaOffset(ivec2(1, 1));
+    float lumaUpLeft = LumaOffset(ivec2(-1, 1));
+    float lumaDownRight = LumaOffset(ivec2(1, -1));
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+    // edge orientation from the second derivatives
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) +
+        abs(-2.0 * lumaCenter + lumaDownUp) * 2.0 +
+        abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) +
+        abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0 +
+        abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+    // the side of the pixel the edge lies on
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+    float stepLength = isHorizontal ? texelSize.y : texelSize.x;
+    float lumaLocalAverage;
+    if (is1Steepest) {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+    }
+    else {
+        lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+    }
+
+    // walk along the edge, half a texel off the center, until both ends
+    // leave it
+    vec2 edgeUv = texCoord;
+    if (isHorizontal)
+        edgeUv.y += stepLength * 0.5;
+    else
+        edgeUv.x += stepLength * 0.5;
+    vec2 offset = isHorizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+    vec2 uv1 = edgeUv - offset * SEARCH_STEPS[0];
+    vec2 uv2 = edgeUv + offset * SEARCH_STEPS[0];
+    float lumaEnd1 = Luma(uv1) - lumaLocalAverage;
+    float lumaEnd2 = Luma(uv2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+    for (int i = 1; i < SEARCH_STEP_COUNT && !(reached1 && reached2); i++) {
+        if (!reached1) {
+            uv1 -= offset * SEARCH_STEPS[i];
+            lumaEnd1 = Luma(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2) {
+            uv2 += offset * SEARCH_STEPS[i];
+            lumaEnd2 = Luma(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    // shift towards the edge by where the pixel sits along it, only if
+    // the nearer end varies the same way as the center
+    float distance1 = isHorizontal ? texCoord.x - uv1.x : texCoord.y - uv1.y;
+    float distance2 = isHorizontal ? uv2.x - texCoord.x : uv2.y - texCoord.y;
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float edgeLength = distance1 + distance2;
+    float pixelOffset = -distanceFinal / edgeLength + 0.5;
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+    // thin features shorter than the search get the sub pixel blur
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) +
+        lumaLeftCorners + lumaRightCorners);
+    float subpixel = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+    subpixel = (-2.0 * subpixel + 3.0) * subpixel * subpixel;
+    finalOffset = max(finalOffset, subpixel * subpixel * subpixelQuality);
+
+    vec2 finalUv = texCoord;
+    if (isHorizontal)
+        finalUv.y += finalOffset * stepLength;
+    else
+        finalUv.x += finalOffset * stepLength;
+    fragColor = vec4(textureLod(ldrColor, finalUv, 0.0).rgb, 1.0);
+}
@@ -0,0 +1,40 @@
+// compact G-buffer layout
+//   gNormal     RG16   octahedral encoded world normal
+//   gAlbedoSpec RGBA8  albedo, specular intensity
+//   gVelocity   RG16F  screen uv motion since the previous frame
+//   gDepth      D24S8  hardware depth, position is reconstructed from it
+
+// background pixels have no geometry, their depth stays at the cleared 1.0
+bool IsBackground(float depth) {
+    return depth >= 1.0;
+}
+
+// linear depth given to the background, pushed far away so it never occludes
+const float FAR_DEPTH = 1000.0;
+
+vec2 OctWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// unit vector to [0, 1]^2
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+vec3 DecodeNormal(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// inverseMatrix is the inverse projection for view space position,
+// or the inverse view projection for world space position
+vec3 ReconstructPosition(vec2 uv, float depth, mat4 inverseMatrix) {
+    vec4 position = inverseMatrix * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
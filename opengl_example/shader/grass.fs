@@ -9,5 +9,6 @@ void main() {
     vec4 pixel = texture(tex, texCoord);
     if (pixel.a < 0.05)
         discard;
-    fragColor = pixel;
-}
\ No newline at end of file
+    // darker towards the root, where the blades shade each other
+    fragColor = vec4(pixel.rgb * mix(0.4, 1.0, texCoord.y), 1.0);
+}
@@ -2,19 +2,38 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoord;
-layout (location = 3) in vec3 aOffset;
+// per instance: x, z, rotation around y, stable hash in [0, 1)
+layout (location = 3) in vec4 aInstance;
 out vec2 texCoord;
 
-uniform mat4 transform;
+uniform mat4 viewProjection;
+uniform vec3 cameraPos;
+uniform vec2 bladeSize;
+// full density until x, no grass from y on
+uniform vec2 lodDistances;
+uniform float time;
+uniform vec2 windDirection;
+uniform float windStrength;
 
 void main() {
-    float c = cos(aOffset.y);
-    float s = sin(aOffset.y);
-    mat4 offsetMat = mat4(
-        c, 0.0, -s, 0.0,
-        0.0, 1.0, 0.0, 0.0,
-        s, 0.0, c, 0.0,
-        aOffset.x, 0.0, aOffset.z, 1.0);
-    gl_Position = transform * offsetMat * vec4(aPos, 1.0);
+    vec3 root = vec3(aInstance.x, 0.0, aInstance.y);
+    // a blade is drawn while its hash is under the density at its distance.
+    // the cpu only cuts whole chunks, shrink the rest away instead of popping
+    float density = clamp((lodDistances.y - distance(root, cameraPos)) /
+        (lodDistances.y - lodDistances.x), 0.0, 1.0);
+    float scale = clamp((density - aInstance.w) * 10.0, 0.0, 1.0);
+
+    // stand the quad on its bottom edge
+    vec2 local = vec2(aPos.x, aPos.y + 0.5) * bladeSize * scale;
+    float c = cos(aInstance.z);
+    float s = sin(aInstance.z);
+    vec3 position = root + vec3(c * local.x, local.y, -s * local.x);
+
+    // sway the top, phase shifted along the wind and per blade
+    float bend = aTexCoord.y * aTexCoord.y;
+    float sway = sin(time * 2.0 + dot(root.xz, windDirection) * 0.5 + aInstance.w * 6.2831853);
+    position.xz += windDirection * (sway * 0.5 + 0.5) * windStrength * bend * bladeSize.y;
+
+    gl_Position = viewProjection * vec4(position, 1.0);
     texCoord = aTexCoord;
-}
\ No newline at end of file
+}
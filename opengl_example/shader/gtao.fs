@@ -0,0 +1,126 @@
+#version 330 core
+
+// r: ambient occlusion, g: view space depth for the bilateral blur / upsample
+out vec2 fragColor;
+
+in vec2 texCoord;
+
+#include "gbuffer.glsl"
+
+uniform sampler2D depthPyramid;
+uniform sampler2D gNormal;
+
+uniform mat4 view;
+uniform vec2 projScale;     // 1 / projection[0][0], 1 / projection[1][1]
+uniform vec2 screenSize;    // depth pyramid level 0 size
+uniform float maxLod;
+uniform float radius;
+uniform float finalPower;
+uniform int resolutionScale;
+uniform int frameIndex;
+
+// SLICE_COUNT, STEP_COUNT are set per program variant
+#ifndef SLICE_COUNT
+#define SLICE_COUNT 2
+#endif
+#ifndef STEP_COUNT
+#define STEP_COUNT 4
+#endif
+
+const float PI = 3.14159265;
+const float HALF_PI = 1.57079633;
+
+vec3 ViewPosition(vec2 uv, float depth) {
+    return vec3((uv * 2.0 - 1.0) * projScale * depth, -depth);
+}
+
+float InterleavedGradientNoise(vec2 pixel) {
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy) * resolutionScale;
+    vec2 uv = (vec2(pixel) + 0.5) / screenSize;
+    float depth = texelFetch(depthPyramid, pixel, 0).r;
+    if (depth >= FAR_DEPTH) {
+        // background is unoccluded, zero depth marks it for the later passes
+        fragColor = vec2(1.0, 0.0);
+        return;
+    }
+    vec3 viewPos = ViewPosition(uv, depth);
+    vec3 viewVec = normalize(-viewPos);
+    vec3 normal = normalize((view * vec4(DecodeNormal(texelFetch(gNormal, pixel, 0).rg), 0.0)).xyz);
+
+    // noise is shifted every frame so temporal accumulation sees new directions
+    vec2 noisePixel = gl_FragCoord.xy + 5.588238 * float(frameIndex % 64);
+    float noiseSlice = InterleavedGradientNoise(noisePixel);
+    float noiseStep = InterleavedGradientNoise(noisePixel.yx + vec2(13.0, 37.0));
+
+    // world space radius projected to uv units at this depth
+    vec2 radiusUv = radius * 0.5 / (projScale * depth);
+    float falloffRange = 0.615 * radius;
+    float falloffMul = -1.0 / falloffRange;
+    float falloffAdd = (radius - falloffRange) / falloffRange + 1.0;
+
+    float visibility = 0.0;
+    for (int slice = 0; slice < SLICE_COUNT; slice++) {
+        float phi = (float(slice) + noiseSlice) * PI / float(SLICE_COUNT);
+        vec2 omega = vec2(cos(phi), sin(phi));
+
+        // slice plane through the view vector, and the normal projected onto it
+        vec3 directionVec = vec3(omega, 0.0);
+        vec3 orthoDirectionVec = directionVec - dot(directionVec, viewVec) * viewVec;
+        vec3 axisVec = normalize(cross(orthoDirectionVec, viewVec));
+        vec3 projectedNormal = normal - axisVec * dot(normal, axisVec);
+        float projectedNormalLength = length(projectedNormal);
+        float signNorm = sign(dot(orthoDirectionVec, projectedNormal));
+        float cosNorm = clamp(dot(projectedNormal, viewVec) / projectedNormalLength, 0.0, 1.0);
+        float n = signNorm * acos(cosNorm);
+
+        float lowHorizonCos0 = cos(n + HALF_PI);
+        float lowHorizonCos1 = cos(n - HALF_PI);
+        float horizonCos0 = lowHorizonCos0;
+        float horizonCos1 = lowHorizonCos1;
+
+        for (int j = 0; j < STEP_COUNT; j++) {
+            float s = (float(j) + noiseStep) / float(STEP_COUNT);
+            s *= s;
+            vec2 offset = omega * radiusUv * s;
+            // always step off the center pixel
+            float offsetPixels = length(offset * screenSize);
+            if (offsetPixels < 1.0) {
+                offset /= max(offsetPixels, 0.0001);
+                offsetPixels = 1.0;
+            }
+            // far samples read coarser levels of the depth pyramid
+            float lod = clamp(log2(offsetPixels) - 3.3, 0.0, maxLod);
+
+            vec2 uv0 = uv + offset;
+            vec2 uv1 = uv - offset;
+            vec3 delta0 = ViewPosition(uv0, textureLod(depthPyramid, uv0, lod).r) - viewPos;
+            vec3 delta1 = ViewPosition(uv1, textureLod(depthPyramid, uv1, lod).r) - viewPos;
+            float length0 = length(delta0);
+            float length1 = length(delta1);
+            float shc0 = dot(delta0 / length0, viewVec);
+            float shc1 = dot(delta1 / length1, viewVec);
+            float weight0 = clamp(length0 * falloffMul + falloffAdd, 0.0, 1.0);
+            float weight1 = clamp(length1 * falloffMul + falloffAdd, 0.0, 1.0);
+            horizonCos0 = max(horizonCos0, mix(lowHorizonCos0, shc0, weight0));
+            horizonCos1 = max(horizonCos1, mix(lowHorizonCos1, shc1, weight1));
+        }
+
+        // horizon angles clamped to the normal hemisphere, then the
+        // cosine weighted visible arc is integrated analytically
+        float h0 = -acos(horizonCos1);
+        float h1 = acos(horizonCos0);
+        h0 = n + clamp(h0 - n, -HALF_PI, HALF_PI);
+        h1 = n + clamp(h1 - n, -HALF_PI, HALF_PI);
+        float arc0 = (cosNorm + 2.0 * h0 * sin(n) - cos(2.0 * h0 - n)) / 4.0;
+        float arc1 = (cosNorm + 2.0 * h1 * sin(n) - cos(2.0 * h1 - n)) / 4.0;
+        visibility += projectedNormalLength * (arc0 + arc1);
+    }
+    visibility /= float(SLICE_COUNT);
+    visibility = pow(clamp(visibility, 0.0, 1.0), finalPower);
+
+    fragColor = vec2(max(visibility, 0.03), depth);
+}
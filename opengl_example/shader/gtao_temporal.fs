@@ -0,0 +1,43 @@
+#version 330 core
+
+#include "gbuffer.glsl"
+
+// r: ambient occlusion, g: view space depth
+out vec2 fragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D tex;      // this frame
+uniform sampler2D history;  // accumulated result of previous frames
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform mat4 prevView;
+uniform mat4 prevProjection;
+uniform int resolutionScale;
+uniform float historyWeight;
+
+void main() {
+    vec2 current = texelFetch(tex, ivec2(gl_FragCoord.xy), 0).rg;
+    if (current.g <= 0.0) {
+        fragColor = current;
+        return;
+    }
+
+    // reproject this pixel into the previous frame
+    ivec2 pixel = ivec2(gl_FragCoord.xy) * resolutionScale;
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(gDepth, 0));
+    vec3 worldPos = ReconstructPosition(uv, texelFetch(gDepth, pixel, 0).r, inverseViewProjection);
+    vec4 prevViewPos = prevView * vec4(worldPos, 1.0);
+    vec4 prevClip = prevProjection * prevViewPos;
+    vec2 prevUv = prevClip.xy / prevClip.w * 0.5 + 0.5;
+    vec2 prev = texture(history, prevUv).rg;
+
+    // reject history outside the screen or belonging to another surface
+    float weight = historyWeight;
+    if (any(lessThan(prevUv, vec2(0.0))) || any(greaterThan(prevUv, vec2(1.0))))
+        weight = 0.0;
+    if (abs(prev.g + prevViewPos.z) > 0.05 * -prevViewPos.z)
+        weight = 0.0;
+
+    fragColor = vec2(mix(current.r, prev.r, weight), current.g);
+}
@@ -0,0 +1,6 @@
+#version 330 core
+out float count;
+
+void main() {
+    count = 1.0;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+// one point per texel of the log luminance target, drawn without vertex
+// buffers. additive blending counts them into their bin
+uniform sampler2D logLuminance;
+uniform int binCount;
+// log2 luminance range mapped onto the bins
+uniform vec2 logRange;
+
+void main() {
+    int width = textureSize(logLuminance, 0).x;
+    float value = texelFetch(logLuminance, ivec2(gl_VertexID % width, gl_VertexID / width), 0).r;
+    float bin = floor(clamp((value - logRange.x) / (logRange.y - logRange.x), 0.0, 0.9999) *
+        float(binCount));
+    gl_Position = vec4((bin + 0.5) / float(binCount) * 2.0 - 1.0, 0.0, 0.0, 1.0);
+}
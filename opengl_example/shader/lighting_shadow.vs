@@ -15,6 +15,9 @@ uniform mat4 transform;
 uniform mat4 modelTransform;
 uniform mat4 lightTransform;
 
+// matches the depth prepass, see depth.vs
+invariant gl_Position;
+
 void main() {
     gl_Position = transform * vec4(aPos, 1.0);
     vs_out.fragPos = vec3(modelTransform * vec4(aPos, 1.0));
@@ -0,0 +1,16 @@
+#version 330 core
+
+out float fragColor;
+
+#include "gbuffer.glsl"
+
+uniform sampler2D gDepth;
+uniform mat4 inverseProjection;
+
+void main() {
+    float depth = texelFetch(gDepth, ivec2(gl_FragCoord.xy), 0).r;
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    fragColor = IsBackground(depth) ?
+        FAR_DEPTH :
+        -ReconstructPosition(uv, depth, inverseProjection).z;
+}
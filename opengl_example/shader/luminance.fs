@@ -0,0 +1,19 @@
+#version 330 core
+out float logLuminance;
+in vec2 texCoord;
+
+uniform sampler2D hdrColor;
+
+void main() {
+    // average the 4x4 block under this texel, fetched texel by texel so
+    // the result does not depend on the filter of hdrColor
+    ivec2 maxPixel = textureSize(hdrColor, 0) - 1;
+    ivec2 base = ivec2(gl_FragCoord.xy) * 4;
+    vec3 color = vec3(0.0);
+    for (int x = 0; x < 4; x++) {
+        for (int y = 0; y < 4; y++)
+            color += texelFetch(hdrColor, min(base + ivec2(x, y), maxPixel), 0).rgb;
+    }
+    float luminance = dot(color / 16.0, vec3(0.2126, 0.7152, 0.0722));
+    logLuminance = log2(max(luminance, 1e-5));
+}
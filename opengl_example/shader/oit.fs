@@ -0,0 +1,23 @@
+#version 330 core
+// weighted blended order independent transparency. both targets share
+// one blend state, GL 3.3 has no per target blending:
+//   color ONE, ONE                  sums into accumulation.rgb and weight
+//   alpha ZERO, ONE_MINUS_SRC_ALPHA multiplies accumulation.a, the revealage
+layout (location = 0) out vec4 accumulation;
+layout (location = 1) out float weight;
+in vec2 texCoord;
+
+uniform sampler2D tex;
+
+void main() {
+    vec4 color = texture(tex, texCoord);
+    if (color.a < 0.01)
+        discard;
+    // favors near and opaque surfaces, the depth term falls off with the
+    // window depth (McGuire and Bavoil 2013, eq. 10)
+    float z = gl_FragCoord.z;
+    float w = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 *
+        pow(1.0 - z * 0.9, 3.0), 1e-2, 3e3);
+    accumulation = vec4(color.rgb * color.a * w, color.a);
+    weight = color.a * w;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+// per instance: position, rotation around y
+layout (location = 3) in vec4 aInstance;
+out vec2 texCoord;
+
+uniform mat4 viewProjection;
+
+void main() {
+    float c = cos(aInstance.w);
+    float s = sin(aInstance.w);
+    mat4 modelTransform = mat4(
+        c, 0.0, -s, 0.0,
+        0.0, 1.0, 0.0, 0.0,
+        s, 0.0, c, 0.0,
+        aInstance.xyz, 1.0);
+    gl_Position = viewProjection * modelTransform * vec4(aPos, 1.0);
+    texCoord = aTexCoord;
+}
@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 fragColor;
+in vec2 texCoord;
+
+uniform sampler2D accumulation;
+uniform sampler2D weight;
+
+// blended with ONE_MINUS_SRC_ALPHA, SRC_ALPHA over the opaque frame,
+// alpha carries the revealage
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 accum = texelFetch(accumulation, pixel, 0);
+    float revealage = accum.a;
+    if (revealage >= 0.999)
+        discard;
+    float weightSum = texelFetch(weight, pixel, 0).r;
+    vec3 average = accum.rgb / max(weightSum, 1e-5);
+    fragColor = vec4(average, revealage);
+}
@@ -0,0 +1,14 @@
+#version 330 core
+in vec2 texCoord;
+in vec4 color;
+out vec4 fragColor;
+
+uniform float intensity;
+
+void main() {
+    // soft round sprite, summed additively so no sorting is needed
+    float alpha = color.a * (1.0 - smoothstep(0.5, 1.0, length(texCoord * 2.0 - 1.0)));
+    if (alpha <= 0.0)
+        discard;
+    fragColor = vec4(color.rgb * alpha * intensity, 1.0);
+}
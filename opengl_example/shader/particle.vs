@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+// per instance: position, seconds left
+layout (location = 3) in vec4 aInstance;
+layout (location = 4) in vec4 aColor;
+out vec2 texCoord;
+out vec4 color;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float particleSize;
+
+void main() {
+    // offset in view space so the quad faces the camera
+    vec4 viewPos = view * vec4(aInstance.xyz, 1.0);
+    viewPos.xy += aPos.xy * particleSize;
+    gl_Position = projection * viewPos;
+    texCoord = aTexCoord;
+    // fade out over the last half second
+    color = vec4(aColor.rgb, aColor.a * clamp(aInstance.w * 2.0, 0.0, 1.0));
+}
@@ -0,0 +1,125 @@
+#version 330 core
+out vec4 fragColor;
+in vec2 texCoord;
+
+// per pixel effects run in one pass, each enabled by its define in the
+// order below. effects that read neighbouring pixels need their own pass
+uniform sampler2D hdrColor;
+uniform float exposure;
+#ifdef GAMMA
+uniform float gamma;
+#endif
+#ifdef VIGNETTE
+// strength, radius where the darkening starts
+uniform vec2 vignette;
+#endif
+#ifdef UPSCALE
+// hdrColor is rendered below the output size, in texels
+uniform vec2 sourceSize;
+#endif
+#ifdef BLOOM
+// first level of the bloom chain, half the hdrColor resolution
+uniform sampler2D bloom;
+uniform float bloomIntensity;
+#endif
+
+// curve fit of the ACES filmic tone mapping
+vec3 TonemapAces(vec3 x) {
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+#ifdef UPSCALE
+vec3 FetchSource(vec2 texel) {
+    return texelFetch(hdrColor, clamp(ivec2(texel), ivec2(0), ivec2(sourceSize) - 1), 0).rgb;
+}
+
+// approximate lanczos 2, x2 is the squared distance in texels. lobe
+// scales the negative part, 0 leaves a plain smooth window
+float LanczosWeight(float x2, float lobe) {
+    if (x2 >= 4.0)
+        return 0.0;
+    float window = (0.25 * x2 - 1.0) * (0.25 * x2 - 1.0);
+    float base = 25.0 / 16.0 * (0.4 * x2 - 1.0) * (0.4 * x2 - 1.0) - 9.0 / 16.0;
+    return window * mix(1.0, base, lobe);
+}
+
+// edge adaptive upscale: 12 texels around the sample, weighted by a
+// kernel stretched along the local edge so edges are not blurred across,
+// and clamped to the nearest 2x2 texels to keep the lobes from ringing
+vec3 SampleUpscaled(vec2 uv) {
+    vec2 position = uv * sourceSize - 0.5;
+    vec2 base = floor(position);
+    vec3 c00 = FetchSource(base);
+    vec3 c10 = FetchSource(base + vec2(1.0, 0.0));
+    vec3 c01 = FetchSource(base + vec2(0.0, 1.0));
+    vec3 c11 = FetchSource(base + vec2(1.0, 1.0));
+
+    // edge direction and strength from the luma gradient of the quad
+    const vec3 LUMA = vec3(0.2126, 0.7152, 0.0722);
+    float l00 = dot(c00, LUMA);
+    float l10 = dot(c10, LUMA);
+    float l01 = dot(c01, LUMA);
+    float l11 = dot(c11, LUMA);
+    vec2 gradient = vec2(l10 - l00 + l11 - l01, l01 - l00 + l11 - l10);
+    float lumaRange = max(max(l00, l10), max(l01, l11)) - min(min(l00, l10), min(l01, l11));
+    float gradientLength = length(gradient);
+    float edge = clamp(gradientLength / (2.0 * lumaRange + 1e-5), 0.0, 1.0);
+    edge *= edge;
+    vec2 across = gradientLength > 1e-5 ? gradient / gradientLength : vec2(1.0, 0.0);
+    vec2 along = vec2(-across.y, across.x);
+    float stretch = 1.0 + edge;
+
+    const vec2 OFFSETS[12] = vec2[](
+        vec2(0.0, -1.0), vec2(1.0, -1.0),
+        vec2(-1.0, 0.0), vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(2.0, 0.0),
+        vec2(-1.0, 1.0), vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(2.0, 1.0),
+        vec2(0.0, 2.0), vec2(1.0, 2.0));
+    vec3 sum = vec3(0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < 12; i++) {
+        vec2 offset = base + OFFSETS[i] - position;
+        float distanceAcross = dot(offset, across);
+        float distanceAlong = dot(offset, along) / stretch;
+        float weight = LanczosWeight(distanceAcross * distanceAcross +
+            distanceAlong * distanceAlong, edge);
+        sum += FetchSource(base + OFFSETS[i]) * weight;
+        weightSum += weight;
+    }
+    vec3 color = sum / max(weightSum, 1e-5);
+    vec3 minColor = min(min(c00, c10), min(c01, c11));
+    vec3 maxColor = max(max(c00, c10), max(c01, c11));
+    return clamp(color, minColor, maxColor);
+}
+#endif
+
+void main() {
+#ifdef UPSCALE
+    vec3 color = SampleUpscaled(texCoord) * exposure;
+#else
+    vec3 color = texture(hdrColor, texCoord).rgb * exposure;
+#endif
+#ifdef BLOOM
+    color = mix(color, texture(bloom, texCoord).rgb * exposure, bloomIntensity);
+#endif
+#ifdef VIGNETTE
+    float distance = length(texCoord - 0.5) * 1.41421356;
+    color *= 1.0 - vignette.x * smoothstep(vignette.y, 1.0, distance);
+#endif
+    color = TonemapAces(color);
+#ifdef GRAYSCALE
+    color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+#endif
+#ifdef INVERT
+    color = 1.0 - color;
+#endif
+#ifdef GAMMA
+    color = pow(color, vec3(gamma));
+#endif
+    // linear out, GL_FRAMEBUFFER_SRGB encodes on write
+#ifdef FXAA_LUMA
+    // gamma 2 approximation of the perceptual luma fxaa compares
+    fragColor = vec4(color, sqrt(dot(color, vec3(0.299, 0.587, 0.114))));
+#else
+    fragColor = vec4(color, 1.0);
+#endif
+}
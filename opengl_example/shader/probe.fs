@@ -0,0 +1,35 @@
+#version 330 core
+out vec4 fragColor;
+
+in vec3 position;
+in vec3 normal;
+in vec2 texCoord;
+
+#ifdef SKYBOX
+uniform samplerCube skybox;
+#else
+#include "spherical_harmonics.glsl"
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+};
+uniform Material material;
+// xyz is the direction towards the light if w is 0, its position if 1
+uniform vec4 lightVector;
+uniform vec3 lightColor;
+#endif
+
+void main() {
+#ifdef SKYBOX
+    fragColor = texture(skybox, position);
+#else
+    // diffuse only, reflections are blurred and small on screen
+    vec3 albedo = texture(material.diffuse, texCoord).rgb;
+    vec3 n = normalize(normal);
+    vec3 lightDir = normalize(lightVector.xyz - position * lightVector.w);
+    vec3 lighting = IrradianceSH(n) * shAmbientIntensity +
+        lightColor * max(dot(n, lightDir), 0.0);
+    fragColor = vec4(albedo * lighting, 1.0);
+#endif
+}
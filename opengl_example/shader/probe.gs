@@ -0,0 +1,47 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+in vec3 vPosition[];
+in vec3 vNormal[];
+in vec2 vTexCoord[];
+
+out vec3 position;
+out vec3 normal;
+out vec2 texCoord;
+
+// +x -x +y -y +z -z, see ReflectionProbe
+uniform mat4 faceViewProjections[6];
+
+// the side planes are linear in clip space, so a triangle with every
+// vertex outside the same one cannot touch the face
+bool OutsideFace(vec4 c0, vec4 c1, vec4 c2) {
+    return (c0.x < -c0.w && c1.x < -c1.w && c2.x < -c2.w) ||
+        (c0.x > c0.w && c1.x > c1.w && c2.x > c2.w) ||
+        (c0.y < -c0.w && c1.y < -c1.w && c2.y < -c2.w) ||
+        (c0.y > c0.w && c1.y > c1.w && c2.y > c2.w);
+}
+
+void main() {
+    for (int face = 0; face < 6; face++) {
+        vec4 clip[3];
+        for (int i = 0; i < 3; i++)
+            clip[i] = faceViewProjections[face] * vec4(vPosition[i], 1.0);
+        if (OutsideFace(clip[0], clip[1], clip[2]))
+            continue;
+        for (int i = 0; i < 3; i++) {
+            gl_Layer = face;
+#ifdef SKYBOX
+            // on the far plane
+            gl_Position = clip[i].xyww;
+#else
+            gl_Position = clip[i];
+#endif
+            position = vPosition[i];
+            normal = vNormal[i];
+            texCoord = vTexCoord[i];
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
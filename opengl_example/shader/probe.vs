@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+uniform mat4 modelTransform;
+
+// world space, the geometry shader projects them once per cube face
+out vec3 vPosition;
+out vec3 vNormal;
+out vec2 vTexCoord;
+
+void main() {
+#ifdef SKYBOX
+    vPosition = aPos;
+#else
+    vPosition = vec3(modelTransform * vec4(aPos, 1.0));
+#endif
+    vNormal = (transpose(inverse(modelTransform)) * vec4(aNormal, 0.0)).xyz;
+    vTexCoord = aTexCoord;
+}
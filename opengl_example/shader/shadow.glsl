@@ -0,0 +1,125 @@
+// shadow filter quality tiers, SHADOW_FILTER is set per program variant.
+// every tap is a bilinear 2x2 depth comparison done by the sampler
+#define SHADOW_FILTER_SINGLE 0   // one bilinear tap
+#define SHADOW_FILTER_FOUR_TAP 1 // 4 taps, 3x3 texel tent
+#define SHADOW_FILTER_PCF 2      // 3x3 taps
+#define SHADOW_FILTER_POISSON 3  // rotated poisson disk, soft but noisy
+#ifndef SHADOW_FILTER
+#define SHADOW_FILTER SHADOW_FILTER_PCF
+#endif
+
+#ifdef DIRECTIONAL_LIGHT
+uniform sampler2DArrayShadow shadowMap;
+#else
+uniform sampler2DShadow shadowMap;
+#endif
+
+// 1 if lit, layer is the cascade of the directional light
+float ShadowTap(vec2 uv, float ref, float layer) {
+#ifdef DIRECTIONAL_LIGHT
+    return texture(shadowMap, vec4(uv, layer, ref));
+#else
+    return texture(shadowMap, vec3(uv, ref));
+#endif
+}
+
+#if SHADOW_FILTER == SHADOW_FILTER_POISSON
+const int POISSON_TAP_COUNT = 12;
+const vec2 POISSON_DISK[POISSON_TAP_COUNT] = vec2[](
+    vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696, 0.457),
+    vec2(-0.203, 0.621), vec2(0.962, -0.195), vec2(0.473, -0.480),
+    vec2(0.519, 0.767), vec2(0.185, -0.893), vec2(0.507, 0.064),
+    vec2(0.896, 0.412), vec2(-0.322, -0.933), vec2(-0.792, -0.598));
+#endif
+
+// fraction of the filter footprint in shadow
+float FilterShadow(vec2 uv, float ref, float layer) {
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+#if SHADOW_FILTER == SHADOW_FILTER_SINGLE
+    lit = ShadowTap(uv, ref, layer);
+#elif SHADOW_FILTER == SHADOW_FILTER_FOUR_TAP
+    // taps half a texel off the center, their bilinear footprints overlap
+    // into a tent over 3x3 texels at under half the taps of the 3x3 kernel
+    for (int x = 0; x < 2; x++) {
+        for (int y = 0; y < 2; y++)
+            lit += ShadowTap(uv + (vec2(x, y) - 0.5) * texelSize, ref, layer);
+    }
+    lit *= 0.25;
+#elif SHADOW_FILTER == SHADOW_FILTER_POISSON
+    // rotating the disk per pixel trades banding for noise
+    float angle = 6.2831853 * fract(52.9829189 *
+        fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    for (int i = 0; i < POISSON_TAP_COUNT; i++)
+        lit += ShadowTap(uv + rotation * POISSON_DISK[i] * 2.0 * texelSize, ref, layer);
+    lit /= float(POISSON_TAP_COUNT);
+#else
+    for(int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y)
+            lit += ShadowTap(uv + vec2(x, y) * texelSize, ref, layer);
+    }
+    lit /= 9.0;
+#endif
+    return 1.0 - lit;
+}
+
+#ifdef DIRECTIONAL_LIGHT
+// cascaded shadow map, see CascadedShadowMap
+const int MAX_CASCADE_COUNT = 4;
+uniform int cascadeCount;
+uniform mat4 cascadeTransforms[MAX_CASCADE_COUNT];
+// view space depth where each cascade ends
+uniform float cascadeSplits[MAX_CASCADE_COUNT];
+// world size of a shadow texel, 1 / depth range of the cascade
+uniform vec2 cascadeBias[MAX_CASCADE_COUNT];
+// fraction of a cascade cross faded into the next one
+uniform float cascadeBlend;
+
+float CascadeShadow(int cascade, vec3 fragPos, vec3 normal, vec3 lightDir) {
+    // push the lookup off the surface by about a texel of this cascade
+    float texelSize = cascadeBias[cascade].x;
+    float slope = 1.0 - max(dot(normal, lightDir), 0.0);
+    vec3 offsetPos = fragPos + normal * texelSize * (0.5 + slope);
+    // orthographic, no perspective divide
+    vec3 projCoords = (cascadeTransforms[cascade] * vec4(offsetPos, 1.0)).xyz;
+    projCoords = projCoords * 0.5 + 0.5;
+    float currentDepth = projCoords.z - texelSize * cascadeBias[cascade].y;
+    return FilterShadow(projCoords.xy, currentDepth, float(cascade));
+}
+
+float ShadowCalculation(vec3 fragPos, float viewDepth, vec3 normal, vec3 lightDir) {
+    int cascade = cascadeCount;
+    for (int i = cascadeCount - 1; i >= 0; i--) {
+        if (viewDepth < cascadeSplits[i])
+            cascade = i;
+    }
+    if (cascade == cascadeCount)
+        return 0.0;
+
+    float shadow = CascadeShadow(cascade, fragPos, normal, lightDir);
+    // cross fade near the far end of the cascade to hide the seam,
+    // the last one fades out to the unshadowed distance
+    float splitNear = cascade == 0 ? 0.0 : cascadeSplits[cascade - 1];
+    float fraction = (cascadeSplits[cascade] - viewDepth) /
+        (cascadeSplits[cascade] - splitNear);
+    if (fraction < cascadeBlend) {
+        float next = cascade + 1 < cascadeCount ?
+            CascadeShadow(cascade + 1, fragPos, normal, lightDir) : 0.0;
+        shadow = mix(next, shadow, fraction / cascadeBlend);
+    }
+    return shadow;
+}
+#else
+float ShadowCalculation(vec4 fragPosLight, vec3 normal, vec3 lightDir) {
+    // perform perspective divide
+    vec3 projCoords = fragPosLight.xyz / fragPosLight.w;
+    // transform to [0,1] range
+    projCoords = projCoords * 0.5 + 0.5;
+    // get depth of current fragment from light’s perspective
+    float currentDepth = projCoords.z;
+    // check whether current frag pos is in shadow
+    float bias = max(0.02 * (1.0 - dot(normal, lightDir)), 0.001);
+    return FilterShadow(projCoords.xy, currentDepth - bias, 0.0);
+}
+#endif
@@ -0,0 +1,43 @@
+// point light shadows in the tiles of ShadowAtlas, must match Context
+const int MAX_SHADOW_TILES = 48;
+uniform sampler2DShadow shadowAtlas;
+// uv offset in xy and uv scale in zw of every tile
+uniform vec4 shadowTileRects[MAX_SHADOW_TILES];
+// cube face views at the origin, see ShadowAtlas::GetCubeFaceView
+uniform mat4 shadowFaceViews[6];
+// near / far plane of the 90 degree face projections
+uniform vec2 shadowDepthRange;
+
+// 1 if lit, the six faces of the light start at firstTile
+float PointShadow(int firstTile, vec3 lightPos, vec3 fragPos, vec3 normal) {
+    vec3 toFrag = fragPos - lightPos;
+    float dist = length(toFrag);
+    // the faces of a light share one size, a texel covers 2 * d / size
+    float tileTexels = shadowTileRects[firstTile].z * float(textureSize(shadowAtlas, 0).x);
+    float texelSize = 2.0 * dist / tileTexels;
+    toFrag += normal * texelSize;
+
+    vec3 a = abs(toFrag);
+    int axis = a.x >= a.y && a.x >= a.z ? 0 : a.y >= a.z ? 1 : 2;
+    int face = axis * 2 + (toFrag[axis] < 0.0 ? 1 : 0);
+    vec3 p = (shadowFaceViews[face] * vec4(toFrag, 1.0)).xyz;
+    float n = shadowDepthRange.x;
+    float f = shadowDepthRange.y;
+    float d = -p.z - texelSize;
+    float depth = ((f + n) / (f - n) - 2.0 * f * n / ((f - n) * d)) * 0.5 + 0.5;
+
+    // 4 bilinear compare taps, kept inside the tile
+    vec4 rect = shadowTileRects[firstTile + face];
+    vec2 atlasTexel = vec2(1.0 / float(textureSize(shadowAtlas, 0).x));
+    vec2 uv = rect.xy + (p.xy / -p.z * 0.5 + 0.5) * rect.zw;
+    vec2 uvMin = rect.xy + atlasTexel;
+    vec2 uvMax = rect.xy + rect.zw - atlasTexel;
+    float lit = 0.0;
+    for (int x = 0; x < 2; x++) {
+        for (int y = 0; y < 2; y++) {
+            vec2 tap = clamp(uv + (vec2(x, y) - 0.5) * atlasTexel, uvMin, uvMax);
+            lit += texture(shadowAtlas, vec3(tap, depth));
+        }
+    }
+    return lit * 0.25;
+}
@@ -0,0 +1,16 @@
+// diffuse irradiance / pi of the skybox, see SphericalHarmonics
+uniform vec3 shCoefficients[9];
+uniform float shAmbientIntensity;
+
+vec3 IrradianceSH(vec3 n) {
+    vec3 result = shCoefficients[0] * 0.282095;
+    result += shCoefficients[1] * (0.488603 * n.y);
+    result += shCoefficients[2] * (0.488603 * n.z);
+    result += shCoefficients[3] * (0.488603 * n.x);
+    result += shCoefficients[4] * (1.092548 * n.x * n.y);
+    result += shCoefficients[5] * (1.092548 * n.y * n.z);
+    result += shCoefficients[6] * (0.315392 * (3.0 * n.z * n.z - 1.0));
+    result += shCoefficients[7] * (1.092548 * n.x * n.z);
+    result += shCoefficients[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+    return max(result, vec3(0.0));
+}
@@ -1,30 +1,41 @@
 #version 330 core
 
-out float fragColor;
+// r: ambient occlusion, g: view space depth for the bilateral blur / upsample
+out vec2 fragColor;
 
 in vec2 texCoord;
 
-uniform sampler2D gPosition;
+#include "gbuffer.glsl"
+
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D texNoise;
 
 uniform mat4 view;
 uniform mat4 projection;
+uniform mat4 inverseProjection;
 	
 uniform vec2 noiseScale;
 uniform float radius;
+uniform int resolutionScale;
 	
-const int KERNEL_SIZE = 64;
+// KERNEL_SIZE is set per program variant
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 64
+#endif
 const float BIAS = 0.025;
 uniform vec3 samples[KERNEL_SIZE];
 
 
 void main() {
-    vec4 worldPos = texture(gPosition, texCoord);
-    if (worldPos.w <= 0.0f)
+    // fetch the G-buffer texel this (possibly reduced resolution) pixel stands for
+    ivec2 pixel = ivec2(gl_FragCoord.xy) * resolutionScale;
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (IsBackground(depth))
         discard;
-    vec3 fragPos = (view * vec4(worldPos.xyz, 1.0)).xyz;
-    vec3 normal = (view * vec4(texture(gNormal, texCoord).xyz, 0.0)).xyz;
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(gDepth, 0));
+    vec3 fragPos = ReconstructPosition(uv, depth, inverseProjection);
+    vec3 normal = (view * vec4(DecodeNormal(texelFetch(gNormal, pixel, 0).rg), 0.0)).xyz;
     vec3 randomVec = texture(texNoise, texCoord * noiseScale).xyz;
     
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -38,11 +49,12 @@ void main() {
         screenSample.xyz /= screenSample.w;
         screenSample.xyz = screenSample.xyz * 0.5 + 0.5;
     
-        float sampleDepth = (view * texture(gPosition, screenSample.xy)).z;
+        float sampleDepth = ReconstructPosition(screenSample.xy,
+            texture(gDepth, screenSample.xy).r, inverseProjection).z;
         float rangeCheck = smoothstep(0.0, 1.0,
         radius / abs(fragPos.z - sampleDepth));
         occlusion += (sampleDepth >= sample.z + BIAS ? 1.0 : 0.0) * rangeCheck;
     }
 
-    fragColor = 1.0 - occlusion / KERNEL_SIZE;
+    fragColor = vec2(1.0 - occlusion / float(KERNEL_SIZE), -fragPos.z);
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#version 330 core
+
+#include "gbuffer.glsl"
+
+out vec2 fragColor;
+in vec2 texCoord;
+
+uniform sampler2D tex;      // r: ambient occlusion, g: view space depth
+uniform sampler2D gNormal;
+uniform vec2 direction;     // one texel step along the blur axis
+uniform float depthSharpness;
+
+const int BLUR_RADIUS = 4;
+const float WEIGHTS[BLUR_RADIUS + 1] = float[](
+    0.2270270, 0.1945946, 0.1216216, 0.0540540, 0.0162162);
+
+void main() {
+    vec2 center = texture(tex, texCoord).rg;
+    if (center.g <= 0.0) {
+        // background, nothing to blur
+        fragColor = center;
+        return;
+    }
+    vec3 centerNormal = DecodeNormal(texture(gNormal, texCoord).rg);
+
+    float sum = center.r * WEIGHTS[0];
+    float weightSum = WEIGHTS[0];
+    for (int i = 1; i <= BLUR_RADIUS; i++) {
+        for (int side = -1; side <= 1; side += 2) {
+            vec2 uv = texCoord + direction * float(i * side);
+            vec2 tap = texture(tex, uv).rg;
+            vec3 normal = DecodeNormal(texture(gNormal, uv).rg);
+            // do not bleed occlusion across depth discontinuities and creases
+            float depthWeight = exp(-abs(tap.g - center.g) * depthSharpness / center.g);
+            float normalWeight = pow(max(dot(normal, centerNormal), 0.0), 8.0);
+            float weight = WEIGHTS[i] * depthWeight * normalWeight * step(0.0001, tap.g);
+            sum += tap.r * weight;
+            weightSum += weight;
+        }
+    }
+    fragColor = vec2(sum / weightSum, center.g);
+}
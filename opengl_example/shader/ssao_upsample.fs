@@ -0,0 +1,59 @@
+#version 330 core
+
+#include "gbuffer.glsl"
+
+out float fragColor;
+in vec2 texCoord;
+
+uniform sampler2D tex;      // reduced resolution, r: ambient occlusion, g: view space depth
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform mat4 inverseProjection;
+uniform float depthSharpness;
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float hardwareDepth = texelFetch(gDepth, pixel, 0).r;
+    if (IsBackground(hardwareDepth)) {
+        fragColor = 1.0;
+        return;
+    }
+    float depth = -ReconstructPosition(texCoord, hardwareDepth, inverseProjection).z;
+    vec3 normal = DecodeNormal(texelFetch(gNormal, pixel, 0).rg);
+
+    // joint bilateral upsampling: bilinear weights of the 4 nearest low
+    // resolution texels, rejected by depth / normal difference to this pixel
+    vec2 lowSize = vec2(textureSize(tex, 0));
+    vec2 lowPos = texCoord * lowSize - 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = lowPos - floor(lowPos);
+
+    float sum = 0.0;
+    float weightSum = 0.0;
+    float nearestAo = 1.0;
+    float nearestDepthDiff = 1e10;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 coord = clamp(base + offset, ivec2(0), ivec2(lowSize) - 1);
+        vec2 tap = texelFetch(tex, coord, 0).rg;
+        vec3 tapNormal = DecodeNormal(texture(gNormal, (vec2(coord) + 0.5) / lowSize).rg);
+
+        float bilinear =
+            (offset.x == 1 ? f.x : 1.0 - f.x) *
+            (offset.y == 1 ? f.y : 1.0 - f.y);
+        float depthDiff = abs(tap.g - depth);
+        float weight = bilinear *
+            exp(-depthDiff * depthSharpness / depth) *
+            pow(max(dot(tapNormal, normal), 0.0), 8.0) *
+            step(0.0001, tap.g);
+        sum += tap.r * weight;
+        weightSum += weight;
+
+        if (tap.g > 0.0 && depthDiff < nearestDepthDiff) {
+            nearestDepthDiff = depthDiff;
+            nearestAo = tap.r;
+        }
+    }
+    // every tap rejected: fall back to the closest one in depth
+    fragColor = weightSum > 0.0001 ? sum / weightSum : nearestAo;
+}
@@ -0,0 +1,89 @@
+#version 330 core
+out vec4 fragColor;
+in vec2 texCoord;
+
+#include "gbuffer.glsl"
+
+uniform sampler2D hdrColor;  // this frame, jittered
+uniform sampler2D history;   // resolved result of the previous frame
+uniform sampler2D depth;
+#ifdef VELOCITY_BUFFER
+uniform sampler2D velocity;
+#endif
+// jittered, matches the depth buffer
+uniform mat4 inverseViewProjection;
+// without jitter
+uniform mat4 viewProjection;
+uniform mat4 prevViewProjection;
+// weight of the history, 0 drops it
+uniform float historyWeight;
+
+vec3 RgbToYCoCg(vec3 c) {
+    return vec3(
+        dot(c, vec3(0.25, 0.5, 0.25)),
+        dot(c, vec3(0.5, 0.0, -0.5)),
+        dot(c, vec3(-0.25, 0.5, -0.25)));
+}
+
+vec3 YCoCgToRgb(vec3 c) {
+    return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+// screen motion of a point that moves only with the camera
+vec2 CameraVelocity(vec2 uv, float depth) {
+    vec4 worldPos = vec4(ReconstructPosition(uv, depth, inverseViewProjection), 1.0);
+    vec4 current = viewProjection * worldPos;
+    vec4 prev = prevViewProjection * worldPos;
+    return (current.xy / current.w - prev.xy / prev.w) * 0.5;
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 maxPixel = textureSize(hdrColor, 0) - 1;
+
+    // color bounds of the 3x3 neighborhood, and its closest depth whose
+    // motion is used so edges move with the foreground
+    vec3 center = texelFetch(hdrColor, pixel, 0).rgb;
+    vec3 minColor = vec3(1e9);
+    vec3 maxColor = vec3(-1e9);
+    float closestDepth = 1.0;
+    ivec2 closestPixel = pixel;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            ivec2 neighbor = clamp(pixel + ivec2(x, y), ivec2(0), maxPixel);
+            vec3 color = RgbToYCoCg(texelFetch(hdrColor, neighbor, 0).rgb);
+            minColor = min(minColor, color);
+            maxColor = max(maxColor, color);
+            float d = texelFetch(depth, neighbor, 0).r;
+            if (d < closestDepth) {
+                closestDepth = d;
+                closestPixel = neighbor;
+            }
+        }
+    }
+
+    vec2 motion;
+#ifdef VELOCITY_BUFFER
+    // the background writes no velocity
+    if (IsBackground(closestDepth))
+        motion = CameraVelocity(texCoord, closestDepth);
+    else
+        motion = texelFetch(velocity, closestPixel, 0).rg;
+#else
+    motion = CameraVelocity((vec2(closestPixel) + 0.5) / vec2(maxPixel + 1), closestDepth);
+#endif
+    vec2 prevUv = texCoord - motion;
+
+    float weight = historyWeight;
+    if (any(lessThan(prevUv, vec2(0.0))) || any(greaterThan(prevUv, vec2(1.0))))
+        weight = 0.0;
+    // history outside the neighborhood belongs to another surface
+    vec3 prev = RgbToYCoCg(texture(history, prevUv).rgb);
+    prev = YCoCgToRgb(clamp(prev, minColor, maxColor));
+
+    // weighting by inverse luminance keeps bright outliers from flickering
+    float currentWeight = (1.0 - weight) / (1.0 + RgbToYCoCg(center).x);
+    float prevWeight = weight / (1.0 + RgbToYCoCg(prev).x);
+    fragColor = vec4((center * currentWeight + prev * prevWeight) /
+        max(currentWeight + prevWeight, 1e-5), 1.0);
+}
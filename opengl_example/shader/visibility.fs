@@ -0,0 +1,11 @@
+#version 330 core
+
+#include "visibility.glsl"
+
+out uint visibility;
+
+uniform int drawId;
+
+void main() {
+    visibility = (uint(drawId) << TRIANGLE_ID_BITS) | uint(gl_PrimitiveID);
+}
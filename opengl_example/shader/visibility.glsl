@@ -0,0 +1,4 @@
+// visibility buffer texel: draw id in the upper bits, triangle id of
+// that draw in the lower bits. must match VisibilityBuffer::TRIANGLE_ID_BITS
+const uint TRIANGLE_ID_BITS = 22u;
+const uint INVALID_VISIBILITY = 0xffffffffu;
@@ -0,0 +1,120 @@
+#version 330 core
+
+#include "gbuffer.glsl"
+#include "visibility.glsl"
+
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+
+in vec2 texCoord;
+
+uniform usampler2D visibility;
+uniform samplerBuffer vertexData;   // Vertex structs as floats
+uniform usamplerBuffer indexData;
+uniform samplerBuffer drawData;     // 8 texels per draw, see VisibilityBuffer::Init
+uniform int vertexStride;
+uniform mat4 viewProjection;
+uniform vec2 screenSize;
+
+// MATERIAL_COUNT is set per program variant
+#ifndef MATERIAL_COUNT
+#define MATERIAL_COUNT 1
+#endif
+uniform sampler2D materialDiffuse[MATERIAL_COUNT];
+uniform sampler2D materialSpecular[MATERIAL_COUNT];
+
+// sampler arrays can only be indexed by constants in glsl 330
+#define SAMPLE_MATERIAL(i) if (materialSlot == i) { albedo = textureGrad(materialDiffuse[i], uv, uvDx, uvDy).rgb; specular = textureGrad(materialSpecular[i], uv, uvDx, uvDy).r; }
+
+void main() {
+    uint id = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0).r;
+    if (id == INVALID_VISIBILITY)
+        discard;
+    int drawId = int(id >> TRIANGLE_ID_BITS);
+    int triangleId = int(id & ((1u << TRIANGLE_ID_BITS) - 1u));
+
+    int drawBase = drawId * 8;
+    mat4 modelTransform = mat4(
+        texelFetch(drawData, drawBase + 0),
+        texelFetch(drawData, drawBase + 1),
+        texelFetch(drawData, drawBase + 2),
+        texelFetch(drawData, drawBase + 3));
+    mat3 normalMatrix = mat3(
+        texelFetch(drawData, drawBase + 4).xyz,
+        texelFetch(drawData, drawBase + 5).xyz,
+        texelFetch(drawData, drawBase + 6).xyz);
+    vec4 info = texelFetch(drawData, drawBase + 7);
+    int firstIndex = int(floatBitsToUint(info.x));
+    int baseVertex = int(floatBitsToUint(info.y));
+    int materialSlot = int(info.z);
+
+    // fetch the triangle, offsets follow the Vertex struct
+    vec4 clipPos[3];
+    vec3 normals[3];
+    vec2 texCoords[3];
+    for (int i = 0; i < 3; i++) {
+        int index = int(texelFetch(indexData, firstIndex + triangleId * 3 + i).r);
+        int base = (baseVertex + index) * vertexStride;
+        vec3 position = vec3(
+            texelFetch(vertexData, base + 0).r,
+            texelFetch(vertexData, base + 1).r,
+            texelFetch(vertexData, base + 2).r);
+        normals[i] = vec3(
+            texelFetch(vertexData, base + 3).r,
+            texelFetch(vertexData, base + 4).r,
+            texelFetch(vertexData, base + 5).r);
+        texCoords[i] = vec2(
+            texelFetch(vertexData, base + 6).r,
+            texelFetch(vertexData, base + 7).r);
+        clipPos[i] = viewProjection * modelTransform * vec4(position, 1.0);
+    }
+
+    // perspective correct barycentrics at this pixel: the weights divided
+    // by w are linear in ndc, so they and their screen derivatives are
+    // evaluated analytically
+    vec3 invW = 1.0 / vec3(clipPos[0].w, clipPos[1].w, clipPos[2].w);
+    vec2 ndc0 = clipPos[0].xy * invW.x;
+    vec2 ndc1 = clipPos[1].xy * invW.y;
+    vec2 ndc2 = clipPos[2].xy * invW.z;
+    float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    vec3 ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    vec3 ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+
+    vec2 delta = gl_FragCoord.xy / screenSize * 2.0 - 1.0 - ndc0;
+    vec3 weight = vec3(invW.x, 0.0, 0.0) + delta.x * ddx + delta.y * ddy;
+    vec3 weightDx = weight + ddx * (2.0 / screenSize.x);
+    vec3 weightDy = weight + ddy * (2.0 / screenSize.y);
+    vec3 bary = weight / dot(weight, vec3(1.0));
+    vec3 baryDx = weightDx / dot(weightDx, vec3(1.0)) - bary;
+    vec3 baryDy = weightDy / dot(weightDy, vec3(1.0)) - bary;
+
+    mat3x2 uvs = mat3x2(texCoords[0], texCoords[1], texCoords[2]);
+    vec2 uv = uvs * bary;
+    vec2 uvDx = uvs * baryDx;
+    vec2 uvDy = uvs * baryDy;
+    vec3 normal = normalize(normalMatrix * (mat3(normals[0], normals[1], normals[2]) * bary));
+
+    vec3 albedo = vec3(1.0);
+    float specular = 1.0;
+#if MATERIAL_COUNT > 0
+    SAMPLE_MATERIAL(0)
+#endif
+#if MATERIAL_COUNT > 1
+    SAMPLE_MATERIAL(1)
+#endif
+#if MATERIAL_COUNT > 2
+    SAMPLE_MATERIAL(2)
+#endif
+#if MATERIAL_COUNT > 3
+    SAMPLE_MATERIAL(3)
+#endif
+#if MATERIAL_COUNT > 4
+    SAMPLE_MATERIAL(4)
+#endif
+#if MATERIAL_COUNT > 5
+    SAMPLE_MATERIAL(5)
+#endif
+
+    gNormal = EncodeNormal(normal);
+    gAlbedoSpec = vec4(albedo, specular);
+}
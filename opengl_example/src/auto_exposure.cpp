@@ -0,0 +1,72 @@
+#include "auto_exposure.h"
+
+AutoExposureUPtr AutoExposure::Create() {
+    auto autoExposure = AutoExposureUPtr(new AutoExposure());
+    autoExposure->Init();
+    return std::move(autoExposure);
+}
+
+AutoExposure::~AutoExposure() {
+    for (int i = 0; i < RING_SIZE; i++) {
+        if (m_fences[i])
+            glDeleteSync(m_fences[i]);
+    }
+    glDeleteBuffers(RING_SIZE, m_buffers);
+}
+
+void AutoExposure::Init() {
+    glGenBuffers(RING_SIZE, m_buffers);
+    for (int i = 0; i < RING_SIZE; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void AutoExposure::Capture() {
+    // a full ring drops its oldest unread result
+    if (m_fences[m_next])
+        glDeleteSync(m_fences[m_next]);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[m_next]);
+    glReadPixels(0, 0, 1, 1, GL_RED, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_fences[m_next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_captureFrames[m_next] = m_frame;
+    m_next = (m_next + 1) % RING_SIZE;
+}
+
+void AutoExposure::Update(float deltaTime, float adaptationRate) {
+    // newest first, a finished copy makes every older one obsolete
+    for (int i = 1; i <= RING_SIZE; i++) {
+        int index = (m_next - i + RING_SIZE) % RING_SIZE;
+        if (!m_fences[index])
+            continue;
+        auto status = glClientWaitSync(m_fences[index], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[index]);
+        auto data = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+            sizeof(float), GL_MAP_READ_BIT);
+        if (data) {
+            if (std::isfinite(*data) && *data > 0.0f)
+                m_averageLuminance = *data;
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        m_latency = (int)(m_frame - m_captureFrames[index]);
+        for (int j = i; j <= RING_SIZE; j++) {
+            int older = (m_next - j + RING_SIZE) % RING_SIZE;
+            if (m_fences[older]) {
+                glDeleteSync(m_fences[older]);
+                m_fences[older] = nullptr;
+            }
+        }
+        break;
+    }
+    m_frame++;
+
+    // adapt in log space, brightening and darkening at the same pace
+    float t = 1.0f - expf(-adaptationRate * deltaTime);
+    m_adaptedLuminance = exp2f(glm::mix(log2f(m_adaptedLuminance),
+        log2f(m_averageLuminance), t));
+}
@@ -0,0 +1,44 @@
+#ifndef __AUTO_EXPOSURE_H__
+#define __AUTO_EXPOSURE_H__
+
+#include "common.h"
+
+// exposure that follows the average scene luminance the gpu computes.
+// the 1x1 result is copied into a ring of pixel buffers and read a few
+// frames later once its fence has passed, so the cpu never waits
+CLASS_PTR(AutoExposure)
+class AutoExposure {
+public:
+    static AutoExposureUPtr Create();
+    ~AutoExposure();
+
+    // queues a copy of the red channel of pixel (0, 0) of the bound read
+    // framebuffer, a float average luminance
+    void Capture();
+    // reads the newest finished copy and moves the exposure towards it,
+    // adaptationRate is how fast the gap closes, in 1 / seconds
+    void Update(float deltaTime, float adaptationRate);
+
+    float GetAverageLuminance() const { return m_averageLuminance; }
+    // maps the average luminance to middle gray
+    float GetExposure() const { return MIDDLE_GRAY / m_adaptedLuminance; }
+    // frames between capture and readback of the latest result
+    int GetLatency() const { return m_latency; }
+
+private:
+    AutoExposure() {}
+    void Init();
+
+    static constexpr int RING_SIZE = 3;
+    static constexpr float MIDDLE_GRAY = 0.18f;
+    uint32_t m_buffers[RING_SIZE] { 0, };
+    GLsync m_fences[RING_SIZE] { nullptr, };
+    uint32_t m_captureFrames[RING_SIZE] { 0, };
+    int m_next { 0 };
+    uint32_t m_frame { 0 };
+    int m_latency { 0 };
+    float m_averageLuminance { MIDDLE_GRAY };
+    float m_adaptedLuminance { MIDDLE_GRAY };
+};
+
+#endif // __AUTO_EXPOSURE_H__
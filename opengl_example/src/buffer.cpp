@@ -18,6 +18,13 @@ void Buffer::Bind() const {
     glBindBuffer(m_bufferType, m_buffer);
 }
 
+void Buffer::GetData(void* data) const {
+    // the copy binding point leaves the vertex array state alone
+    glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, m_stride * m_count, data);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
 bool Buffer::Init(uint32_t bufferType, uint32_t usage,
     const void* data, size_t stride, size_t count) {
     m_bufferType = bufferType;
@@ -15,6 +15,8 @@ public:
     size_t GetStride() const { return m_stride; }
     size_t GetCount() const { return m_count; }
     void Bind() const;
+    // copies the whole buffer back to the cpu, GetStride() * GetCount() bytes
+    void GetData(void* data) const;
 
 private:
     Buffer() {}
@@ -0,0 +1,376 @@
+#include "bvh.h"
+#include <algorithm>
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const int BIN_COUNT = 12;
+const int MAX_LEAF_SIZE = 4;
+// the traversal stack holds one sibling per level plus the two children
+// of the deepest inner node, nodes this deep stay leaves so it fits
+const int TRAVERSAL_STACK_SIZE = 64;
+const int MAX_DEPTH = TRAVERSAL_STACK_SIZE - 1;
+const float TRIANGLE_EPSILON = 1e-7f;
+
+struct Bounds {
+    glm::vec3 min { glm::vec3(std::numeric_limits<float>::max()) };
+    glm::vec3 max { glm::vec3(-std::numeric_limits<float>::max()) };
+
+    void Grow(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void Grow(const Bounds& b) {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+    float Area() const {
+        auto e = max - min;
+        return e.x > 0.0f ? 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x) : 0.0f;
+    }
+};
+
+// entry distance into a box, infinity if missed within maxDistance
+float IntersectBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+    const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance) {
+    auto t1 = (boundsMin - origin) * invDirection;
+    auto t2 = (boundsMax - origin) * invDirection;
+    auto tMin = glm::min(t1, t2);
+    auto tMax = glm::max(t1, t2);
+    float tNear = std::max(std::max(tMin.x, tMin.y), tMin.z);
+    float tFar = std::min(std::min(tMax.x, tMax.y), tMax.z);
+    return tNear <= tFar && tFar >= 0.0f && tNear < maxDistance ?
+        tNear : std::numeric_limits<float>::max();
+}
+
+glm::vec3 SafeInverse(const glm::vec3& d) {
+    auto Inverse = [](float x) {
+        return 1.0f / (fabsf(x) > 1e-12f ? x : (x < 0.0f ? -1e-12f : 1e-12f));
+    };
+    return glm::vec3(Inverse(d.x), Inverse(d.y), Inverse(d.z));
+}
+
+}
+
+BvhUPtr Bvh::Build(const std::vector<glm::vec3>& positions) {
+    auto bvh = BvhUPtr(new Bvh());
+    bvh->Init(positions);
+    return std::move(bvh);
+}
+
+void Bvh::Init(const std::vector<glm::vec3>& positions) {
+    int triangleCount = (int)(positions.size() / 3);
+    std::vector<Bounds> triangleBounds(triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+    std::vector<int> order(triangleCount);
+    for (int i = 0; i < triangleCount; i++) {
+        for (int k = 0; k < 3; k++)
+            triangleBounds[i].Grow(positions[i * 3 + k]);
+        centroids[i] = (triangleBounds[i].min + triangleBounds[i].max) * 0.5f;
+        order[i] = i;
+    }
+
+    m_nodes.clear();
+    m_nodes.reserve(std::max(triangleCount * 2, 1));
+    m_nodes.push_back(Node());
+    m_nodes[0].first = 0;
+    m_nodes[0].count = triangleCount;
+    // nodes waiting to be split and their depth
+    std::vector<std::pair<int, int>> stack = { { 0, 0 } };
+    while (!stack.empty()) {
+        auto [nodeIndex, depth] = stack.back();
+        stack.pop_back();
+        int first = m_nodes[nodeIndex].first;
+        int count = m_nodes[nodeIndex].count;
+
+        Bounds bounds, centroidBounds;
+        for (int i = first; i < first + count; i++) {
+            bounds.Grow(triangleBounds[order[i]]);
+            centroidBounds.Grow(centroids[order[i]]);
+        }
+        m_nodes[nodeIndex].boundsMin = bounds.min;
+        m_nodes[nodeIndex].boundsMax = bounds.max;
+        // e.g. many coincident centroids split by a poor heuristic
+        if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH)
+            continue;
+
+        // binned sah over all three axes
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        int bestSplit = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+            if (extent <= 0.0f)
+                continue;
+            Bounds bins[BIN_COUNT];
+            int binCounts[BIN_COUNT] = {};
+            float scale = (float)BIN_COUNT / extent;
+            for (int i = first; i < first + count; i++) {
+                int bin = std::min((int)((centroids[order[i]][axis] -
+                    centroidBounds.min[axis]) * scale), BIN_COUNT - 1);
+                bins[bin].Grow(triangleBounds[order[i]]);
+                binCounts[bin]++;
+            }
+            // sweep from the right to know the right side of every split
+            float rightAreas[BIN_COUNT];
+            int rightCounts[BIN_COUNT];
+            Bounds right;
+            int rightCount = 0;
+            for (int b = BIN_COUNT - 1; b > 0; b--) {
+                right.Grow(bins[b]);
+                rightCount += binCounts[b];
+                rightAreas[b] = right.Area();
+                rightCounts[b] = rightCount;
+            }
+            Bounds left;
+            int leftCount = 0;
+            for (int b = 0; b < BIN_COUNT - 1; b++) {
+                left.Grow(bins[b]);
+                leftCount += binCounts[b];
+                if (leftCount == 0 || rightCounts[b + 1] == 0)
+                    continue;
+                float cost = left.Area() * leftCount + rightAreas[b + 1] * rightCounts[b + 1];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b + 1;
+                }
+            }
+        }
+        // a leaf is cheaper than any split, or all centroids coincide
+        if (bestAxis < 0 || bestCost >= bounds.Area() * count)
+            continue;
+
+        float extent = centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis];
+        float scale = (float)BIN_COUNT / extent;
+        auto middle = std::partition(order.begin() + first, order.begin() + first + count,
+            [&](int triangle) {
+                int bin = std::min((int)((centroids[triangle][bestAxis] -
+                    centroidBounds.min[bestAxis]) * scale), BIN_COUNT - 1);
+                return bin < bestSplit;
+            });
+        int leftCount = (int)(middle - (order.begin() + first));
+
+        int leftIndex = (int)m_nodes.size();
+        Node leftNode, rightNode;
+        leftNode.first = first;
+        leftNode.count = leftCount;
+        rightNode.first = first + leftCount;
+        rightNode.count = count - leftCount;
+        m_nodes.push_back(leftNode);
+        m_nodes.push_back(rightNode);
+        m_nodes[nodeIndex].first = leftIndex;
+        m_nodes[nodeIndex].count = 0;
+        stack.push_back({ leftIndex, depth + 1 });
+        stack.push_back({ leftIndex + 1, depth + 1 });
+    }
+
+    m_triangles.resize(triangleCount);
+    for (int i = 0; i < triangleCount; i++) {
+        auto& triangle = m_triangles[i];
+        int index = order[i];
+        triangle.v0 = positions[index * 3];
+        triangle.edge1 = positions[index * 3 + 1] - triangle.v0;
+        triangle.edge2 = positions[index * 3 + 2] - triangle.v0;
+        triangle.index = index;
+    }
+}
+
+Bvh::Hit Bvh::Intersect(const Ray& ray) const {
+    Hit hit;
+    if (m_triangles.empty())
+        return hit;
+    auto invDirection = SafeInverse(ray.direction);
+    float maxDistance = ray.maxDistance;
+    int stack[TRAVERSAL_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        auto& node = m_nodes[stack[--stackSize]];
+        if (IntersectBounds(node.boundsMin, node.boundsMax,
+            ray.origin, invDirection, maxDistance) == std::numeric_limits<float>::max())
+            continue;
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                auto& triangle = m_triangles[i];
+                auto p = glm::cross(ray.direction, triangle.edge2);
+                float det = glm::dot(triangle.edge1, p);
+                if (fabsf(det) < TRIANGLE_EPSILON)
+                    continue;
+                float invDet = 1.0f / det;
+                auto s = ray.origin - triangle.v0;
+                float u = glm::dot(s, p) * invDet;
+                if (u < 0.0f || u > 1.0f)
+                    continue;
+                auto q = glm::cross(s, triangle.edge1);
+                float v = glm::dot(ray.direction, q) * invDet;
+                if (v < 0.0f || u + v > 1.0f)
+                    continue;
+                float t = glm::dot(triangle.edge2, q) * invDet;
+                if (t > 0.0f && t < maxDistance) {
+                    maxDistance = t;
+                    hit.distance = t;
+                    hit.triangle = triangle.index;
+                }
+            }
+            continue;
+        }
+        // visit the nearer child first so the far one is likely culled
+        auto& left = m_nodes[node.first];
+        auto& right = m_nodes[node.first + 1];
+        float leftDistance = IntersectBounds(left.boundsMin, left.boundsMax,
+            ray.origin, invDirection, maxDistance);
+        float rightDistance = IntersectBounds(right.boundsMin, right.boundsMax,
+            ray.origin, invDirection, maxDistance);
+        bool leftFirst = leftDistance <= rightDistance;
+        assert(stackSize + 2 <= TRAVERSAL_STACK_SIZE);
+        stack[stackSize++] = leftFirst ? node.first + 1 : node.first;
+        stack[stackSize++] = leftFirst ? node.first : node.first + 1;
+    }
+    return hit;
+}
+
+void Bvh::IntersectPacket(const Ray* rays, Hit* hits) const {
+#ifdef BVH_USE_SSE
+    for (int i = 0; i < PACKET_SIZE; i++)
+        hits[i] = Hit();
+    if (m_triangles.empty())
+        return;
+
+    // the packet in structure of arrays layout, one ray per lane
+    __m128 origin[3], direction[3], invDirection[3];
+    for (int k = 0; k < 3; k++) {
+        origin[k] = _mm_set_ps(rays[3].origin[k], rays[2].origin[k],
+            rays[1].origin[k], rays[0].origin[k]);
+        direction[k] = _mm_set_ps(rays[3].direction[k], rays[2].direction[k],
+            rays[1].direction[k], rays[0].direction[k]);
+    }
+    glm::vec3 inverses[PACKET_SIZE];
+    for (int i = 0; i < PACKET_SIZE; i++)
+        inverses[i] = SafeInverse(rays[i].direction);
+    for (int k = 0; k < 3; k++) {
+        invDirection[k] = _mm_set_ps(inverses[3][k], inverses[2][k],
+            inverses[1][k], inverses[0][k]);
+    }
+    __m128 maxDistance = _mm_set_ps(rays[3].maxDistance, rays[2].maxDistance,
+        rays[1].maxDistance, rays[0].maxDistance);
+    __m128i triangleIndex = _mm_set1_epi32(-1);
+    auto zero = _mm_setzero_ps();
+    auto one = _mm_set1_ps(1.0f);
+
+    // lanes that hit the box, entry distances in tNear
+    auto IntersectNode = [&](const Node& node, __m128& tNear) {
+        __m128 tMin = zero, tMax = maxDistance;
+        for (int k = 0; k < 3; k++) {
+            auto t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin[k]), origin[k]),
+                invDirection[k]);
+            auto t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax[k]), origin[k]),
+                invDirection[k]);
+            tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+            tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+        }
+        tNear = tMin;
+        return _mm_movemask_ps(_mm_cmple_ps(tMin, tMax));
+    };
+    auto MinLane = [](__m128 value, int mask) {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, value);
+        float result = std::numeric_limits<float>::max();
+        for (int i = 0; i < 4; i++) {
+            if (mask & (1 << i))
+                result = std::min(result, lanes[i]);
+        }
+        return result;
+    };
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        auto& node = m_nodes[stack[--stackSize]];
+        __m128 tNear;
+        if (!IntersectNode(node, tNear))
+            continue;
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                auto& triangle = m_triangles[i];
+                __m128 e1[3], e2[3], s[3], p[3], q[3];
+                for (int k = 0; k < 3; k++) {
+                    e1[k] = _mm_set1_ps(triangle.edge1[k]);
+                    e2[k] = _mm_set1_ps(triangle.edge2[k]);
+                    s[k] = _mm_sub_ps(origin[k], _mm_set1_ps(triangle.v0[k]));
+                }
+                auto Cross = [](const __m128* a, const __m128* b, __m128* out) {
+                    out[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+                    out[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+                    out[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+                };
+                auto Dot = [](const __m128* a, const __m128* b) {
+                    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]),
+                        _mm_mul_ps(a[1], b[1])), _mm_mul_ps(a[2], b[2]));
+                };
+                Cross(direction, e2, p);
+                auto det = Dot(e1, p);
+                auto invDet = _mm_div_ps(one, det);
+                auto u = _mm_mul_ps(Dot(s, p), invDet);
+                Cross(s, e1, q);
+                auto v = _mm_mul_ps(Dot(direction, q), invDet);
+                auto t = _mm_mul_ps(Dot(e2, q), invDet);
+                auto absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+                auto mask = _mm_and_ps(
+                    _mm_and_ps(_mm_cmpge_ps(absDet, _mm_set1_ps(TRIANGLE_EPSILON)),
+                        _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero))),
+                    _mm_and_ps(_mm_cmple_ps(_mm_add_ps(u, v), one),
+                        _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, maxDistance))));
+                if (!_mm_movemask_ps(mask))
+                    continue;
+                maxDistance = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, maxDistance));
+                auto maskInt = _mm_castps_si128(mask);
+                triangleIndex = _mm_or_si128(
+                    _mm_and_si128(maskInt, _mm_set1_epi32(triangle.index)),
+                    _mm_andnot_si128(maskInt, triangleIndex));
+            }
+            continue;
+        }
+        // nearer child first, judged by the closest active lane
+        auto& left = m_nodes[node.first];
+        auto& right = m_nodes[node.first + 1];
+        __m128 leftNear, rightNear;
+        int leftMask = IntersectNode(left, leftNear);
+        int rightMask = IntersectNode(right, rightNear);
+        bool leftFirst = MinLane(leftNear, leftMask) <= MinLane(rightNear, rightMask);
+        assert(stackSize + 2 <= TRAVERSAL_STACK_SIZE);
+        if (leftFirst) {
+            if (rightMask)
+                stack[stackSize++] = node.first + 1;
+            if (leftMask)
+                stack[stackSize++] = node.first;
+        }
+        else {
+            if (leftMask)
+                stack[stackSize++] = node.first;
+            if (rightMask)
+                stack[stackSize++] = node.first + 1;
+        }
+    }
+
+    alignas(16) float distances[4];
+    alignas(16) int32_t indices[4];
+    _mm_store_ps(distances, maxDistance);
+    _mm_store_si128((__m128i*)indices, triangleIndex);
+    for (int i = 0; i < PACKET_SIZE; i++) {
+        if (indices[i] >= 0) {
+            hits[i].distance = distances[i];
+            hits[i].triangle = indices[i];
+        }
+    }
+#else
+    for (int i = 0; i < PACKET_SIZE; i++)
+        hits[i] = Intersect(rays[i]);
+#endif
+}
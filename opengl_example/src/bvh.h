@@ -0,0 +1,60 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include "common.h"
+
+// bounding volume hierarchy over world space triangles, split by the
+// surface area heuristic. rays are traced one at a time or as packets of
+// PACKET_SIZE that walk the tree together, four lanes per SSE register
+CLASS_PTR(Bvh)
+class Bvh {
+public:
+    static constexpr int PACKET_SIZE = 4;
+
+    struct Ray {
+        glm::vec3 origin { glm::vec3(0.0f) };
+        glm::vec3 direction { glm::vec3(0.0f, 0.0f, 1.0f) };
+        float maxDistance { std::numeric_limits<float>::max() };
+    };
+    struct Hit {
+        float distance { std::numeric_limits<float>::max() };
+        // index of the triangle passed to Build(), -1 on a miss
+        int triangle { -1 };
+    };
+
+    // three positions per triangle
+    static BvhUPtr Build(const std::vector<glm::vec3>& positions);
+
+    Hit Intersect(const Ray& ray) const;
+    // closest hits of PACKET_SIZE rays
+    void IntersectPacket(const Ray* rays, Hit* hits) const;
+
+    int GetNodeCount() const { return (int)m_nodes.size(); }
+    int GetTriangleCount() const { return (int)m_triangles.size(); }
+
+private:
+    Bvh() {}
+    void Init(const std::vector<glm::vec3>& positions);
+
+    struct Node {
+        glm::vec3 boundsMin;
+        // first child for inner nodes, the right one follows it.
+        // first triangle for leaves
+        int first { 0 };
+        glm::vec3 boundsMax;
+        // 0 for inner nodes
+        int count { 0 };
+    };
+    // edges precomputed for the Moller-Trumbore test
+    struct Triangle {
+        glm::vec3 v0;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+        int index { 0 };
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Triangle> m_triangles;
+};
+
+#endif // __BVH_H__
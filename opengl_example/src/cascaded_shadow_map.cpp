@@ -0,0 +1,243 @@
+#include "cascaded_shadow_map.h"
+#include <limits>
+
+CascadedShadowMapUPtr CascadedShadowMap::Create(int resolution, int cascadeCount) {
+    auto shadowMap = CascadedShadowMapUPtr(new CascadedShadowMap());
+    if (!shadowMap->Init(resolution, cascadeCount))
+        return nullptr;
+    return std::move(shadowMap);
+}
+
+CascadedShadowMap::~CascadedShadowMap() {
+    for (auto& cascade : m_cascades) {
+        if (cascade.framebuffer)
+            glDeleteFramebuffers(1, &cascade.framebuffer);
+        if (cascade.staticFramebuffer)
+            glDeleteFramebuffers(1, &cascade.staticFramebuffer);
+    }
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+    if (m_staticTexture)
+        glDeleteTextures(1, &m_staticTexture);
+}
+
+static uint32_t CreateDepthArray(int resolution, int layerCount) {
+    uint32_t texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24,
+        resolution, resolution, layerCount, 0,
+        GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    auto borderColor = glm::vec4(1.0f);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR,
+        glm::value_ptr(borderColor));
+    return texture;
+}
+
+static bool CreateLayerFramebuffer(uint32_t texture, int layer, uint32_t* framebuffer) {
+    glGenFramebuffers(1, framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, *framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        SPDLOG_ERROR("failed to complete cascade framebuffer: {:x}", status);
+        return false;
+    }
+    return true;
+}
+
+bool CascadedShadowMap::Init(int resolution, int cascadeCount) {
+    if (cascadeCount < 1 || cascadeCount > MAX_CASCADE_COUNT) {
+        SPDLOG_ERROR("invalid cascade count: {}", cascadeCount);
+        return false;
+    }
+    m_resolution = resolution;
+    m_cascades.resize(cascadeCount);
+
+    m_texture = CreateDepthArray(resolution, cascadeCount);
+    // sampled through sampler2DArrayShadow with bilinear hardware comparison
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    m_staticTexture = CreateDepthArray(resolution, cascadeCount);
+    for (int i = 0; i < cascadeCount; i++) {
+        auto& cascade = m_cascades[i];
+        if (!CreateLayerFramebuffer(m_texture, i, &cascade.framebuffer) ||
+            !CreateLayerFramebuffer(m_staticTexture, i, &cascade.staticFramebuffer)) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return false;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+void CascadedShadowMap::Update(const glm::mat4& view, float fovy, float aspect,
+    float nearPlane, float farPlane, float lambda,
+    const glm::vec3& lightDirection,
+    const glm::vec3& sceneMin, const glm::vec3& sceneMax) {
+    // the light space rotation is fixed, so snapping the cascade origin
+    // to whole texels keeps shadow edges from crawling when the camera moves
+    auto direction = glm::normalize(lightDirection);
+    auto up = fabsf(direction.y) > 0.99f ?
+        glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    auto lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+    // depth range covering every caster
+    float minZ = std::numeric_limits<float>::max();
+    float maxZ = -std::numeric_limits<float>::max();
+    for (int i = 0; i < 8; i++) {
+        auto corner = glm::vec3(
+            i & 1 ? sceneMax.x : sceneMin.x,
+            i & 2 ? sceneMax.y : sceneMin.y,
+            i & 4 ? sceneMax.z : sceneMin.z);
+        float z = (lightView * glm::vec4(corner, 1.0f)).z;
+        minZ = std::min(minZ, z);
+        maxZ = std::max(maxZ, z);
+    }
+
+    auto inverseView = glm::inverse(view);
+    float tanY = tanf(fovy * 0.5f);
+    float tanX = tanY * aspect;
+    int count = (int)m_cascades.size();
+    float splitNear = nearPlane;
+    for (int i = 0; i < count; i++) {
+        // practical split scheme, between uniform and logarithmic
+        float t = (float)(i + 1) / (float)count;
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        float logSplit = nearPlane * powf(farPlane / nearPlane, t);
+        float splitFar = glm::mix(uniformSplit, logSplit, lambda);
+
+        // bounding sphere of the frustum slice. its size does not depend on
+        // the camera orientation, so neither does the texel size
+        glm::vec3 corners[8];
+        auto center = glm::vec3(0.0f);
+        for (int c = 0; c < 8; c++) {
+            float d = c & 4 ? splitFar : splitNear;
+            corners[c] = glm::vec3(
+                (c & 1 ? tanX : -tanX) * d,
+                (c & 2 ? tanY : -tanY) * d,
+                -d);
+            center += corners[c] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (auto& corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        radius = ceilf(radius * 16.0f) / 16.0f;
+
+        auto lightCenter = lightView * inverseView * glm::vec4(center, 1.0f);
+        float texelSize = 2.0f * radius / (float)m_resolution;
+        lightCenter.x = floorf(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = floorf(lightCenter.y / texelSize) * texelSize;
+
+        auto projection = glm::ortho(
+            lightCenter.x - radius, lightCenter.x + radius,
+            lightCenter.y - radius, lightCenter.y + radius,
+            -maxZ, -minZ);
+        auto& fit = m_cascades[i].pendingFit;
+        fit.viewProjection = projection * lightView;
+        fit.splitDepth = splitFar;
+        fit.texelSize = texelSize;
+        fit.depthRange = std::max(maxZ - minZ, 0.001f);
+        splitNear = splitFar;
+    }
+
+    // the fit only changes in whole texels, an unchanged one keeps its cache
+    for (auto& cascade : m_cascades) {
+        cascade.stale = cascade.stale ||
+            cascade.pendingFit.viewProjection != cascade.fit.viewProjection ||
+            cascade.pendingFit.splitDepth != cascade.fit.splitDepth;
+    }
+    auto Apply = [](Cascade& cascade) {
+        cascade.fit = cascade.pendingFit;
+        cascade.stale = false;
+        cascade.fitted = true;
+        cascade.staticValid = false;
+    };
+    // the first cascade covers most of the screen and always catches up,
+    // as does any cascade that has never been fitted
+    for (int i = 0; i < count; i++) {
+        if (m_cascades[i].stale && (i == 0 || !m_cascades[i].fitted))
+            Apply(m_cascades[i]);
+    }
+    for (int i = 0; i < count - 1; i++) {
+        int index = 1 + (m_nextSlicedCascade - 1 + i) % (count - 1);
+        if (!m_cascades[index].stale)
+            continue;
+        Apply(m_cascades[index]);
+        if (m_timeSlicing) {
+            m_nextSlicedCascade = index + 1 < count ? index + 1 : 1;
+            break;
+        }
+    }
+}
+
+void CascadedShadowMap::Invalidate() {
+    for (auto& cascade : m_cascades)
+        cascade.staticValid = false;
+}
+
+void CascadedShadowMap::BeginStatic(int cascade) {
+    auto& c = m_cascades[cascade];
+    glBindFramebuffer(GL_FRAMEBUFFER, c.staticFramebuffer);
+    glViewport(0, 0, m_resolution, m_resolution);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    c.staticValid = true;
+    c.upToDate = false;
+}
+
+bool CascadedShadowMap::BeginDynamic(int cascade, bool hasDynamicCasters) {
+    auto& c = m_cascades[cascade];
+    if (c.upToDate && !hasDynamicCasters && !c.dynamicDrawn)
+        return false;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, c.staticFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, c.framebuffer);
+    glBlitFramebuffer(0, 0, m_resolution, m_resolution,
+        0, 0, m_resolution, m_resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, c.framebuffer);
+    glViewport(0, 0, m_resolution, m_resolution);
+    c.upToDate = true;
+    c.dynamicDrawn = hasDynamicCasters;
+    return true;
+}
+
+bool CascadedShadowMap::IsVisible(int cascade,
+    const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+    // the depth range already covers the whole scene, only x / y can cull
+    auto& viewProjection = m_cascades[cascade].fit.viewProjection;
+    auto clipMin = glm::vec2(std::numeric_limits<float>::max());
+    auto clipMax = glm::vec2(-std::numeric_limits<float>::max());
+    for (int i = 0; i < 8; i++) {
+        auto corner = glm::vec3(
+            i & 1 ? boundsMax.x : boundsMin.x,
+            i & 2 ? boundsMax.y : boundsMin.y,
+            i & 4 ? boundsMax.z : boundsMin.z);
+        auto clip = glm::vec2(viewProjection * glm::vec4(corner, 1.0f));
+        clipMin = glm::min(clipMin, clip);
+        clipMax = glm::max(clipMax, clip);
+    }
+    return clipMin.x <= 1.0f && clipMax.x >= -1.0f &&
+        clipMin.y <= 1.0f && clipMax.y >= -1.0f;
+}
+
+void CascadedShadowMap::SetToProgram(const Program* program, int textureUnit) const {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+    program->SetUniform("shadowMap", textureUnit);
+    program->SetUniform("cascadeCount", (int)m_cascades.size());
+    for (size_t i = 0; i < m_cascades.size(); i++) {
+        auto& fit = m_cascades[i].fit;
+        program->SetUniform(fmt::format("cascadeTransforms[{}]", i), fit.viewProjection);
+        program->SetUniform(fmt::format("cascadeSplits[{}]", i), fit.splitDepth);
+        program->SetUniform(fmt::format("cascadeBias[{}]", i),
+            glm::vec2(fit.texelSize, 1.0f / fit.depthRange));
+    }
+}
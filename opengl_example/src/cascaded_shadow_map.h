@@ -0,0 +1,86 @@
+#ifndef __CASCADED_SHADOW_MAP_H__
+#define __CASCADED_SHADOW_MAP_H__
+
+#include "common.h"
+#include "program.h"
+
+// directional light shadow split along the view depth. every cascade is a
+// layer of one depth texture array, fitted around its slice of the view frustum.
+// like ShadowMap, static casters are cached per cascade and only redrawn
+// when the cascade moved. with time slicing, cascades past the first take
+// turns to catch up with the camera and keep their old fit until then
+CLASS_PTR(CascadedShadowMap)
+class CascadedShadowMap {
+public:
+    // must match shadow.glsl
+    static constexpr int MAX_CASCADE_COUNT = 4;
+
+    static CascadedShadowMapUPtr Create(int resolution, int cascadeCount);
+    ~CascadedShadowMap();
+
+    // fit the cascades to the part of the view frustum between nearPlane and farPlane.
+    // lambda blends uniform (0) and logarithmic (1) split distances,
+    // sceneMin / sceneMax bound every shadow caster
+    void Update(const glm::mat4& view, float fovy, float aspect,
+        float nearPlane, float farPlane, float lambda,
+        const glm::vec3& lightDirection,
+        const glm::vec3& sceneMin, const glm::vec3& sceneMax);
+
+    void SetTimeSlicing(bool timeSlicing) { m_timeSlicing = timeSlicing; }
+    // a static object moved
+    void Invalidate();
+
+    bool IsStaticValid(int cascade) const { return m_cascades[cascade].staticValid; }
+    // bind and clear the static cache of a cascade, draw its static casters after this
+    void BeginStatic(int cascade);
+    // copy the cache into the cascade layer and bind it for the dynamic
+    // casters. false if the layer is already up to date
+    bool BeginDynamic(int cascade, bool hasDynamicCasters);
+    // whether a world space box can cast a shadow into the cascade
+    bool IsVisible(int cascade,
+        const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+    void SetToProgram(const Program* program, int textureUnit) const;
+
+    uint32_t Get() const { return m_texture; }
+    int GetResolution() const { return m_resolution; }
+    int GetCascadeCount() const { return (int)m_cascades.size(); }
+    const glm::mat4& GetViewProjection(int cascade) const {
+        return m_cascades[cascade].fit.viewProjection;
+    }
+    // view space depth where the cascade ends
+    float GetSplitDepth(int cascade) const { return m_cascades[cascade].fit.splitDepth; }
+
+private:
+    CascadedShadowMap() {}
+    bool Init(int resolution, int cascadeCount);
+
+    struct Fit {
+        glm::mat4 viewProjection { glm::mat4(1.0f) };
+        float splitDepth { 0.0f };
+        // world size of a shadow texel and depth range, for the bias
+        float texelSize { 0.0f };
+        float depthRange { 1.0f };
+    };
+    struct Cascade {
+        // the fit rendered and sampled, and the one Update() asked for
+        Fit fit;
+        Fit pendingFit;
+        bool stale { true };
+        bool fitted { false };
+        bool staticValid { false };
+        // the layer holds the current static cache
+        bool upToDate { false };
+        bool dynamicDrawn { false };
+        uint32_t framebuffer { 0 };
+        uint32_t staticFramebuffer { 0 };
+    };
+
+    int m_resolution { 0 };
+    uint32_t m_texture { 0 };
+    uint32_t m_staticTexture { 0 };
+    std::vector<Cascade> m_cascades;
+    bool m_timeSlicing { true };
+    int m_nextSlicedCascade { 1 };
+};
+
+#endif // __CASCADED_SHADOW_MAP_H__
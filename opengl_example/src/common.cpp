@@ -1,4 +1,5 @@
 #include "common.h"
+#include <array>
 #include <fstream>
 #include <sstream>
 
@@ -32,4 +33,27 @@ glm::vec3 GetAttenuationCoeff(float distance) {
 
 float RandomRange(float minValue, float maxValue) {
     return ((float)rand() / (float)RAND_MAX) * (maxValue - minValue) + minValue;
-}
\ No newline at end of file
+}
+
+float Halton(int index, int base) {
+    float result = 0.0f;
+    float fraction = 1.0f;
+    while (index > 0) {
+        fraction /= (float)base;
+        result += fraction * (float)(index % base);
+        index /= base;
+    }
+    return result;
+}
+
+float SrgbToLinear(uint8_t value) {
+    static const auto table = []() {
+        std::array<float, 256> table;
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            table[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+    return table[value];
+}
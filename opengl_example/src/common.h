@@ -20,5 +20,9 @@ using klassName ## WPtr = std::weak_ptr<klassName>;
 std::optional<std::string> LoadTextFile(const std::string& filename);
 glm::vec3 GetAttenuationCoeff(float distance);
 float RandomRange(float minValue = 0.0f, float maxValue = 1.0f);
+// index-th element of the radical inverse sequence in the given base, in [0, 1)
+float Halton(int index, int base);
+// decodes an srgb encoded 8 bit channel, through a table
+float SrgbToLinear(uint8_t value);
 
 #endif // __COMMON_H__
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "context.h"
 #include "image.h"
+#include "parallel.h"
 #include <imgui.h>
+#include <algorithm>
+#include <limits>
 
 ContextUPtr Context::Create() {
     auto context = ContextUPtr(new Context());
@@ -33,26 +36,93 @@ void Context::ProcessInput(GLFWwindow* window) {
 }
 
 void Context::Reshape(int width, int height) {
+    // glfw reports every step of an interactive resize, targets are
+    // reallocated once the size has settled, see ApplyResize()
+    m_windowWidth = width;
+    m_windowHeight = height;
+    m_resizeTime = glfwGetTime();
+}
+
+bool Context::ApplyResize() {
+    if (m_windowWidth == 0 || m_windowHeight == 0)
+        return false;
+    float scale = m_useDynamicResolution ? m_dynamicResolution->GetScale() : 1.0f;
+    int width = std::max((int)((float)m_windowWidth * scale + 0.5f), 1);
+    int height = std::max((int)((float)m_windowHeight * scale + 0.5f), 1);
+    if (m_width == width && m_height == height && m_depthPyramid)
+        return true;
+    // keep rendering at the old size, stretched, until the window stops changing
+    if (m_depthPyramid && glfwGetTime() - m_resizeTime < RESIZE_SETTLE_TIME)
+        return true;
+
     m_width = width;
     m_height = height;
-    glViewport(0, 0, m_width, m_height);
-    m_framebuffer = Framebuffer::Create({
-        Texture::Create(width, height, GL_RGBA),
-    });
+    // screen sized targets are transient render graph textures,
+    // only state kept across frames is allocated here
+    m_depthPyramid = DepthPyramid::Create(m_width, m_height, 5);
+    CreateAoHistoryTextures();
+    CreateTaaHistoryTextures();
+    return true;
+}
 
-    m_deferGeoFramebuffer = Framebuffer::Create({
-        Texture::Create(width, height, GL_RGBA16F, GL_FLOAT),
-        Texture::Create(width, height, GL_RGBA16F, GL_FLOAT),
-        Texture::Create(width, height, GL_RGBA, GL_UNSIGNED_BYTE),
-    });
+void Context::CreateAoHistoryTextures() {
+    RenderTargetDesc desc;
+    desc.width = std::max(m_width / m_ssaoResolutionScale, 1);
+    desc.height = std::max(m_height / m_ssaoResolutionScale, 1);
+    desc.format = GL_RG16F;
+    desc.type = GL_FLOAT;
+    for (auto& history : m_gtaoHistory) {
+        if (history)
+            m_renderTargetPool->Release(history);
+        history = m_renderTargetPool->Acquire(desc);
+    }
+    m_gtaoHistoryValid = false;
+}
 
-    m_ssaoFramebuffer = Framebuffer::Create({
-        Texture::Create(width, height, GL_RED),
-    });
+void Context::CreateTaaHistoryTextures() {
+    // half floats, accumulating into 11 / 10 bit channels drifts the hue.
+    // linear, reprojection samples the history between texels
+    RenderTargetDesc desc = { m_width, m_height, GL_RGBA16F, GL_FLOAT, GL_LINEAR };
+    for (auto& history : m_taaHistory) {
+        if (history)
+            m_renderTargetPool->Release(history);
+        history = m_renderTargetPool->Acquire(desc);
+    }
+    m_taaHistoryValid = false;
+}
 
-    m_ssaoBlurFramebuffer = Framebuffer::Create({
-        Texture::Create(width, height, GL_RED),
-    });
+void Context::ApplyQualityLevel() {
+    int qualityLevel = m_useDynamicResolution ? m_dynamicResolution->GetQualityLevel() : 0;
+    int cascadeResolution = CASCADE_RESOLUTION >> qualityLevel;
+    if (m_cascadedShadowMap->GetResolution() != cascadeResolution)
+        m_cascadedShadowMap = CascadedShadowMap::Create(cascadeResolution, m_cascadeCount);
+    int shadowMapResolution = SHADOW_MAP_RESOLUTION >> qualityLevel;
+    if (m_shadowMap->GetShadowMap()->GetWidth() != shadowMapResolution)
+        m_shadowMap = ShadowMap::Create(shadowMapResolution, shadowMapResolution);
+}
+
+void Context::CreateTransparentWindows(int count) {
+    // halton points spread the windows evenly without sorting or overlap
+    // checks, crossing windows are fine
+    m_windowInstances.resize(count);
+    for (int i = 0; i < count; i++) {
+        m_windowInstances[i] = glm::vec4(
+            Halton(i + 1, 2) * 8.0f - 4.0f,
+            Halton(i + 1, 5) * 2.0f + 0.5f,
+            Halton(i + 1, 3) * 8.0f - 4.0f,
+            Halton(i + 1, 7) * glm::radians(360.0f));
+    }
+    m_windowInstance = VertexLayout::Create();
+    m_windowInstance->Bind();
+    m_plane->GetVertexBuffer()->Bind();
+    m_windowInstance->SetAttrib(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+    m_windowInstance->SetAttrib(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, texCoord));
+    m_windowInstanceBuffer = Buffer::CreateWithData(GL_ARRAY_BUFFER, GL_STATIC_DRAW,
+        m_windowInstances.data(), sizeof(glm::vec4), m_windowInstances.size());
+    m_windowInstanceBuffer->Bind();
+    m_windowInstance->SetAttrib(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+    glVertexAttribDivisor(3, 1);
+    m_plane->GetIndexBuffer()->Bind();
 }
 
 void Context::MouseMove(double x, double y) {
@@ -88,11 +158,11 @@ void Context::MouseButton(int button, int action, double x, double y) {
 }
 
 bool Context::Init() {
-    glEnable(GL_MULTISAMPLE);
     m_box = Mesh::CreateBox();
 
     m_simpleProgram = Program::Create("./shader/simple.vs", "./shader/simple.fs");
-    if (!m_simpleProgram)
+    m_depthProgram = Program::Create("./shader/depth.vs", "./shader/depth.fs");
+    if (!m_simpleProgram || !m_depthProgram)
         return false;
 
     m_program = Program::Create("./shader/lighting.vs", "./shader/lighting.fs");
@@ -103,9 +173,18 @@ bool Context::Init() {
     if (!m_textureProgram)
         return false;
 
-    m_postProgram = Program::Create("./shader/texture.vs", "./shader/gamma.fs");
-    if (!m_postProgram)
+    m_postPrograms = ProgramVariants::Create("./shader/fullscreen.vs", "./shader/post.fs");
+    if (!m_postPrograms->Prewarm({ {} }))
+        return false;
+    m_taaPrograms = ProgramVariants::Create("./shader/fullscreen.vs", "./shader/taa.fs");
+    if (!m_taaPrograms->Prewarm({ { "VELOCITY_BUFFER" }, {} }))
         return false;
+    m_fxaaProgram = Program::Create("./shader/fullscreen.vs", "./shader/fxaa.fs");
+    if (!m_fxaaProgram)
+        return false;
+    m_aaTimer = GpuTimer::Create();
+    m_dynamicResolution = DynamicResolution::Create(16.6f);
+    m_frameTimer = GpuTimer::Create();
 
     glClearColor(0.4f, 0.4f, 0.2f, 0.2f);
     
@@ -116,23 +195,28 @@ bool Context::Init() {
     Image::CreateSingleColorImage(4, 4, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)).get());
 
     m_planeMaterial = Material::Create();
-    m_planeMaterial->diffuse = Texture::CreateFromImage(Image::Load("./image/marble.jpg").get());
+    m_planeMaterial->diffuse = Texture::CreateFromImage(Image::Load("./image/marble.jpg").get(), true);
     m_planeMaterial->specular = grayTexture;
     m_planeMaterial->shininess = 4.0f;
 
     m_box1Material = Material::Create();
-    m_box1Material->diffuse = Texture::CreateFromImage(Image::Load("./image/container.jpg").get());
+    m_box1Material->diffuse = Texture::CreateFromImage(Image::Load("./image/container.jpg").get(), true);
     m_box1Material->specular = darkGrayTexture;
     m_box1Material->shininess = 16.0f;
 
     m_box2Material = Material::Create();
-    m_box2Material->diffuse = Texture::CreateFromImage(Image::Load("./image/container2.png").get());
+    m_box2Material->diffuse = Texture::CreateFromImage(Image::Load("./image/container2.png").get(), true);
     m_box2Material->specular = Texture::CreateFromImage(Image::Load("./image/container2_specular.png").get());
     m_box2Material->shininess = 64.0f;
 
     m_plane = Mesh::CreatePlane();
     m_windowTexture = Texture::CreateFromImage(
-        Image::Load("./image/blending_transparent_window.png").get());
+        Image::Load("./image/blending_transparent_window.png").get(), true);
+    m_oitProgram = Program::Create("./shader/oit.vs", "./shader/oit.fs");
+    m_oitCompositeProgram = Program::Create("./shader/fullscreen.vs", "./shader/oit_composite.fs");
+    if (!m_oitProgram || !m_oitCompositeProgram)
+        return false;
+    CreateTransparentWindows(m_windowCount);
 
     auto cubeRight = Image::Load("./image/skybox/right.jpg", false);
     auto cubeLeft = Image::Load("./image/skybox/left.jpg", false);
@@ -148,44 +232,79 @@ bool Context::Init() {
         cubeFront.get(),
         cubeBack.get(),
     });
+    auto skyboxSh = SphericalHarmonics::ProjectCubeMap({
+        cubeRight.get(), cubeLeft.get(), cubeTop.get(),
+        cubeBottom.get(), cubeFront.get(), cubeBack.get() });
+    if (!skyboxSh)
+        return false;
+    m_skyboxSh = skyboxSh.value();
+    m_prefilteredEnvMap = PrefilteredEnvMap::Create({
+        cubeRight.get(), cubeLeft.get(), cubeTop.get(),
+        cubeBottom.get(), cubeFront.get(), cubeBack.get() },
+        "./image/skybox/prefiltered.cache");
+    if (!m_prefilteredEnvMap)
+        return false;
     m_skyboxProgram = Program::Create("./shader/skybox.vs", "./shader/skybox.fs");
     m_envMapProgram = Program::Create("./shader/env_map.vs", "./shader/env_map.fs");
+    m_probeProgram = Program::Create("./shader/probe.vs", "./shader/probe.gs",
+        "./shader/probe.fs", {});
+    m_probeSkyProgram = Program::Create("./shader/probe.vs", "./shader/probe.gs",
+        "./shader/probe.fs", { "SKYBOX" });
+    if (!m_probeProgram || !m_probeSkyProgram)
+        return false;
+    // one at the glossy box, one over the middle of the scene
+    for (auto& position : { glm::vec3(3.0f, 1.0f, -1.0f), glm::vec3(0.0f, 2.0f, 0.0f) }) {
+        auto probe = ReflectionProbe::Create(position, 256);
+        if (!probe)
+            return false;
+        m_reflectionProbes.push_back(std::move(probe));
+    }
+    m_probeTimer = GpuTimer::Create();
 
-    m_grassTexture = Texture::CreateFromImage(Image::Load("./image/grass.png").get());
+    m_grassTexture = Texture::CreateFromImage(Image::Load("./image/grass.png").get(), true);
     m_grassProgram = Program::Create("./shader/grass.vs", "./shader/grass.fs");
-    m_grassPos.resize(10000);
-    for (size_t i = 0; i < m_grassPos.size(); i++) {
-        m_grassPos[i].x = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * 5.0f;
-        m_grassPos[i].z = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * 5.0f;
-        m_grassPos[i].y = glm::radians((float)rand() / (float)RAND_MAX * 360.0f);
-    }
-    m_grassInstance = VertexLayout::Create();
-    m_grassInstance->Bind();
-    m_plane->GetVertexBuffer()->Bind();
-    m_grassInstance->SetAttrib(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-    m_grassInstance->SetAttrib(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, normal));
-    m_grassInstance->SetAttrib(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, texCoord));
-    
-    m_grassPosBuffer = Buffer::CreateWithData(GL_ARRAY_BUFFER, GL_STATIC_DRAW,
-        m_grassPos.data(), sizeof(glm::vec3), m_grassPos.size());
-    m_grassPosBuffer->Bind();
-    m_grassInstance->SetAttrib(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
-    glVertexAttribDivisor(3, 1);
-    m_plane->GetIndexBuffer()->Bind();
+    m_grassField = GrassField::Create(m_plane.get(), m_grassBladeCount,
+        GRASS_FIELD_SIZE, glm::vec2(0.3f));
+    if (!m_grassProgram || !m_grassField)
+        return false;
+    m_grassTimer = GpuTimer::Create();
+
+    m_particleProgram = Program::Create("./shader/particle.vs", "./shader/particle.fs");
+    m_particleSystem = ParticleSystem::Create(m_plane.get(), m_particleCapacity);
+    if (!m_particleProgram || !m_particleSystem)
+        return false;
+    m_particleSystem->SetEmitter(glm::vec3(3.0f, 0.0f, 3.0f), 6.0f, 0.3f);
 
-    m_shadowMap = ShadowMap::Create(1024, 1024);
-    m_lightingShadowProgram = Program::Create(
+    m_shadowMap = ShadowMap::Create(SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION);
+    m_cascadedShadowMap = CascadedShadowMap::Create(CASCADE_RESOLUTION, m_cascadeCount);
+    if (!m_cascadedShadowMap)
+        return false;
+    m_lightingShadowPrograms = ProgramVariants::Create(
         "./shader/lighting_shadow.vs", "./shader/lighting_shadow.fs");
+    auto shadowFilterDefine = fmt::format("SHADOW_FILTER {}", m_shadowFilter);
+    if (!m_lightingShadowPrograms->Prewarm({
+        { "BLINN", "SH_AMBIENT", shadowFilterDefine },
+        { "DIRECTIONAL_LIGHT", "BLINN", "SH_AMBIENT", shadowFilterDefine } }))
+        return false;
 
     m_brickDiffuseTexture = Texture::CreateFromImage(
-        Image::Load("./image/brickwall.jpg", false).get());
+        Image::Load("./image/brickwall.jpg", false).get(), true);
     m_brickNormalTexture = Texture::CreateFromImage(
         Image::Load("./image/brickwall_normal.jpg", false).get());
     m_normalProgram = Program::Create("./shader/normal.vs", "./shader/normal.fs");
 
-    m_deferGeoProgram = Program::Create("./shader/defer_geo.vs", "./shader/defer_geo.fs");
+    m_deferGeoPrograms = ProgramVariants::Create("./shader/defer_geo.vs", "./shader/defer_geo.fs");
+    if (!m_deferGeoPrograms->Prewarm({ { "LIGHTMAP" }, {} }))
+        return false;
     
-    m_deferLightProgram = Program::Create("./shader/defer_light.vs", "./shader/defer_light.fs");
+    m_deferLightPrograms = ProgramVariants::Create("./shader/fullscreen.vs", "./shader/defer_light.fs");
+    if (!m_deferLightPrograms->Prewarm({
+        { "USE_SSAO", "SHADOW_ATLAS", "SH_AMBIENT" }, { "SHADOW_ATLAS", "SH_AMBIENT" },
+        { "LIGHTMAP", "SHADOW_ATLAS", "SH_AMBIENT" }, { "USE_SSAO" }, {} }))
+        return false;
+    m_shadowAtlas = ShadowAtlas::Create(4096, 128, 1024);
+    if (!m_shadowAtlas)
+        return false;
     m_deferLights.resize(32);
     for (size_t i = 0; i < m_deferLights.size(); i++) {
         m_deferLights[i].position = glm::vec3(
@@ -198,9 +317,56 @@ bool Context::Init() {
             RandomRange(0.0f, i < 3 ? 1.0f : 0.0f));
     }
     
-    m_ssaoProgram = Program::Create("./shader/ssao.vs", "./shader/ssao.fs");
-    m_blurProgram = Program::Create("./shader/blur_5x5.vs", "./shader/blur_5x5.fs");
+    m_ssaoPrograms = ProgramVariants::Create("./shader/fullscreen.vs", "./shader/ssao.fs");
+    if (!m_ssaoPrograms->Prewarm({ { fmt::format("KERNEL_SIZE {}", m_ssaoKernelSize) } }))
+        return false;
+    m_ssaoBlurProgram = Program::Create("./shader/fullscreen.vs", "./shader/ssao_blur.fs");
+    m_ssaoUpsampleProgram = Program::Create("./shader/fullscreen.vs", "./shader/ssao_upsample.fs");
+    if (!m_ssaoBlurProgram || !m_ssaoUpsampleProgram)
+        return false;
+
+    m_linearDepthProgram = Program::Create("./shader/fullscreen.vs", "./shader/linear_depth.fs");
+    m_depthDownsampleProgram = Program::Create("./shader/fullscreen.vs", "./shader/depth_downsample.fs");
+    m_gtaoTemporalProgram = Program::Create("./shader/fullscreen.vs", "./shader/gtao_temporal.fs");
+    if (!m_linearDepthProgram || !m_depthDownsampleProgram || !m_gtaoTemporalProgram)
+        return false;
+    m_gtaoPrograms = ProgramVariants::Create("./shader/fullscreen.vs", "./shader/gtao.fs");
+    if (!m_gtaoPrograms->Prewarm({ {
+        fmt::format("SLICE_COUNT {}", m_gtaoSliceCount),
+        fmt::format("STEP_COUNT {}", m_gtaoStepCount) } }))
+        return false;
+    m_luminanceProgram = Program::Create("./shader/fullscreen.vs", "./shader/luminance.fs");
+    m_histogramProgram = Program::Create("./shader/histogram.vs", "./shader/histogram.fs");
+    m_exposureProgram = Program::Create("./shader/fullscreen.vs", "./shader/exposure.fs");
+    if (!m_luminanceProgram || !m_histogramProgram || !m_exposureProgram)
+        return false;
+    m_bloomDownsamplePrograms = ProgramVariants::Create(
+        "./shader/fullscreen.vs", "./shader/bloom_downsample.fs");
+    if (!m_bloomDownsamplePrograms->Prewarm({ { "KARIS_AVERAGE" }, {} }))
+        return false;
+    m_bloomUpsampleProgram = Program::Create("./shader/fullscreen.vs", "./shader/bloom_upsample.fs");
+    if (!m_bloomUpsampleProgram)
+        return false;
+    m_emptyVertexLayout = VertexLayout::Create();
+    m_autoExposure = AutoExposure::Create();
+    m_renderTargetPool = RenderTargetPool::Create();
+    m_renderGraph = RenderGraph::Create(m_renderTargetPool.get());
+    m_forwardTimer = GpuTimer::Create();
+
     m_model = Model::Load("./model/backpack.obj");
+    BuildScene();
+    BakeLightmap(false);
+
+    m_visibilityProgram = Program::Create("./shader/simple.vs", "./shader/visibility.fs");
+    if (!m_visibilityProgram)
+        return false;
+    m_visibilityResolvePrograms = ProgramVariants::Create(
+        "./shader/fullscreen.vs", "./shader/visibility_resolve.fs");
+    m_visibilityBuffer = VisibilityBuffer::Create(m_sceneObjects);
+    if (m_visibilityBuffer) {
+        m_visibilityResolvePrograms->Prewarm({ {
+            fmt::format("MATERIAL_COUNT {}", m_visibilityBuffer->GetMaterialCount()) } });
+    }
 
     std::vector<glm::vec3> ssaoNoise;
     ssaoNoise.resize(16);
@@ -217,7 +383,14 @@ bool Context::Init() {
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 4, 4,
         GL_RGB, GL_FLOAT, ssaoNoise.data());
 
-    m_ssaoSamples.resize(64);
+    GenerateSsaoKernel(m_ssaoKernelSize);
+
+    return true;
+
+}
+
+void Context::GenerateSsaoKernel(int kernelSize) {
+    m_ssaoSamples.resize(kernelSize);
     for (size_t i = 0; i < m_ssaoSamples.size(); i++) {
         // uniformly randomized point in unit hemisphere
         glm::vec3 sample(
@@ -233,22 +406,61 @@ bool Context::Init() {
 
         m_ssaoSamples[i] = sample * scale;
     }
-
-    return true;
-
 }
 
 void Context::Render() {	
+    // nothing to draw into while minimized
+    if (!ApplyResize())
+        return;
+    bool showShadowMap = false;
     if (ImGui::Begin("ui window")) {
         if (ImGui::ColorEdit4("clear color", glm::value_ptr(m_clearColor))) {
             glClearColor(m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a);
         }
         ImGui::DragFloat("gamma", &m_gamma, 0.01f, 0.0f, 2.0f);
+        ImGui::Checkbox("grayscale", &m_grayscale);
+        ImGui::SameLine();
+        ImGui::Checkbox("invert", &m_invert);
+        ImGui::SameLine();
+        ImGui::Checkbox("vignette", &m_useVignette);
+        if (m_useVignette)
+            ImGui::DragFloat2("vignette strength/radius", glm::value_ptr(m_vignette), 0.01f, 0.0f, 1.0f);
         ImGui::Separator();
         ImGui::DragFloat3("camera pos", glm::value_ptr(m_cameraPos), 0.01f);
         ImGui::DragFloat("camera yaw", &m_cameraYaw, 0.5f);
         ImGui::DragFloat("camera pitch", &m_cameraPitch, 0.5f, -89.0f, 89.0f);
         ImGui::Separator();
+        const char* geometryModeNames[] = { "g-buffer", "visibility buffer" };
+        ImGui::Combo("geometry pass", &m_geometryMode, geometryModeNames, 2);
+        const char* shadingModeNames[] = { "deferred", "forward shadowed" };
+        if (ImGui::Combo("shading", &m_shadingMode, shadingModeNames, 2))
+            m_gtaoHistoryValid = false;
+        if (m_shadingMode == SHADING_MODE_FORWARD)
+            ImGui::Checkbox("depth prepass", &m_useDepthPrepass);
+        ImGui::Separator();
+        const char* aaModeNames[] = { "none", "fxaa", "taa" };
+        if (ImGui::Combo("anti-aliasing", &m_aaMode, aaModeNames, AA_MODE_COUNT))
+            m_aaTimer->Reset();
+        if (m_aaMode == AA_MODE_TAA)
+            ImGui::DragFloat("taa history weight", &m_taaHistoryWeight, 0.005f, 0.0f, 0.98f);
+        if (m_aaMode == AA_MODE_FXAA) {
+            ImGui::DragFloat("fxaa edge threshold", &m_fxaaEdgeThreshold, 0.001f, 0.03f, 0.35f);
+            ImGui::DragFloat("fxaa edge threshold min", &m_fxaaEdgeThresholdMin, 0.001f, 0.0f, 0.1f);
+            ImGui::DragFloat("fxaa subpixel", &m_fxaaSubpixelQuality, 0.01f, 0.0f, 1.0f);
+        }
+        if (m_aaMode != AA_MODE_NONE)
+            ImGui::Text("anti-aliasing pass: %.3f ms", m_aaTimer->GetAverageMs());
+        if (m_shadingMode == SHADING_MODE_FORWARD) {
+            const char* sampleCountNames[] = { "1", "2", "4", "8" };
+            int sampleCountIndex = m_forwardSampleCount == 8 ? 3 :
+                m_forwardSampleCount == 4 ? 2 : m_forwardSampleCount == 2 ? 1 : 0;
+            if (ImGui::Combo("forward msaa", &sampleCountIndex, sampleCountNames, 4)) {
+                m_forwardSampleCount = 1 << sampleCountIndex;
+                m_forwardTimer->Reset();
+            }
+            ImGui::Text("forward pass: %.3f ms", m_forwardTimer->GetAverageMs());
+        }
+        ImGui::Separator();
         if (ImGui::Button("reset camera")) {
             m_cameraYaw = 0.0f;
             m_cameraPitch = 0.0f;
@@ -262,45 +474,218 @@ void Context::Render() {
             ImGui::DragFloat2("l.cutoff", glm::value_ptr(m_light.cutoff), 0.5f, 0.0f, 180.0f);
             ImGui::DragFloat("l.distance", &m_light.distance, 0.5f, 0.0f, 3000.0f);
             ImGui::ColorEdit3("l.ambient", glm::value_ptr(m_light.ambient));
+            ImGui::Checkbox("skybox ambient", &m_useShAmbient);
+            if (m_useShAmbient)
+                ImGui::DragFloat("skybox ambient intensity", &m_shAmbientIntensity, 0.01f, 0.0f, 4.0f);
+            ImGui::DragFloat("reflection roughness", &m_envRoughness, 0.01f, 0.0f, 1.0f);
+            ImGui::Checkbox("reflection probes", &m_useReflectionProbes);
+            if (m_useReflectionProbes) {
+                ImGui::SliderInt("probe updates / frame", &m_probeUpdateBudget,
+                    1, (int)m_reflectionProbes.size());
+                ImGui::Text("probe update: %.3f ms, %d draws",
+                    m_probeTimer->GetAverageMs(), m_probeDrawCount);
+            }
             ImGui::ColorEdit3("l.diffuse", glm::value_ptr(m_light.diffuse));
             ImGui::ColorEdit3("l.specular", glm::value_ptr(m_light.specular));
             ImGui::Checkbox("flash light", &m_flashLightMode);
             ImGui::Checkbox("l.blinn", &m_blinn);
             ImGui::Checkbox("use ssao", &m_useSsao);
+            const char* aoModeNames[] = { "ssao kernel", "gtao" };
+            if (ImGui::Combo("ao mode", &m_aoMode, aoModeNames, 2))
+                m_gtaoHistoryValid = false;
             ImGui::DragFloat("ssao radius", &m_ssaoRadius, 0.01f, 0.0f, 5.0f);
+            if (m_aoMode == AO_MODE_SSAO) {
+                const char* kernelSizeNames[] = { "16", "32", "64" };
+                int kernelSelect = m_ssaoKernelSize == 16 ? 0 : m_ssaoKernelSize == 32 ? 1 : 2;
+                if (ImGui::Combo("ssao kernel", &kernelSelect, kernelSizeNames, 3))
+                    m_ssaoKernelSize = 16 << kernelSelect;
+            }
+            else {
+                ImGui::SliderInt("gtao slices", &m_gtaoSliceCount, 2, 4);
+                ImGui::SliderInt("gtao steps", &m_gtaoStepCount, 2, 8);
+                ImGui::DragFloat("gtao power", &m_gtaoPower, 0.01f, 0.5f, 4.0f);
+                ImGui::Checkbox("gtao temporal", &m_gtaoTemporal);
+            }
+            const char* resolutionNames[] = { "full", "half", "quarter" };
+            int resolutionSelect = m_ssaoResolutionScale == 1 ? 0 : m_ssaoResolutionScale == 2 ? 1 : 2;
+            if (ImGui::Combo("ssao resolution", &resolutionSelect, resolutionNames, 3)) {
+                m_ssaoResolutionScale = 1 << resolutionSelect;
+                CreateAoHistoryTextures();
+            }
+            ImGui::DragFloat("ssao depth sharpness", &m_ssaoDepthSharpness, 0.1f, 0.0f, 100.0f);
         }
         
         ImGui::Checkbox("animation", &m_animation);
 
-        ImGui::Image((ImTextureID)m_shadowMap->GetShadowMap()->Get(),
-            ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
-    }
-    ImGui::End();
+        if (ImGui::CollapsingHeader("shadow map")) {
+            showShadowMap = true;
+            ImGui::Text("shadow draws: %d", m_shadowDrawCount);
+            const char* shadowFilterNames[] = {
+                "single tap", "4 tap tent", "3x3 pcf", "poisson disk" };
+            ImGui::Combo("shadow filter", &m_shadowFilter,
+                shadowFilterNames, SHADOW_FILTER_COUNT);
+            ImGui::Text("forward pass: %.3f ms", m_forwardTimer->GetAverageMs());
+            if (m_shadowBenchmarkFrame < 0 && ImGui::Button("benchmark filters")) {
+                // the filters are only sampled by the forward pass
+                m_shadingMode = SHADING_MODE_FORWARD;
+                m_shadowBenchmarkFrame = 0;
+            }
+            for (int i = 0; i < SHADOW_FILTER_COUNT; i++) {
+                if (m_shadowFilterTimes[i] > 0.0f)
+                    ImGui::Text("%s: %.3f ms", shadowFilterNames[i], m_shadowFilterTimes[i]);
+            }
+            if (m_light.directional) {
+                if (ImGui::SliderInt("cascades", &m_cascadeCount,
+                    1, CascadedShadowMap::MAX_CASCADE_COUNT)) {
+                    m_cascadedShadowMap = CascadedShadowMap::Create(
+                        m_cascadedShadowMap->GetResolution(), m_cascadeCount);
+                }
+                ImGui::DragFloat("split lambda", &m_cascadeSplitLambda, 0.01f, 0.0f, 1.0f);
+                ImGui::DragFloat("shadow distance", &m_shadowDistance, 0.5f, 1.0f, 100.0f);
+                ImGui::DragFloat("cascade blend", &m_cascadeBlend, 0.01f, 0.0f, 0.5f);
+                ImGui::Checkbox("time sliced cascades", &m_shadowTimeSlicing);
+                for (int i = 0; i < m_cascadedShadowMap->GetCascadeCount(); i++)
+                    ImGui::Text("cascade %d: %.2f", i, m_cascadedShadowMap->GetSplitDepth(i));
+            }
+            else {
+                ImGui::Image((ImTextureID)m_shadowMap->GetStaticShadowMap()->Get(),
+                    ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+            }
+            ImGui::Checkbox("point light shadows", &m_useShadowAtlas);
+            if (m_useShadowAtlas) {
+                ImGui::SliderInt("shadowed lights", &m_shadowedLightCount,
+                    0, MAX_SHADOW_ATLAS_TILES / 6);
+                ImGui::DragFloat("point shadow range", &m_pointShadowFar, 0.5f, 1.0f, 100.0f);
+                ImGui::Text("atlas tiles: %d, draws: %d",
+                    m_shadowAtlas->GetTileCount(), m_atlasDrawCount);
+                for (int i = 0; i < (int)m_deferLights.size(); i++) {
+                    int tile = m_shadowAtlas->GetFirstTile(i);
+                    if (tile >= 0)
+                        ImGui::Text("light %d: %d x 6", i, m_shadowAtlas->GetTile(tile).size);
+                }
+            }
+        }
 
-    if (ImGui::Begin("G-Buffers")) {
-        const char* bufferNames[] = {"position", "normal", "albedo/specular",};
-        static int bufferSelect = 0;
-        ImGui::Combo("buffer", &bufferSelect, bufferNames, 3);
-        float width = ImGui::GetContentRegionAvailWidth();
-        float height = width * ((float)m_height / (float)m_width);
-        auto selectedAttachment = m_deferGeoFramebuffer->GetColorAttachment(bufferSelect);
-        ImGui::Image((ImTextureID)selectedAttachment->Get(),
-        ImVec2(width, height), ImVec2(0, 1), ImVec2(1, 0));
-    }
-    ImGui::End();
+        if (ImGui::CollapsingHeader("lightmap")) {
+            ImGui::Checkbox("use lightmap", &m_useLightmap);
+            if (m_lightmap) {
+                ImGui::Text("%dx%d, %.2f texels / unit", m_lightmap->GetSize(),
+                    m_lightmap->GetSize(), m_lightmap->GetTexelsPerUnit());
+                ImGui::Text("objects: %d, charts: %d, texels: %d",
+                    m_lightmap->GetObjectCount(), m_lightmap->GetChartCount(),
+                    m_lightmap->GetTexelCount());
+                if (m_lightmap->IsFromCache())
+                    ImGui::Text("loaded from cache");
+                else
+                    ImGui::Text("baked in %.2f s, %d rays / texel",
+                        m_lightmap->GetBakeTime(), m_lightmap->GetSampleCount());
+            }
+            if (ImGui::Button("rebake")) {
+                // the objects hold meshes of the old lightmap
+                BuildScene();
+                BakeLightmap(true);
+                m_visibilityBuffer = VisibilityBuffer::Create(m_sceneObjects);
+            }
+        }
 
-    if (ImGui::Begin("SSAO")) {
-        const char* bufferNames[] = { "original", "blurred" };
-        static int bufferSelect = 0;
-        ImGui::Combo("buffer", &bufferSelect, bufferNames, 2);
-        float width = ImGui::GetContentRegionAvailWidth();
-        float height = width * ((float)m_height / (float)m_width);
-        auto selectedAttachment =
-            bufferSelect == 0 ?
-            m_ssaoFramebuffer->GetColorAttachment() :
-            m_ssaoBlurFramebuffer->GetColorAttachment();
-        ImGui::Image((ImTextureID)selectedAttachment->Get(),
-            ImVec2(width, height), ImVec2(0, 1), ImVec2(1, 0));
+        if (ImGui::CollapsingHeader("transparency")) {
+            ImGui::Checkbox("transparent windows", &m_useTransparency);
+            if (ImGui::SliderInt("window count", &m_windowCount, 1, 4096))
+                CreateTransparentWindows(m_windowCount);
+        }
+
+        if (ImGui::CollapsingHeader("grass")) {
+            ImGui::Checkbox("draw grass", &m_useGrass);
+            // regenerating a million blades takes a moment, wait for the release
+            ImGui::SliderInt("blade count", &m_grassBladeCount, 1 << 10, 1 << 22, "%d",
+                ImGuiSliderFlags_Logarithmic);
+            if (ImGui::IsItemDeactivatedAfterEdit()) {
+                auto grassField = GrassField::Create(m_plane.get(), m_grassBladeCount,
+                    GRASS_FIELD_SIZE, glm::vec2(0.3f));
+                if (grassField) {
+                    grassField->SetLodDistances(m_grassField->GetLodStart(), m_grassField->GetLodEnd());
+                    m_grassField = std::move(grassField);
+                }
+            }
+            glm::vec2 lodDistances(m_grassField->GetLodStart(), m_grassField->GetLodEnd());
+            if (ImGui::DragFloat2("thinning start / end", glm::value_ptr(lodDistances), 0.1f, 0.0f, 100.0f))
+                m_grassField->SetLodDistances(lodDistances.x, lodDistances.y);
+            ImGui::DragFloat("wind strength", &m_windStrength, 0.01f, 0.0f, 2.0f);
+            ImGui::Text("chunks: %d / %d, blades: %d / %d",
+                m_grassField->GetVisibleChunkCount(), m_grassField->GetChunkCount(),
+                m_grassField->GetVisibleBladeCount(), m_grassField->GetBladeCount());
+            ImGui::Text("grass pass: %.3f ms", m_grassTimer->GetAverageMs());
+        }
+
+        if (ImGui::CollapsingHeader("particles")) {
+            ImGui::Checkbox("draw particles", &m_useParticles);
+            ImGui::DragFloat("emit rate / s", &m_particleEmitRate, 1000.0f, 0.0f, 1000000.0f);
+            ImGui::DragFloat("particle size", &m_particleSize, 0.001f, 0.001f, 0.5f);
+            ImGui::DragFloat("particle intensity", &m_particleIntensity, 0.05f, 0.0f, 20.0f);
+            ImGui::Text("alive: %d / %d, %s", m_particleSystem->GetAliveCount(),
+                m_particleSystem->GetCapacity(),
+                m_particleSystem->IsPersistentlyMapped() ? "persistently mapped" : "mapped per frame");
+            float updateMs = m_particleSystem->GetUpdateMs();
+            ImGui::Text("update: %.3f ms, %.0f particles / ms, %s", updateMs,
+                updateMs > 0.0f ? m_particleSystem->GetAliveCount() / updateMs : 0.0f,
+                m_particleSystem->IsUsingAvx2() ? "avx2" : "scalar");
+            // stalls the frame it runs in
+            if (ImGui::Button("benchmark 1M particles"))
+                m_particleBenchmark = ParticleSystem::Benchmark(m_plane.get(), 1 << 20, 60);
+            if (m_particleBenchmark > 0.0f)
+                ImGui::Text("benchmark: %.0f particles / ms on %d threads",
+                    m_particleBenchmark, GetWorkerCount());
+        }
+
+        if (ImGui::CollapsingHeader("hdr")) {
+            ImGui::Checkbox("auto exposure", &m_useAutoExposure);
+            ImGui::DragFloat("exposure compensation", &m_exposureCompensation, 0.05f, -8.0f, 8.0f);
+            if (m_useAutoExposure) {
+                ImGui::DragFloat("adaptation rate", &m_exposureAdaptationRate, 0.05f, 0.1f, 10.0f);
+                ImGui::Text("average luminance: %.4f, readback latency: %d frames",
+                    m_autoExposure->GetAverageLuminance(), m_autoExposure->GetLatency());
+                ImGui::Text("exposure: %.3f", m_autoExposure->GetExposure());
+            }
+            else {
+                ImGui::DragFloat("exposure", &m_manualExposure, 0.01f, 0.0f, 16.0f);
+            }
+            ImGui::Checkbox("bloom", &m_useBloom);
+            if (m_useBloom) {
+                ImGui::DragFloat("bloom intensity", &m_bloomIntensity, 0.001f, 0.0f, 1.0f);
+                ImGui::DragFloat("bloom radius", &m_bloomRadius, 0.0005f, 0.001f, 0.05f);
+                ImGui::SliderInt("bloom levels", &m_bloomLevelCount, 1, MAX_BLOOM_LEVEL_COUNT);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("dynamic resolution")) {
+            if (ImGui::Checkbox("dynamic resolution", &m_useDynamicResolution)) {
+                m_dynamicResolution->Reset();
+                m_frameTimer->Reset();
+                ApplyQualityLevel();
+            }
+            float targetMs = m_dynamicResolution->GetTargetMs();
+            if (ImGui::DragFloat("target frame time (ms)", &targetMs, 0.1f, 1.0f, 100.0f))
+                m_dynamicResolution->SetTargetMs(targetMs);
+            float minScale = m_dynamicResolution->GetMinScale();
+            if (ImGui::DragFloat("min scale", &minScale, 0.01f, 0.25f, 1.0f))
+                m_dynamicResolution->SetMinScale(minScale);
+            ImGui::Text("gpu frame: %.2f ms", m_frameTimer->GetAverageMs());
+            ImGui::Text("render size: %d x %d (%.2f), quality level: %d",
+                m_width, m_height, m_dynamicResolution->GetScale(),
+                m_dynamicResolution->GetQualityLevel());
+        }
+
+        if (ImGui::CollapsingHeader("render graph")) {
+            ImGui::Text("passes: %d, culled: %d",
+                m_renderGraph->GetPassCount(), m_renderGraph->GetCulledPassCount());
+            ImGui::Text("transient textures: %d, allocated: %d",
+                m_renderGraph->GetTransientTextureCount(),
+                m_renderGraph->GetPhysicalTextureCount());
+            ImGui::Text("pooled textures: %d, free: %d, %.1f MB",
+                m_renderTargetPool->GetTextureCount(),
+                m_renderTargetPool->GetFreeTextureCount(),
+                (float)m_renderTargetPool->GetAllocatedBytes() / (1024.0f * 1024.0f));
+        }
     }
     ImGui::End();
 
@@ -312,127 +697,1242 @@ void Context::Render() {
     //m_light.position = m_cameraPos;
     //m_light.direction = m_cameraFront;
 
-    auto projection = glm::perspective(glm::radians(45.0f),
-        (float)m_width / (float)m_height , 0.1f, 100.0f);
+    float fovy = glm::radians(45.0f);
+    float aspect = (float)m_width / (float)m_height;
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    auto projection = glm::perspective(fovy, aspect, nearPlane, farPlane);
+    // motion vectors and reprojection use the projection without jitter
+    auto unjitteredProjection = projection;
+    if (m_aaMode == AA_MODE_TAA) {
+        int phase = (int)(m_frameIndex % TAA_JITTER_PHASE_COUNT) + 1;
+        auto jitter = glm::vec2(Halton(phase, 2), Halton(phase, 3)) - 0.5f;
+        projection[2][0] += jitter.x * 2.0f / (float)m_width;
+        projection[2][1] += jitter.y * 2.0f / (float)m_height;
+    }
 
     auto view = glm::lookAt(
       m_cameraPos,
       m_cameraPos + m_cameraFront,
       m_cameraUp);
+    auto inverseProjection = glm::inverse(projection);
+    auto inverseViewProjection = glm::inverse(projection * view);
 
     auto lightView = glm::lookAt(m_light.position,
         m_light.position + m_light.direction,
         glm::vec3(0.0f, 1.0f, 0.0f));
-    auto lightProjection = m_light.directional ?
-        glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 30.0f) :
-        glm::perspective(
-            glm::radians((m_light.cutoff[0] + m_light.cutoff[1]) * 2.0f),
-            1.0f, 1.0f, 20.0f);
+    auto lightProjection = glm::perspective(
+        glm::radians((m_light.cutoff[0] + m_light.cutoff[1]) * 2.0f),
+        1.0f, 1.0f, 20.0f);
+    AnimateScene();
+    // the directional light covers the view frustum up to the shadow distance
+    if (!m_light.directional)
+        m_shadowMap->SetLightTransform(lightProjection * lightView);
+    else {
+        m_cascadedShadowMap->SetTimeSlicing(m_shadowTimeSlicing);
+        m_cascadedShadowMap->Update(view, fovy, aspect,
+            nearPlane, std::min(m_shadowDistance, farPlane), m_cascadeSplitLambda,
+            m_light.direction, m_sceneBoundsMin, m_sceneBoundsMax);
+    }
+
+    // the benchmark renders every filter for a while, timed after a warm up
+    int shadowFilter = m_shadowFilter;
+    if (m_shadowBenchmarkFrame >= 0) {
+        int filter = m_shadowBenchmarkFrame / SHADOW_BENCHMARK_FRAMES;
+        int frame = m_shadowBenchmarkFrame % SHADOW_BENCHMARK_FRAMES;
+        if (frame == SHADOW_BENCHMARK_WARMUP_FRAMES)
+            m_forwardTimer->Reset();
+        if (frame == SHADOW_BENCHMARK_FRAMES - 1)
+            m_shadowFilterTimes[filter] = m_forwardTimer->GetAverageMs();
+        shadowFilter = filter;
+        if (++m_shadowBenchmarkFrame == SHADOW_FILTER_COUNT * SHADOW_BENCHMARK_FRAMES)
+            m_shadowBenchmarkFrame = -1;
+    }
+
+    auto GetLightingShadowProgram = [&](int filter) {
+        return m_lightingShadowPrograms->Get({
+            m_light.directional ? "DIRECTIONAL_LIGHT" : "",
+            m_blinn ? "BLINN" : "",
+            m_useShAmbient ? "SH_AMBIENT" : "",
+            fmt::format("SHADOW_FILTER {}", filter) });
+    };
+    // a filter that fails to build falls back to the single tap, and
+    // without that the forward pass leaves the lit scene out of the frame
+    auto lightingShadowProgram = GetLightingShadowProgram(shadowFilter);
+    if (!lightingShadowProgram && shadowFilter != SHADOW_FILTER_SINGLE)
+        lightingShadowProgram = GetLightingShadowProgram(SHADOW_FILTER_SINGLE);
+
+    // point lights are ranked by brightness times the screen size of the
+    // region they light, only the first m_shadowedLightCount get tiles
+    bool useShadowAtlas = m_useShadowAtlas && m_shadingMode == SHADING_MODE_DEFERRED;
+    // without the atlas every request is dropped, so no tile is packed and
+    // GetFirstTile() still answers -1 for every light
+    ShadowAtlas::Request dropped;
+    dropped.importance = 0.0f;
+    std::vector<ShadowAtlas::Request> atlasRequests(m_deferLights.size(), dropped);
+    if (useShadowAtlas) {
+        std::vector<int> order;
+        for (int i = 0; i < (int)m_deferLights.size(); i++) {
+            auto& light = m_deferLights[i];
+            float brightness = glm::dot(light.color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+            float distance = glm::length(light.position - m_cameraPos);
+            float coverage = POINT_LIGHT_RADIUS /
+                std::max(distance * tanf(fovy * 0.5f), 0.001f);
+            atlasRequests[i].importance = brightness * std::min(coverage, 1.0f);
+            atlasRequests[i].faceCount = 6;
+            order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            return atlasRequests[a].importance > atlasRequests[b].importance;
+        });
+        int shadowedLightCount = std::min(m_shadowedLightCount, MAX_SHADOW_ATLAS_TILES / 6);
+        for (int i = shadowedLightCount; i < (int)order.size(); i++)
+            atlasRequests[order[i]].importance = 0.0f;
+    }
+    m_shadowAtlas->Allocate(atlasRequests);
+
+    // the visibility path falls back to the g-buffer pass until its buffer
+    // exists, and for frames its resolve variant fails to build
+    const Program* resolveProgram = nullptr;
+    if (m_geometryMode == GEOMETRY_MODE_VISIBILITY && m_visibilityBuffer) {
+        resolveProgram = m_visibilityResolvePrograms->Get({
+            fmt::format("MATERIAL_COUNT {}", m_visibilityBuffer->GetMaterialCount()) });
+    }
+    bool useGBufferPass = !resolveProgram;
+    // lightmaps live in the g-buffer path, static surfaces need no ssao then
+    bool useLightmap = m_useLightmap && m_lightmap &&
+        m_geometryMode == GEOMETRY_MODE_GBUFFER && m_shadingMode == SHADING_MODE_DEFERRED;
+    bool useSsao = m_useSsao && !useLightmap;
+    auto deferGeoProgram = m_deferGeoPrograms->Get({ useLightmap ? "LIGHTMAP" : "" });
+    if (!deferGeoProgram)
+        return;
+    auto deferLightProgram = m_deferLightPrograms->Get({
+        useSsao ? "USE_SSAO" : "",
+        useLightmap ? "LIGHTMAP" : "",
+        useShadowAtlas ? "SHADOW_ATLAS" : "",
+        m_useShAmbient ? "SH_AMBIENT" : "" });
+    if (!deferLightProgram)
+        return;
+    // quality levels of the dynamic resolution halve the ao samples
+    int qualityLevel = m_useDynamicResolution ? m_dynamicResolution->GetQualityLevel() : 0;
+    const Program* aoProgram = nullptr;
+    if (m_aoMode == AO_MODE_SSAO) {
+        int ssaoKernelSize = std::max(m_ssaoKernelSize >> qualityLevel, 8);
+        if ((int)m_ssaoSamples.size() != ssaoKernelSize)
+            GenerateSsaoKernel(ssaoKernelSize);
+        aoProgram = m_ssaoPrograms->Get({
+            fmt::format("KERNEL_SIZE {}", ssaoKernelSize) });
+    }
+    else {
+        aoProgram = m_gtaoPrograms->Get({
+            fmt::format("SLICE_COUNT {}", m_gtaoSliceCount),
+            fmt::format("STEP_COUNT {}", std::max(m_gtaoStepCount >> qualityLevel, 2)) });
+    }
+    if (!aoProgram)
+        return;
+    bool useFxaa = m_aaMode == AA_MODE_FXAA;
+    bool upscale = m_width != m_windowWidth || m_height != m_windowHeight;
+    // the first bloom level needs at least 4x4 texels
+    bool useBloom = m_useBloom && m_width >= 8 && m_height >= 8;
+    // a missing variant only drops the bloom, not the frame
+    const Program* bloomKarisProgram = nullptr;
+    const Program* bloomDownsampleProgram = nullptr;
+    if (useBloom) {
+        bloomKarisProgram = m_bloomDownsamplePrograms->Get({ "KARIS_AVERAGE" });
+        bloomDownsampleProgram = m_bloomDownsamplePrograms->Get({ "" });
+        useBloom = bloomKarisProgram && bloomDownsampleProgram;
+    }
+    auto postProgram = m_postPrograms->Get({
+        useBloom ? "BLOOM" : "",
+        useFxaa ? "FXAA_LUMA" : "",
+        upscale ? "UPSCALE" : "",
+        m_gamma != 1.0f ? "GAMMA" : "",
+        m_grayscale ? "GRAYSCALE" : "",
+        m_invert ? "INVERT" : "",
+        m_useVignette ? "VIGNETTE" : "" });
+    if (!postProgram)
+        return;
+    // only the g-buffer pass writes velocity, elsewhere it is derived
+    // from depth and the camera motion
+    bool useVelocityBuffer = useGBufferPass && m_shadingMode == SHADING_MODE_DEFERRED;
+    auto taaProgram = m_taaPrograms->Get({ useVelocityBuffer ? "VELOCITY_BUFFER" : "" });
+    if (!taaProgram)
+        return;
+    bool useForwardMsaa = m_shadingMode == SHADING_MODE_FORWARD && m_forwardSampleCount > 1;
+    if (useForwardMsaa && (!m_forwardMsaa ||
+        m_forwardMsaa->GetWidth() != m_width || m_forwardMsaa->GetHeight() != m_height ||
+        m_forwardMsaa->GetSampleCount() != m_forwardSampleCount)) {
+        m_forwardMsaa = MultisampleFramebuffer::Create(m_width, m_height,
+            m_forwardSampleCount, GL_R11F_G11F_B10F);
+        if (!m_forwardMsaa)
+            return;
+        // the implementation may support fewer samples
+        m_forwardSampleCount = m_forwardMsaa->GetSampleCount();
+    }
+    else if (!useForwardMsaa) {
+        m_forwardMsaa.reset();
+    }
+
+    // the readback of an earlier frame drives this frame's exposure
+    double frameTime = glfwGetTime();
+    float deltaTime = m_prevFrameTime > 0.0 ? (float)(frameTime - m_prevFrameTime) : 0.0f;
+    m_prevFrameTime = frameTime;
+    if (m_useAutoExposure)
+        m_autoExposure->Update(deltaTime, m_exposureAdaptationRate);
+    float exposure = (m_useAutoExposure ? m_autoExposure->GetExposure() : m_manualExposure) *
+        exp2f(m_exposureCompensation);
+
+    if (m_useParticles) {
+        // a hitch would launch a burst and tunnel through the ground
+        float particleDeltaTime = std::min(deltaTime, 0.05f);
+        float emitCount = m_particleEmitRate * particleDeltaTime + m_particleEmitCarry;
+        m_particleSystem->Emit((int)emitCount);
+        m_particleEmitCarry = emitCount - floorf(emitCount);
+        m_particleSystem->Update(particleDeltaTime);
+    }
+
+    // declare the frame, passes run in Execute() below
+    auto& graph = *m_renderGraph;
+    graph.Reset();
+    // the scene is rendered at m_width x m_height, which lags behind the
+    // window while it is being resized
+    auto backbuffer = graph.ImportBackbuffer(m_windowWidth, m_windowHeight);
 
 //shadow버퍼에depth값 렌더링
-    m_shadowMap->Bind();
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glViewport(0, 0,
-        m_shadowMap->GetShadowMap()->GetWidth(),
-        m_shadowMap->GetShadowMap()->GetHeight());
-    m_simpleProgram->Use();
-    m_simpleProgram->SetUniform("color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-    DrawScene(lightView, lightProjection, m_simpleProgram.get());
+    auto shadowMap = m_light.directional ?
+        graph.ImportExternal("cascaded shadow map") :
+        graph.Import("shadow map", m_shadowMap->GetShadowMap());
+    if (showShadowMap)
+        graph.MarkOutput(shadowMap);
+    graph.AddPass("shadow map",
+        [&](RenderGraph::PassBuilder& builder) {
+            builder.Write(shadowMap);
+        },
+        [&]() {
+            m_depthProgram->Use();
+            // static casters are drawn only when their cache is invalid,
+            // dynamic ones every frame on top of a copy of it
+            m_shadowDrawCount = 0;
+            auto IsCaster = [&](const SceneObject& object, bool dynamic, int cascade) {
+                return object.dynamic == dynamic && (cascade < 0 ||
+                    m_cascadedShadowMap->IsVisible(cascade, object.boundsMin, object.boundsMax));
+            };
+            auto HasDynamicCasters = [&](int cascade) {
+                for (auto& object : m_sceneObjects) {
+                    if (IsCaster(object, true, cascade))
+                        return true;
+                }
+                return false;
+            };
+            auto DrawCasters = [&](const glm::mat4& lightViewProjection,
+                bool dynamic, int cascade) {
+                for (auto& object : m_sceneObjects) {
+                    if (!IsCaster(object, dynamic, cascade))
+                        continue;
+                    m_depthProgram->SetUniform("transform",
+                        lightViewProjection * object.modelTransform);
+                    object.mesh->DrawDepth();
+                    m_shadowDrawCount++;
+                }
+            };
+
+            if (!m_light.directional) {
+                auto lightTransform = m_shadowMap->GetLightTransform();
+                if (!m_shadowMap->IsStaticValid()) {
+                    m_shadowMap->BeginStatic();
+                    DrawCasters(lightTransform, false, -1);
+                }
+                if (m_shadowMap->BeginDynamic(HasDynamicCasters(-1)))
+                    DrawCasters(lightTransform, true, -1);
+                return;
+            }
+            for (int i = 0; i < m_cascadedShadowMap->GetCascadeCount(); i++) {
+                auto& lightViewProjection = m_cascadedShadowMap->GetViewProjection(i);
+                if (!m_cascadedShadowMap->IsStaticValid(i)) {
+                    m_cascadedShadowMap->BeginStatic(i);
+                    DrawCasters(lightViewProjection, false, i);
+                }
+                if (m_cascadedShadowMap->BeginDynamic(i, HasDynamicCasters(i)))
+                    DrawCasters(lightViewProjection, true, i);
+            }
+        });
+
+    // every face of every shadowed point light, one framebuffer for all of them
+    auto shadowAtlas = graph.Import("shadow atlas", m_shadowAtlas->GetTexture());
+    auto pointShadowProjection = glm::perspective(glm::radians(90.0f), 1.0f,
+        POINT_SHADOW_NEAR, m_pointShadowFar);
+    graph.AddPass("shadow atlas",
+        [&](RenderGraph::PassBuilder& builder) {
+            builder.Write(shadowAtlas);
+        },
+        [&]() {
+            m_shadowAtlas->Begin();
+            m_depthProgram->Use();
+            m_atlasDrawCount = 0;
+            for (int i = 0; i < (int)m_deferLights.size(); i++) {
+                int firstTile = m_shadowAtlas->GetFirstTile(i);
+                if (firstTile < 0)
+                    continue;
+                auto& position = m_deferLights[i].position;
+                for (int face = 0; face < 6; face++) {
+                    m_shadowAtlas->BeginTile(firstTile + face);
+                    auto lightViewProjection = pointShadowProjection *
+                        ShadowAtlas::GetCubeFaceView(position, face);
+                    int axis = face / 2;
+                    float sign = face % 2 == 0 ? 1.0f : -1.0f;
+                    for (auto& object : m_sceneObjects) {
+                        // skip casters behind the face or out of range
+                        auto closest = glm::clamp(position, object.boundsMin, object.boundsMax);
+                        float front = sign > 0.0f ?
+                            object.boundsMax[axis] - position[axis] :
+                            position[axis] - object.boundsMin[axis];
+                        if (front < 0.0f || glm::length(closest - position) > m_pointShadowFar)
+                            continue;
+                        m_depthProgram->SetUniform("transform",
+                            lightViewProjection * object.modelTransform);
+                        object.mesh->DrawDepth();
+                        m_atlasDrawCount++;
+                    }
+                }
+            }
+        });
 //
 
-     m_deferGeoFramebuffer->Bind();
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glViewport(0, 0, m_width, m_height);
-    m_deferGeoProgram->Use();
-    DrawScene(view, projection, m_deferGeoProgram.get());
-
-    m_ssaoFramebuffer->Bind();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glViewport(0, 0, m_width, m_height);
-    m_ssaoProgram->Use();
-    glActiveTexture(GL_TEXTURE0);
-    m_deferGeoFramebuffer->GetColorAttachment(0)->Bind();
-    glActiveTexture(GL_TEXTURE1);
-    m_deferGeoFramebuffer->GetColorAttachment(1)->Bind();
-    glActiveTexture(GL_TEXTURE2);
-    m_ssaoNoiseTexture->Bind();
-    glActiveTexture(GL_TEXTURE0);
-    m_ssaoProgram->SetUniform("gPosition", 0);
-    m_ssaoProgram->SetUniform("gNormal", 1);
-    m_ssaoProgram->SetUniform("texNoise", 2);
-    m_ssaoProgram->SetUniform("noiseScale", glm::vec2(
-        (float)m_width / (float)m_ssaoNoiseTexture->GetWidth(),
-        (float)m_height / (float)m_ssaoNoiseTexture->GetHeight()));
-    m_ssaoProgram->SetUniform("radius", m_ssaoRadius);
-    for (size_t i = 0; i < m_ssaoSamples.size(); i++) {
-        auto sampleName = fmt::format("samples[{}]", i);
-        m_ssaoProgram->SetUniform(sampleName, m_ssaoSamples[i]);
-    }
-    m_ssaoProgram->SetUniform("transform",
-        glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)));
-    m_ssaoProgram->SetUniform("view", view);
-    m_ssaoProgram->SetUniform("projection", projection);
-    m_plane->Draw(m_ssaoProgram.get());
-
-    m_ssaoBlurFramebuffer->Bind();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glViewport(0, 0, m_width, m_height);
-    m_blurProgram->Use();
-    m_ssaoFramebuffer->GetColorAttachment(0)->Bind();
-    m_blurProgram->SetUniform("tex", 0);
-    m_blurProgram->SetUniform("transform",
-        glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)));
-    m_plane->Draw(m_blurProgram.get());
-
-    Framebuffer::BindToDefault();
-    glViewport(0, 0, m_width, m_height);
-    glClearColor(m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a);
-    
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
+    auto gDepth = graph.CreateTexture("g-buffer depth",
+        { m_width, m_height, GL_DEPTH24_STENCIL8, GL_UNSIGNED_INT_24_8 });
+    auto gNormal = graph.CreateTexture("g-buffer normal",
+        { m_width, m_height, GL_RG16, GL_UNSIGNED_SHORT });
+    auto gAlbedoSpec = graph.CreateTexture("g-buffer albedo/specular",
+        { m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE });
+    auto gVelocity = RenderGraph::INVALID_HANDLE;
+    if (useGBufferPass) {
+        gVelocity = graph.CreateTexture("g-buffer velocity",
+            { m_width, m_height, GL_RG16F, GL_FLOAT });
+    }
+    auto gAmbient = RenderGraph::INVALID_HANDLE;
+    if (useLightmap) {
+        gAmbient = graph.CreateTexture("g-buffer ambient",
+            { m_width, m_height, GL_R11F_G11F_B10F, GL_FLOAT });
+    }
+    // lit scene before tone mapping, the deferred path keeps testing
+    // against the g-buffer depth. linear, bloom takes bilinear taps of it
+    auto hdrColor = graph.CreateTexture("hdr color",
+        { m_width, m_height, GL_R11F_G11F_B10F, GL_FLOAT, GL_LINEAR });
+    auto sceneDepth = m_shadingMode == SHADING_MODE_DEFERRED ? gDepth :
+        graph.CreateTexture("scene depth",
+            { m_width, m_height, GL_DEPTH24_STENCIL8, GL_UNSIGNED_INT_24_8 });
+    if (!useGBufferPass) {
+        auto visibility = graph.CreateTexture("visibility",
+            { m_width, m_height, GL_R32UI, GL_UNSIGNED_INT });
+        graph.AddPass("visibility",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.WriteColor(visibility);
+                builder.WriteDepthStencil(gDepth, true);
+            },
+            [&]() {
+                const GLuint invalidVisibility[] = { 0xffffffff, 0, 0, 0 };
+                glClearBufferuiv(GL_COLOR, 0, invalidVisibility);
+                m_visibilityBuffer->Draw(projection * view, m_visibilityProgram.get());
+            });
+
+        // materials are fetched and interpolated once per visible pixel
+        graph.AddPass("visibility resolve",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(visibility);
+                builder.WriteColor(gNormal, glm::vec4(0.0f));
+                builder.WriteColor(gAlbedoSpec, glm::vec4(0.0f));
+            },
+            [&, resolveProgram]() {
+                resolveProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(visibility)->Bind();
+                resolveProgram->SetUniform("visibility", 0);
+                m_visibilityBuffer->SetToProgram(resolveProgram, 1);
+                resolveProgram->SetUniform("viewProjection", projection * view);
+                resolveProgram->SetUniform("screenSize", glm::vec2(m_width, m_height));
+                DrawFullscreenTriangle();
+            });
+    }
+    else {
+        graph.AddPass("g-buffer",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.WriteColor(gNormal, glm::vec4(0.0f));
+                builder.WriteColor(gAlbedoSpec, glm::vec4(0.0f));
+                builder.WriteColor(gVelocity, glm::vec4(0.0f));
+                if (useLightmap)
+                    builder.WriteColor(gAmbient, glm::vec4(0.0f));
+                builder.WriteDepthStencil(gDepth, true);
+            },
+            [&, deferGeoProgram]() {
+                deferGeoProgram->Use();
+                if (useLightmap) {
+                    glActiveTexture(GL_TEXTURE2);
+                    m_lightmap->GetTexture()->Bind();
+                    glActiveTexture(GL_TEXTURE0);
+                    deferGeoProgram->SetUniform("lightmap", 2);
+                    m_skyboxSh.SetToProgram(deferGeoProgram);
+                }
+                deferGeoProgram->SetUniform("viewProjection", unjitteredProjection * view);
+                deferGeoProgram->SetUniform("prevViewProjection", m_prevProjection * m_prevView);
+                DrawScene(view, projection, deferGeoProgram);
+            });
+    }
 
-    m_deferLightProgram->Use();
-    glActiveTexture(GL_TEXTURE0);
-    m_deferGeoFramebuffer->GetColorAttachment(0)->Bind();
-    glActiveTexture(GL_TEXTURE1);
-    m_deferGeoFramebuffer->GetColorAttachment(1)->Bind();
-    glActiveTexture(GL_TEXTURE2);
-    m_deferGeoFramebuffer->GetColorAttachment(2)->Bind();
-    glActiveTexture(GL_TEXTURE3);
-    m_ssaoBlurFramebuffer->GetColorAttachment()->Bind();
-    glActiveTexture(GL_TEXTURE0);
-    m_deferLightProgram->SetUniform("gPosition", 0);
-    m_deferLightProgram->SetUniform("gNormal", 1);
-    m_deferLightProgram->SetUniform("gAlbedoSpec", 2);
-    m_deferLightProgram->SetUniform("ssao", 3);
-    m_deferLightProgram->SetUniform("useSsao", m_useSsao ? 1 : 0);
-    for (size_t i = 0; i < m_deferLights.size(); i++) {
-        auto posName = fmt::format("lights[{}].position", i);
-        auto colorName = fmt::format("lights[{}].color", i);
-        m_deferLightProgram->SetUniform(posName, m_deferLights[i].position);
-        m_deferLightProgram->SetUniform(colorName, m_deferLights[i].color);
-    }
-    m_deferLightProgram->SetUniform("transform",
-        glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)));
-    m_plane->Draw(m_deferLightProgram.get());
-
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_deferGeoFramebuffer->Get());
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, m_width, m_height,
-        0, 0, m_width, m_height,
-        GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    m_simpleProgram->Use();
-    for (size_t i = 0; i < m_deferLights.size(); i++) {
-        m_simpleProgram->SetUniform("color", glm::vec4(m_deferLights[i].color, 1.0f));
-        m_simpleProgram->SetUniform("transform",
-            projection * view * 
-            glm::translate(glm::mat4(1.0f), m_deferLights[i].position) *
-            glm::scale(glm::mat4(1.0f), glm::vec3(0.1f)));
-        m_box->Draw(m_simpleProgram.get());
+    auto ssaoSize = glm::ivec2(
+        std::max(m_width / m_ssaoResolutionScale, 1),
+        std::max(m_height / m_ssaoResolutionScale, 1));
+    RenderTargetDesc aoDesc = { ssaoSize.x, ssaoSize.y, GL_RG16F, GL_FLOAT };
+    // the ambient occlusion result that goes through blur / upsample
+    auto ao = graph.CreateTexture("ao", aoDesc);
+    auto aoResult = ao;
+    if (m_aoMode == AO_MODE_SSAO) {
+        graph.AddPass("ssao",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(gDepth);
+                builder.Read(gNormal);
+                builder.WriteColor(ao, glm::vec4(0.0f));
+            },
+            [&]() {
+                aoProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(gDepth)->Bind();
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(gNormal)->Bind();
+                glActiveTexture(GL_TEXTURE2);
+                m_ssaoNoiseTexture->Bind();
+                glActiveTexture(GL_TEXTURE0);
+                aoProgram->SetUniform("gDepth", 0);
+                aoProgram->SetUniform("gNormal", 1);
+                aoProgram->SetUniform("texNoise", 2);
+                aoProgram->SetUniform("noiseScale", glm::vec2(
+                    (float)ssaoSize.x / (float)m_ssaoNoiseTexture->GetWidth(),
+                    (float)ssaoSize.y / (float)m_ssaoNoiseTexture->GetHeight()));
+                aoProgram->SetUniform("radius", m_ssaoRadius);
+                aoProgram->SetUniform("resolutionScale", m_ssaoResolutionScale);
+                for (size_t i = 0; i < m_ssaoSamples.size(); i++) {
+                    auto sampleName = fmt::format("samples[{}]", i);
+                    aoProgram->SetUniform(sampleName, m_ssaoSamples[i]);
+                }
+                aoProgram->SetUniform("view", view);
+                aoProgram->SetUniform("projection", projection);
+                aoProgram->SetUniform("inverseProjection", inverseProjection);
+                DrawFullscreenTriangle();
+            });
+    }
+    else {
+        // linear depth and its closest-depth mip chain
+        auto depthPyramid = graph.Import("depth pyramid", m_depthPyramid->GetTexture());
+        graph.AddPass("depth pyramid",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(gDepth);
+                builder.Write(depthPyramid);
+            },
+            [&]() {
+                m_depthPyramid->BindLevel(0);
+                m_linearDepthProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(gDepth)->Bind();
+                m_linearDepthProgram->SetUniform("gDepth", 0);
+                m_linearDepthProgram->SetUniform("inverseProjection", inverseProjection);
+                DrawFullscreenTriangle();
+
+                m_depthDownsampleProgram->Use();
+                m_depthDownsampleProgram->SetUniform("tex", 0);
+                for (int level = 1; level < m_depthPyramid->GetLevelCount(); level++) {
+                    m_depthPyramid->SetSourceLevel(level - 1);
+                    m_depthPyramid->BindLevel(level);
+                    DrawFullscreenTriangle();
+                }
+                m_depthPyramid->ResetSourceLevel();
+            });
+
+        graph.AddPass("gtao",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(depthPyramid);
+                builder.Read(gNormal);
+                builder.WriteColor(ao, glm::vec4(0.0f));
+            },
+            [&]() {
+                aoProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                m_depthPyramid->GetTexture()->Bind();
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(gNormal)->Bind();
+                glActiveTexture(GL_TEXTURE0);
+                aoProgram->SetUniform("depthPyramid", 0);
+                aoProgram->SetUniform("gNormal", 1);
+                aoProgram->SetUniform("view", view);
+                aoProgram->SetUniform("projScale",
+                    glm::vec2(1.0f / projection[0][0], 1.0f / projection[1][1]));
+                aoProgram->SetUniform("screenSize", glm::vec2(m_width, m_height));
+                aoProgram->SetUniform("maxLod", (float)(m_depthPyramid->GetLevelCount() - 1));
+                aoProgram->SetUniform("radius", m_ssaoRadius);
+                aoProgram->SetUniform("finalPower", m_gtaoPower);
+                aoProgram->SetUniform("resolutionScale", m_ssaoResolutionScale);
+                aoProgram->SetUniform("frameIndex", (int)(m_gtaoTemporal ? m_frameIndex : 0));
+                DrawFullscreenTriangle();
+            });
+
+        // accumulate over frames by reprojecting last frame's result
+        if (m_gtaoTemporal) {
+            auto history = graph.Import("ao history", m_gtaoHistory[m_gtaoHistoryIndex]);
+            auto accumulated = graph.Import("ao accumulated", m_gtaoHistory[1 - m_gtaoHistoryIndex]);
+            graph.AddPass("gtao temporal",
+                [&](RenderGraph::PassBuilder& builder) {
+                    builder.Read(ao);
+                    builder.Read(history);
+                    builder.Read(gDepth);
+                    builder.WriteColor(accumulated);
+                },
+                [&]() {
+                    m_gtaoTemporalProgram->Use();
+                    glActiveTexture(GL_TEXTURE0);
+                    graph.GetTexture(ao)->Bind();
+                    glActiveTexture(GL_TEXTURE1);
+                    graph.GetTexture(history)->Bind();
+                    glActiveTexture(GL_TEXTURE2);
+                    graph.GetTexture(gDepth)->Bind();
+                    glActiveTexture(GL_TEXTURE0);
+                    m_gtaoTemporalProgram->SetUniform("tex", 0);
+                    m_gtaoTemporalProgram->SetUniform("history", 1);
+                    m_gtaoTemporalProgram->SetUniform("gDepth", 2);
+                    m_gtaoTemporalProgram->SetUniform("inverseViewProjection", inverseViewProjection);
+                    m_gtaoTemporalProgram->SetUniform("prevView", m_prevView);
+                    m_gtaoTemporalProgram->SetUniform("prevProjection", m_prevProjection);
+                    m_gtaoTemporalProgram->SetUniform("resolutionScale", m_ssaoResolutionScale);
+                    m_gtaoTemporalProgram->SetUniform("historyWeight",
+                        m_gtaoHistoryValid ? 0.9f : 0.0f);
+                    DrawFullscreenTriangle();
+
+                    m_gtaoHistoryIndex = 1 - m_gtaoHistoryIndex;
+                    m_gtaoHistoryValid = true;
+                });
+            aoResult = accumulated;
+        }
+        else {
+            m_gtaoHistoryValid = false;
+        }
+    }
+
+    // separable depth / normal aware blur at the ssao resolution.
+    // at full resolution the vertical pass writes the final result directly
+    bool upsample = m_ssaoResolutionScale > 1;
+    auto aoBlurTemp = graph.CreateTexture("ao blur temp", aoDesc);
+    auto aoBlurred = upsample ? graph.CreateTexture("ao blurred", aoDesc) : RenderGraph::INVALID_HANDLE;
+    auto aoFinal = graph.CreateTexture("ao final",
+        { m_width, m_height, GL_RED, GL_UNSIGNED_BYTE });
+    auto AddSsaoBlurPass = [&](const std::string& name,
+        RenderGraph::Handle src, RenderGraph::Handle dst, glm::vec2 direction) {
+        graph.AddPass(name,
+            [&, src, dst](RenderGraph::PassBuilder& builder) {
+                builder.Read(src);
+                builder.Read(gNormal);
+                builder.WriteColor(dst);
+            },
+            [&, src, direction]() {
+                m_ssaoBlurProgram->Use();
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(gNormal)->Bind();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(src)->Bind();
+                m_ssaoBlurProgram->SetUniform("tex", 0);
+                m_ssaoBlurProgram->SetUniform("gNormal", 1);
+                m_ssaoBlurProgram->SetUniform("direction", direction / glm::vec2(ssaoSize));
+                m_ssaoBlurProgram->SetUniform("depthSharpness", m_ssaoDepthSharpness);
+                DrawFullscreenTriangle();
+            });
+    };
+    AddSsaoBlurPass("ao blur h", aoResult, aoBlurTemp, glm::vec2(1.0f, 0.0f));
+    AddSsaoBlurPass("ao blur v", aoBlurTemp, upsample ? aoBlurred : aoFinal,
+        glm::vec2(0.0f, 1.0f));
+
+    if (upsample) {
+        graph.AddPass("ao upsample",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(aoBlurred);
+                builder.Read(gDepth);
+                builder.Read(gNormal);
+                builder.WriteColor(aoFinal);
+            },
+            [&]() {
+                m_ssaoUpsampleProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(aoBlurred)->Bind();
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(gDepth)->Bind();
+                glActiveTexture(GL_TEXTURE2);
+                graph.GetTexture(gNormal)->Bind();
+                glActiveTexture(GL_TEXTURE0);
+                m_ssaoUpsampleProgram->SetUniform("tex", 0);
+                m_ssaoUpsampleProgram->SetUniform("gDepth", 1);
+                m_ssaoUpsampleProgram->SetUniform("gNormal", 2);
+                m_ssaoUpsampleProgram->SetUniform("inverseProjection", inverseProjection);
+                m_ssaoUpsampleProgram->SetUniform("depthSharpness", m_ssaoDepthSharpness);
+                DrawFullscreenTriangle();
+            });
+    }
+
+    // every pixel is covered, so neither clear nor depth test is needed
+    auto gBufferView = m_gBufferDebugSelect == 0 ? gDepth :
+        m_gBufferDebugSelect == 1 ? gNormal : gAlbedoSpec;
+    auto ssaoView = m_ssaoDebugSelect == 0 ? ao : aoFinal;
+    if (m_shadingMode == SHADING_MODE_DEFERRED) {
+        graph.AddPass("lighting",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(gDepth);
+                builder.Read(gNormal);
+                builder.Read(gAlbedoSpec);
+                if (useSsao)
+                    builder.Read(aoFinal);
+                if (useLightmap)
+                    builder.Read(gAmbient);
+                if (useShadowAtlas)
+                    builder.Read(shadowAtlas);
+                builder.WriteColor(hdrColor);
+            },
+            [&]() {
+                glDisable(GL_DEPTH_TEST);
+                deferLightProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(gDepth)->Bind();
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(gNormal)->Bind();
+                glActiveTexture(GL_TEXTURE2);
+                graph.GetTexture(gAlbedoSpec)->Bind();
+                if (useSsao) {
+                    glActiveTexture(GL_TEXTURE3);
+                    graph.GetTexture(aoFinal)->Bind();
+                }
+                if (useLightmap) {
+                    glActiveTexture(GL_TEXTURE3);
+                    graph.GetTexture(gAmbient)->Bind();
+                }
+                glActiveTexture(GL_TEXTURE0);
+                deferLightProgram->SetUniform("gDepth", 0);
+                deferLightProgram->SetUniform("gNormal", 1);
+                deferLightProgram->SetUniform("inverseViewProjection", inverseViewProjection);
+                deferLightProgram->SetUniform("gAlbedoSpec", 2);
+                deferLightProgram->SetUniform("ssao", 3);
+                deferLightProgram->SetUniform("gAmbient", 3);
+                deferLightProgram->SetUniform("ambientIntensity", m_shAmbientIntensity);
+                m_skyboxSh.SetToProgram(deferLightProgram);
+                deferLightProgram->SetUniform("shAmbientIntensity", m_shAmbientIntensity);
+                for (size_t i = 0; i < m_deferLights.size(); i++) {
+                    auto posName = fmt::format("lights[{}].position", i);
+                    auto colorName = fmt::format("lights[{}].color", i);
+                    deferLightProgram->SetUniform(posName, m_deferLights[i].position);
+                    deferLightProgram->SetUniform(colorName, m_deferLights[i].color);
+                }
+                if (useShadowAtlas) {
+                    glActiveTexture(GL_TEXTURE4);
+                    m_shadowAtlas->GetTexture()->Bind();
+                    glActiveTexture(GL_TEXTURE0);
+                    deferLightProgram->SetUniform("shadowAtlas", 4);
+                    for (int i = 0; i < m_shadowAtlas->GetTileCount(); i++) {
+                        deferLightProgram->SetUniform(fmt::format("shadowTileRects[{}]", i),
+                            m_shadowAtlas->GetTileRect(i));
+                    }
+                    for (int face = 0; face < 6; face++) {
+                        deferLightProgram->SetUniform(fmt::format("shadowFaceViews[{}]", face),
+                            ShadowAtlas::GetCubeFaceView(glm::vec3(0.0f), face));
+                    }
+                    deferLightProgram->SetUniform("shadowDepthRange",
+                        glm::vec2(POINT_SHADOW_NEAR, m_pointShadowFar));
+                    for (int i = 0; i < (int)m_deferLights.size(); i++) {
+                        deferLightProgram->SetUniform(fmt::format("shadowFirstTiles[{}]", i),
+                            m_shadowAtlas->GetFirstTile(i));
+                    }
+                }
+                DrawFullscreenTriangle();
+                glEnable(GL_DEPTH_TEST);
+            });
+
+        // forward rendered objects are depth tested against the G-buffer
+        graph.AddPass("light boxes",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.WriteColor(hdrColor);
+                builder.WriteDepthStencil(sceneDepth);
+            },
+            [&]() {
+                m_simpleProgram->Use();
+                for (size_t i = 0; i < m_deferLights.size(); i++) {
+                    m_simpleProgram->SetUniform("color", glm::vec4(m_deferLights[i].color, 1.0f));
+                    m_simpleProgram->SetUniform("transform",
+                        projection * view * 
+                        glm::translate(glm::mat4(1.0f), m_deferLights[i].position) *
+                        glm::scale(glm::mat4(1.0f), glm::vec3(0.1f)));
+                    m_box->Draw(m_simpleProgram.get());
+                }
+            });
+
+        // debug views read their texture after the frame, keep it from being aliased
+        graph.MarkOutput(gBufferView);
+        if (useSsao)
+            graph.MarkOutput(ssaoView);
+    }
+    else {
+        // the g-buffer and ao passes above have no reader in this mode,
+        // so the graph culls them
+        auto drawDepthPrepass = [&]() {
+            glEnable(GL_DEPTH_TEST);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            m_depthProgram->Use();
+            for (auto& object : m_sceneObjects) {
+                // the same product as DrawScene, bit exact depth
+                m_depthProgram->SetUniform("transform",
+                    projection * view * object.modelTransform);
+                object.mesh->DrawDepth();
+            }
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        };
+        // with msaa the prepass goes into the multisampled depth instead
+        if (m_useDepthPrepass && !useForwardMsaa) {
+            graph.AddPass("depth prepass",
+                [&](RenderGraph::PassBuilder& builder) {
+                    builder.WriteDepthStencil(sceneDepth, true);
+                },
+                drawDepthPrepass);
+        }
+        graph.AddPass("forward shadowed",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(shadowMap);
+                if (useForwardMsaa) {
+                    // fully overwritten by the resolve
+                    builder.WriteColor(hdrColor);
+                    builder.WriteDepthStencil(sceneDepth);
+                }
+                else {
+                    builder.WriteColor(hdrColor, m_clearColor);
+                    builder.WriteDepthStencil(sceneDepth, !m_useDepthPrepass);
+                }
+            },
+            [&, drawDepthPrepass]() {
+                m_forwardTimer->Begin();
+                GLint resolveFramebuffer = 0;
+                if (useForwardMsaa) {
+                    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &resolveFramebuffer);
+                    m_forwardMsaa->Bind();
+                    glClearBufferfv(GL_COLOR, 0, glm::value_ptr(m_clearColor));
+                    glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+                    if (m_useDepthPrepass)
+                        drawDepthPrepass();
+                }
+                glEnable(GL_DEPTH_TEST);
+                auto lightPos = m_flashLightMode ? m_cameraPos : m_light.position;
+                auto lightDir = m_flashLightMode ? m_cameraFront : m_light.direction;
+                if (!m_flashLightMode) {
+                    auto lightModelTransform =
+                        glm::translate(glm::mat4(1.0), m_light.position) *
+                        glm::scale(glm::mat4(1.0), glm::vec3(0.1f));
+                    m_simpleProgram->Use();
+                    m_simpleProgram->SetUniform("color",
+                        glm::vec4(m_light.ambient + m_light.diffuse, 1.0f));
+                    m_simpleProgram->SetUniform("transform", projection * view * lightModelTransform);
+                    m_box->Draw(m_simpleProgram.get());
+                }
+
+                if (lightingShadowProgram) {
+                    lightingShadowProgram->Use();
+                    lightingShadowProgram->SetUniform("viewPos", m_cameraPos);
+                    lightingShadowProgram->SetUniform("viewFront", m_cameraFront);
+                    lightingShadowProgram->SetUniform("light.position", lightPos);
+                    lightingShadowProgram->SetUniform("light.direction", lightDir);
+                    lightingShadowProgram->SetUniform("light.cutoff", glm::vec2(
+                        cosf(glm::radians(m_light.cutoff[0])),
+                        cosf(glm::radians(m_light.cutoff[0] + m_light.cutoff[1]))));
+                    lightingShadowProgram->SetUniform("light.attenuation",
+                        GetAttenuationCoeff(m_light.distance));
+                    lightingShadowProgram->SetUniform("light.ambient", m_light.ambient);
+                    m_skyboxSh.SetToProgram(lightingShadowProgram);
+                    lightingShadowProgram->SetUniform("shAmbientIntensity", m_shAmbientIntensity);
+                    lightingShadowProgram->SetUniform("light.diffuse", m_light.diffuse);
+                    lightingShadowProgram->SetUniform("light.specular", m_light.specular);
+                    if (m_light.directional) {
+                        m_cascadedShadowMap->SetToProgram(lightingShadowProgram, 3);
+                        lightingShadowProgram->SetUniform("cascadeBlend", m_cascadeBlend);
+                    }
+                    else {
+                        lightingShadowProgram->SetUniform("lightTransform",
+                            m_shadowMap->GetLightTransform());
+                        glActiveTexture(GL_TEXTURE3);
+                        m_shadowMap->GetShadowMap()->Bind();
+                        lightingShadowProgram->SetUniform("shadowMap", 3);
+                        glActiveTexture(GL_TEXTURE0);
+                    }
+                    if (m_useDepthPrepass) {
+                        glDepthFunc(GL_EQUAL);
+                        glDepthMask(GL_FALSE);
+                    }
+                    DrawScene(view, projection, lightingShadowProgram);
+                    glDepthFunc(GL_LESS);
+                    glDepthMask(GL_TRUE);
+                }
+                if (useForwardMsaa)
+                    m_forwardMsaa->Resolve((uint32_t)resolveFramebuffer);
+                m_forwardTimer->End();
+            });
+    }
+
+    // the probe budget is spent round robin, every probe is refreshed once
+    // every probe count / budget frames with a single layered pass
+    auto reflectionProbes = graph.ImportExternal("reflection probes");
+    if (m_useReflectionProbes) {
+        graph.AddPass("reflection probes",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Write(reflectionProbes);
+            },
+            [&]() {
+                m_probeTimer->Begin();
+                m_probeDrawCount = 0;
+                int updateCount = std::min(m_probeUpdateBudget, (int)m_reflectionProbes.size());
+                for (int i = 0; i < updateCount; i++) {
+                    auto& probe = m_reflectionProbes[m_nextProbe];
+                    m_nextProbe = (m_nextProbe + 1) % (int)m_reflectionProbes.size();
+                    probe->Begin();
+
+                    // the sky lies on the far plane behind everything
+                    glDisable(GL_DEPTH_TEST);
+                    m_probeSkyProgram->Use();
+                    probe->SetToProgram(m_probeSkyProgram.get(), PROBE_NEAR, PROBE_FAR, true);
+                    m_cubeTexture->Bind();
+                    m_probeSkyProgram->SetUniform("skybox", 0);
+                    m_probeSkyProgram->SetUniform("modelTransform", glm::mat4(1.0f));
+                    m_box->Draw(m_probeSkyProgram.get());
+                    glEnable(GL_DEPTH_TEST);
+
+                    auto& position = probe->GetPosition();
+                    m_probeProgram->Use();
+                    probe->SetToProgram(m_probeProgram.get(), PROBE_NEAR, PROBE_FAR);
+                    m_skyboxSh.SetToProgram(m_probeProgram.get());
+                    m_probeProgram->SetUniform("shAmbientIntensity", m_shAmbientIntensity);
+                    m_probeProgram->SetUniform("lightVector", m_light.directional ?
+                        glm::vec4(-glm::normalize(m_light.direction), 0.0f) :
+                        glm::vec4(m_light.position, 1.0f));
+                    m_probeProgram->SetUniform("lightColor", m_light.diffuse);
+                    for (auto& object : m_sceneObjects) {
+                        auto closest = glm::clamp(position, object.boundsMin, object.boundsMax);
+                        if (glm::length(closest - position) > PROBE_FAR)
+                            continue;
+                        m_probeProgram->SetUniform("modelTransform", object.modelTransform);
+                        if (object.material)
+                            object.material->SetToProgram(m_probeProgram.get());
+                        object.mesh->Draw(m_probeProgram.get());
+                        m_probeDrawCount++;
+                    }
+                    probe->End();
+                }
+                m_probeTimer->End();
+            });
+    }
+
+    // glossy reflection of the nearest probe, or of the skybox. the
+    // roughness picks the mip, GGX filtered for the skybox and box
+    // filtered for the probes
+    auto glossyPosition = glm::vec3(3.0f, 1.0f, -1.0f);
+    graph.AddPass("glossy reflection",
+        [&](RenderGraph::PassBuilder& builder) {
+            if (m_useReflectionProbes)
+                builder.Read(reflectionProbes);
+            builder.WriteColor(hdrColor);
+            builder.WriteDepthStencil(sceneDepth);
+        },
+        [&]() {
+            const ReflectionProbe* nearestProbe = nullptr;
+            float nearestDistance = std::numeric_limits<float>::max();
+            for (auto& probe : m_reflectionProbes) {
+                float distance = glm::length(probe->GetPosition() - glossyPosition);
+                if (m_useReflectionProbes && probe->IsValid() && distance < nearestDistance) {
+                    nearestProbe = probe.get();
+                    nearestDistance = distance;
+                }
+            }
+            auto modelTransform = glm::translate(glm::mat4(1.0f), glossyPosition);
+            m_envMapProgram->Use();
+            if (nearestProbe)
+                nearestProbe->Bind();
+            else
+                m_prefilteredEnvMap->Bind();
+            m_envMapProgram->SetUniform("model", modelTransform);
+            m_envMapProgram->SetUniform("view", view);
+            m_envMapProgram->SetUniform("projection", projection);
+            m_envMapProgram->SetUniform("cameraPos", m_cameraPos);
+            m_envMapProgram->SetUniform("skybox", 0);
+            m_envMapProgram->SetUniform("roughness", m_envRoughness);
+            m_envMapProgram->SetUniform("maxLod", (float)((nearestProbe ?
+                nearestProbe->GetLevelCount() : m_prefilteredEnvMap->GetLevelCount()) - 1));
+            m_box->Draw(m_envMapProgram.get());
+        });
+
+    // alpha tested grass, only the chunks in view at the density their
+    // distance calls for are streamed and drawn
+    if (m_useGrass) {
+        graph.AddPass("grass",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.WriteColor(hdrColor);
+                builder.WriteDepthStencil(sceneDepth);
+            },
+            [&]() {
+                m_grassTimer->Begin();
+                m_grassField->Update(projection * view, m_cameraPos);
+                glEnable(GL_DEPTH_TEST);
+                m_grassProgram->Use();
+                m_grassTexture->Bind();
+                m_grassProgram->SetUniform("tex", 0);
+                m_grassProgram->SetUniform("viewProjection", projection * view);
+                m_grassProgram->SetUniform("cameraPos", m_cameraPos);
+                m_grassProgram->SetUniform("time", (float)glfwGetTime());
+                m_grassProgram->SetUniform("windDirection", m_windDirection);
+                m_grassProgram->SetUniform("windStrength", m_windStrength);
+                m_grassField->SetToProgram(m_grassProgram.get());
+                m_grassField->Draw();
+                m_grassTimer->End();
+            });
+    }
+
+    if (m_useParticles) {
+        graph.AddPass("particles",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.WriteColor(hdrColor);
+                // tested against, not written
+                builder.WriteDepthStencil(sceneDepth);
+            },
+            [&]() {
+                m_particleSystem->Upload();
+                glEnable(GL_DEPTH_TEST);
+                glDepthMask(GL_FALSE);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                m_particleProgram->Use();
+                m_particleProgram->SetUniform("view", view);
+                m_particleProgram->SetUniform("projection", projection);
+                m_particleProgram->SetUniform("particleSize", m_particleSize);
+                m_particleProgram->SetUniform("intensity", m_particleIntensity);
+                m_particleSystem->Draw();
+                glDisable(GL_BLEND);
+                glDepthMask(GL_TRUE);
+            });
+    }
+
+    // transparent surfaces in any order: premultiplied color and alpha
+    // times a depth weight are summed, the revealage multiplied, then the
+    // weighted average is blended over the opaque frame
+    if (m_useTransparency && !m_windowInstances.empty()) {
+        auto oitAccumulation = graph.CreateTexture("oit accumulation",
+            { m_width, m_height, GL_RGBA16F, GL_FLOAT });
+        auto oitWeight = graph.CreateTexture("oit weight",
+            { m_width, m_height, GL_R16F, GL_FLOAT });
+        graph.AddPass("transparency",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.WriteColor(oitAccumulation, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+                builder.WriteColor(oitWeight, glm::vec4(0.0f));
+                // tested against, not written
+                builder.WriteDepthStencil(sceneDepth);
+            },
+            [&]() {
+                glEnable(GL_DEPTH_TEST);
+                glDepthMask(GL_FALSE);
+                glEnable(GL_BLEND);
+                glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+                m_oitProgram->Use();
+                m_windowTexture->Bind();
+                m_oitProgram->SetUniform("tex", 0);
+                m_oitProgram->SetUniform("viewProjection", projection * view);
+                m_windowInstance->Bind();
+                glDrawElementsInstanced(GL_TRIANGLES, m_plane->GetIndexBuffer()->GetCount(),
+                    GL_UNSIGNED_INT, 0, (GLsizei)m_windowInstances.size());
+                glDisable(GL_BLEND);
+                glDepthMask(GL_TRUE);
+            });
+        graph.AddPass("transparency composite",
+            [&, oitAccumulation, oitWeight](RenderGraph::PassBuilder& builder) {
+                builder.Read(oitAccumulation);
+                builder.Read(oitWeight);
+                builder.WriteColor(hdrColor);
+            },
+            [&, oitAccumulation, oitWeight]() {
+                glDisable(GL_DEPTH_TEST);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+                m_oitCompositeProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(oitAccumulation)->Bind();
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(oitWeight)->Bind();
+                glActiveTexture(GL_TEXTURE0);
+                m_oitCompositeProgram->SetUniform("accumulation", 0);
+                m_oitCompositeProgram->SetUniform("weight", 1);
+                DrawFullscreenTriangle();
+                glDisable(GL_BLEND);
+                glEnable(GL_DEPTH_TEST);
+            });
+    }
+
+    // temporal anti-aliasing, the resolved frame is the next frame's history
+    auto sceneColor = hdrColor;
+    if (m_aaMode == AA_MODE_TAA) {
+        auto taaHistory = graph.Import("taa history", m_taaHistory[m_taaHistoryIndex]);
+        auto taaResolved = graph.Import("taa resolved", m_taaHistory[1 - m_taaHistoryIndex]);
+        graph.AddPass("taa resolve",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(hdrColor);
+                builder.Read(sceneDepth);
+                if (useVelocityBuffer)
+                    builder.Read(gVelocity);
+                builder.Read(taaHistory);
+                builder.WriteColor(taaResolved);
+            },
+            [&, taaHistory]() {
+                m_aaTimer->Begin();
+                glDisable(GL_DEPTH_TEST);
+                taaProgram->Use();
+                glActiveTexture(GL_TEXTURE0);
+                graph.GetTexture(hdrColor)->Bind();
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(taaHistory)->Bind();
+                glActiveTexture(GL_TEXTURE2);
+                graph.GetTexture(sceneDepth)->Bind();
+                if (useVelocityBuffer) {
+                    glActiveTexture(GL_TEXTURE3);
+                    graph.GetTexture(gVelocity)->Bind();
+                }
+                glActiveTexture(GL_TEXTURE0);
+                taaProgram->SetUniform("hdrColor", 0);
+                taaProgram->SetUniform("history", 1);
+                taaProgram->SetUniform("depth", 2);
+                taaProgram->SetUniform("velocity", 3);
+                taaProgram->SetUniform("inverseViewProjection", inverseViewProjection);
+                taaProgram->SetUniform("viewProjection", unjitteredProjection * view);
+                taaProgram->SetUniform("prevViewProjection", m_prevProjection * m_prevView);
+                taaProgram->SetUniform("historyWeight",
+                    m_taaHistoryValid ? m_taaHistoryWeight : 0.0f);
+                DrawFullscreenTriangle();
+                glEnable(GL_DEPTH_TEST);
+                m_aaTimer->End();
+
+                m_taaHistoryIndex = 1 - m_taaHistoryIndex;
+                m_taaHistoryValid = true;
+            });
+        sceneColor = taaResolved;
+    }
+    else {
+        m_taaHistoryValid = false;
+    }
+
+    // average luminance of the frame: a quarter resolution log luminance
+    // target, a histogram of it built by additively blended points, and
+    // its trimmed mean. the 1x1 result reaches the cpu frames later
+    if (m_useAutoExposure) {
+        auto luminanceSize = glm::ivec2(std::max(m_width / 4, 1), std::max(m_height / 4, 1));
+        auto logLuminance = graph.CreateTexture("log luminance",
+            { luminanceSize.x, luminanceSize.y, GL_R16F, GL_FLOAT });
+        auto histogram = graph.CreateTexture("luminance histogram",
+            { HISTOGRAM_BIN_COUNT, 1, GL_R32F, GL_FLOAT });
+        auto averageLuminance = graph.CreateTexture("average luminance",
+            { 1, 1, GL_R32F, GL_FLOAT });
+        auto logRange = glm::vec2(HISTOGRAM_LOG_MIN, HISTOGRAM_LOG_MAX);
+        graph.AddPass("log luminance",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(sceneColor);
+                builder.WriteColor(logLuminance);
+            },
+            [&]() {
+                glDisable(GL_DEPTH_TEST);
+                m_luminanceProgram->Use();
+                graph.GetTexture(sceneColor)->Bind();
+                m_luminanceProgram->SetUniform("hdrColor", 0);
+                DrawFullscreenTriangle();
+                glEnable(GL_DEPTH_TEST);
+            });
+        graph.AddPass("luminance histogram",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(logLuminance);
+                builder.WriteColor(histogram, glm::vec4(0.0f));
+            },
+            [&, logLuminance, histogram, luminanceSize, logRange]() {
+                glDisable(GL_DEPTH_TEST);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                m_histogramProgram->Use();
+                graph.GetTexture(logLuminance)->Bind();
+                m_histogramProgram->SetUniform("logLuminance", 0);
+                m_histogramProgram->SetUniform("binCount", HISTOGRAM_BIN_COUNT);
+                m_histogramProgram->SetUniform("logRange", logRange);
+                m_emptyVertexLayout->Bind();
+                glDrawArrays(GL_POINTS, 0, luminanceSize.x * luminanceSize.y);
+                glDisable(GL_BLEND);
+                glEnable(GL_DEPTH_TEST);
+            });
+        graph.AddPass("average luminance",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(histogram);
+                builder.WriteColor(averageLuminance);
+                // read back by AutoExposure, not by another pass
+                builder.SetSideEffect();
+            },
+            [&, histogram, logRange]() {
+                glDisable(GL_DEPTH_TEST);
+                m_exposureProgram->Use();
+                graph.GetTexture(histogram)->Bind();
+                m_exposureProgram->SetUniform("histogram", 0);
+                m_exposureProgram->SetUniform("logRange", logRange);
+                m_exposureProgram->SetUniform("percentRange", glm::vec2(0.5f, 0.95f));
+                DrawFullscreenTriangle();
+                glEnable(GL_DEPTH_TEST);
+                m_autoExposure->Capture();
+            });
+    }
+
+    // every level is half the previous one, down to a few texels. the
+    // first downsample reads the frame, the upsamples add each level onto
+    // the next larger one and the post pass reads the first
+    std::vector<RenderGraph::Handle> bloomLevels;
+    if (useBloom) {
+        int width = m_width;
+        int height = m_height;
+        for (int i = 0; i < m_bloomLevelCount; i++) {
+            width /= 2;
+            height /= 2;
+            if (width < 4 || height < 4)
+                break;
+            bloomLevels.push_back(graph.CreateTexture(fmt::format("bloom {}", i),
+                { width, height, GL_R11F_G11F_B10F, GL_FLOAT, GL_LINEAR }));
+        }
+    }
+    for (size_t i = 0; i < bloomLevels.size(); i++) {
+        auto source = i == 0 ? sceneColor : bloomLevels[i - 1];
+        auto target = bloomLevels[i];
+        auto downsampleProgram = i == 0 ? bloomKarisProgram : bloomDownsampleProgram;
+        graph.AddPass(fmt::format("bloom downsample {}", i),
+            [&, source, target](RenderGraph::PassBuilder& builder) {
+                builder.Read(source);
+                builder.WriteColor(target);
+            },
+            [&, source, downsampleProgram]() {
+                glDisable(GL_DEPTH_TEST);
+                downsampleProgram->Use();
+                graph.GetTexture(source)->Bind();
+                downsampleProgram->SetUniform("tex", 0);
+                DrawFullscreenTriangle();
+                glEnable(GL_DEPTH_TEST);
+            });
+    }
+    for (int i = (int)bloomLevels.size() - 2; i >= 0; i--) {
+        auto source = bloomLevels[i + 1];
+        auto target = bloomLevels[i];
+        graph.AddPass(fmt::format("bloom upsample {}", i),
+            [&, source, target](RenderGraph::PassBuilder& builder) {
+                builder.Read(source);
+                builder.WriteColor(target);
+            },
+            [&, source]() {
+                glDisable(GL_DEPTH_TEST);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                m_bloomUpsampleProgram->Use();
+                graph.GetTexture(source)->Bind();
+                m_bloomUpsampleProgram->SetUniform("tex", 0);
+                m_bloomUpsampleProgram->SetUniform("filterRadius", m_bloomRadius);
+                DrawFullscreenTriangle();
+                glDisable(GL_BLEND);
+                glEnable(GL_DEPTH_TEST);
+            });
+    }
+    auto bloom = bloomLevels.empty() ? RenderGraph::INVALID_HANDLE : bloomLevels[0];
+
+    // upscaling, tone mapping and the per pixel effects, one read of the
+    // hdr frame and one write of the backbuffer, or of the fxaa input
+    // linear, fxaa blends by sampling between texels
+    auto ldrColor = useFxaa ? graph.CreateTexture("ldr color",
+        { m_windowWidth, m_windowHeight, GL_SRGB8_ALPHA8, GL_UNSIGNED_BYTE, GL_LINEAR }) : backbuffer;
+    graph.AddPass("post process",
+        [&](RenderGraph::PassBuilder& builder) {
+            builder.Read(sceneColor);
+            if (bloom != RenderGraph::INVALID_HANDLE)
+                builder.Read(bloom);
+            builder.WriteColor(ldrColor);
+        },
+        [&]() {
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_FRAMEBUFFER_SRGB);
+            postProgram->Use();
+            graph.GetTexture(sceneColor)->Bind();
+            if (bloom != RenderGraph::INVALID_HANDLE) {
+                glActiveTexture(GL_TEXTURE1);
+                graph.GetTexture(bloom)->Bind();
+                glActiveTexture(GL_TEXTURE0);
+            }
+            postProgram->SetUniform("hdrColor", 0);
+            postProgram->SetUniform("exposure", exposure);
+            postProgram->SetUniform("gamma", m_gamma);
+            postProgram->SetUniform("vignette", m_vignette);
+            postProgram->SetUniform("sourceSize", glm::vec2(m_width, m_height));
+            postProgram->SetUniform("bloom", 1);
+            postProgram->SetUniform("bloomIntensity", m_bloomIntensity);
+            DrawFullscreenTriangle();
+            glDisable(GL_FRAMEBUFFER_SRGB);
+            glEnable(GL_DEPTH_TEST);
+        });
+
+    if (useFxaa) {
+        graph.AddPass("fxaa",
+            [&](RenderGraph::PassBuilder& builder) {
+                builder.Read(ldrColor);
+                builder.WriteColor(backbuffer);
+            },
+            [&]() {
+                m_aaTimer->Begin();
+                glDisable(GL_DEPTH_TEST);
+                glEnable(GL_FRAMEBUFFER_SRGB);
+                m_fxaaProgram->Use();
+                graph.GetTexture(ldrColor)->Bind();
+                m_fxaaProgram->SetUniform("ldrColor", 0);
+                m_fxaaProgram->SetUniform("texelSize",
+                    glm::vec2(1.0f / (float)m_windowWidth, 1.0f / (float)m_windowHeight));
+                m_fxaaProgram->SetUniform("edgeThreshold", m_fxaaEdgeThreshold);
+                m_fxaaProgram->SetUniform("edgeThresholdMin", m_fxaaEdgeThresholdMin);
+                m_fxaaProgram->SetUniform("subpixelQuality", m_fxaaSubpixelQuality);
+                DrawFullscreenTriangle();
+                glDisable(GL_FRAMEBUFFER_SRGB);
+                glEnable(GL_DEPTH_TEST);
+                m_aaTimer->End();
+            });
+    }
+
+    m_frameTimer->Begin();
+    graph.Execute();
+    m_frameTimer->End();
+    // a new scale is applied by ApplyResize() next frame
+    if (m_useDynamicResolution &&
+        m_dynamicResolution->Update(m_frameTimer->GetAverageMs(), m_frameTimer->GetSampleCount())) {
+        m_frameTimer->Reset();
+        ApplyQualityLevel();
+    }
+
+    if (ImGui::Begin("G-Buffers")) {
+        const char* bufferNames[] = {"depth", "normal", "albedo/specular",};
+        ImGui::Combo("buffer", &m_gBufferDebugSelect, bufferNames, 3);
+        float width = ImGui::GetContentRegionAvailWidth();
+        float height = width * ((float)m_height / (float)m_width);
+        auto selectedAttachment = graph.GetTexture(gBufferView);
+        if (selectedAttachment) {
+            ImGui::Image((ImTextureID)selectedAttachment->Get(),
+            ImVec2(width, height), ImVec2(0, 1), ImVec2(1, 0));
+        }
     }
+    ImGui::End();
+
+    if (ImGui::Begin("SSAO")) {
+        const char* bufferNames[] = { "original", "blurred" };
+        ImGui::Combo("buffer", &m_ssaoDebugSelect, bufferNames, 2);
+        float width = ImGui::GetContentRegionAvailWidth();
+        float height = width * ((float)m_height / (float)m_width);
+        auto selectedAttachment = graph.GetTexture(ssaoView);
+        if (selectedAttachment) {
+            ImGui::Image((ImTextureID)selectedAttachment->Get(),
+                ImVec2(width, height), ImVec2(0, 1), ImVec2(1, 0));
+        }
+    }
+    ImGui::End();
 
 /*
     auto skyboxModelTransform =
@@ -444,43 +1944,6 @@ void Context::Render() {
     m_skyboxProgram->SetUniform("transform", projection * view * skyboxModelTransform);
     m_box->Draw(m_skyboxProgram.get());
 
-    glm::vec3 lightPos = m_light.position;
-    glm::vec3 lightDir = m_light.direction;
-    if(m_flashLightMode) {
-        lightPos = m_cameraPos;
-        lightDir = m_cameraFront;
-    }
-    else {
-        auto lightModelTransform =
-            glm::translate(glm::mat4(1.0), m_light.position) *
-            glm::scale(glm::mat4(1.0), glm::vec3(0.1f));
-        m_simpleProgram->Use();
-        m_simpleProgram->SetUniform("color", glm::vec4(m_light.ambient + m_light.diffuse, 1.0f));
-        m_simpleProgram->SetUniform("transform", projection * view * lightModelTransform);
-        m_box->Draw(m_simpleProgram.get());
-    }
-
-    m_lightingShadowProgram->Use();
-    m_lightingShadowProgram->SetUniform("viewPos", m_cameraPos);
-    m_lightingShadowProgram->SetUniform("light.directional", m_light.directional ? 1 : 0);
-    m_lightingShadowProgram->SetUniform("light.position", m_light.position);
-    m_lightingShadowProgram->SetUniform("light.direction", m_light.direction);
-    m_lightingShadowProgram->SetUniform("light.cutoff", glm::vec2(
-        cosf(glm::radians(m_light.cutoff[0])),
-        cosf(glm::radians(m_light.cutoff[0] + m_light.cutoff[1]))));
-    m_lightingShadowProgram->SetUniform("light.attenuation", GetAttenuationCoeff(m_light.distance));
-    m_lightingShadowProgram->SetUniform("light.ambient", m_light.ambient);
-    m_lightingShadowProgram->SetUniform("light.diffuse", m_light.diffuse);
-    m_lightingShadowProgram->SetUniform("light.specular", m_light.specular);
-    m_lightingShadowProgram->SetUniform("blinn", (m_blinn ? 1 : 0));
-    m_lightingShadowProgram->SetUniform("lightTransform", lightProjection * lightView);
-    glActiveTexture(GL_TEXTURE3);
-    m_shadowMap->GetShadowMap()->Bind();
-    m_lightingShadowProgram->SetUniform("shadowMap", 3);
-    glActiveTexture(GL_TEXTURE0);
-
-    DrawScene(view, projection, m_lightingShadowProgram.get());
-
     auto modelTransform =
         glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 3.0f, 0.0f)) *
         glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
@@ -499,70 +1962,110 @@ void Context::Render() {
     m_plane->Draw(m_normalProgram.get());
     */
 
-/*
-    Framebuffer::BindToDefault();
-
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-    m_postProgram->Use();
-    m_postProgram->SetUniform("transform",
-        glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 2.0f, 1.0f)));
-    m_framebuffer->GetColorAttachment()->Bind();
-    m_postProgram->SetUniform("tex", 0);
-    m_postProgram->SetUniform("gamma", m_gamma);
-    m_plane->Draw(m_postProgram.get());   */
+    m_prevView = view;
+    m_prevProjection = unjitteredProjection;
+    m_frameIndex++;
+    m_renderTargetPool->EndFrame();
 }
 
-void Context::DrawScene(const glm::mat4& view,
-    const glm::mat4& projection,
-    const Program* program) {
+void Context::DrawFullscreenTriangle() const {
+    m_emptyVertexLayout->Bind();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
 
-    program->Use();
-    auto modelTransform =
+void Context::BuildScene() {
+    m_sceneObjects.clear();
+    auto AddObject = [&](const Mesh* mesh, MaterialPtr material,
+        const glm::mat4& modelTransform, bool dynamic = false) {
+        SceneObject object;
+        object.mesh = mesh;
+        object.material = material;
+        object.modelTransform = modelTransform;
+        object.dynamic = dynamic;
+        object.UpdateBounds();
+        m_sceneObjects.push_back(object);
+    };
+
+    AddObject(m_box.get(), m_planeMaterial,
         glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f)) *
-        glm::scale(glm::mat4(1.0f), glm::vec3(40.0f, 1.0f, 40.0f));
-    auto transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_planeMaterial->SetToProgram(program);
-    m_box->Draw(program);
-
-    modelTransform =
+        glm::scale(glm::mat4(1.0f), glm::vec3(40.0f, 1.0f, 40.0f)));
+
+    AddObject(m_box.get(), m_box1Material,
         glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.75f, -4.0f)) *
         glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
-        glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_box1Material->SetToProgram(program);
-    m_box->Draw(program);
+        glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f)));
 
-    modelTransform =
+    AddObject(m_box.get(), m_box2Material,
         glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.75f, 2.0f)) *
         glm::rotate(glm::mat4(1.0f), glm::radians(20.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
+        glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f)));
+
+    // spun by AnimateScene()
+    m_spinningBoxIndex = m_sceneObjects.size();
+    AddObject(m_box.get(), m_box2Material, GetSpinningBoxTransform(50.0f), true);
+
+    if (m_model) {
+        auto modelTransform =
+            glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.55f, 0.0f)) *
+            glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) *
+            glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
+        for (int i = 0; i < m_model->GetMeshCount(); i++) {
+            auto mesh = m_model->GetMesh(i);
+            AddObject(mesh.get(), mesh->GetMaterial(), modelTransform);
+        }
+    }
+
+    m_sceneBoundsMin = glm::vec3(std::numeric_limits<float>::max());
+    m_sceneBoundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (auto& object : m_sceneObjects) {
+        m_sceneBoundsMin = glm::min(m_sceneBoundsMin, object.boundsMin);
+        m_sceneBoundsMax = glm::max(m_sceneBoundsMax, object.boundsMax);
+    }
+    if (m_shadowMap)
+        m_shadowMap->Invalidate();
+    if (m_cascadedShadowMap)
+        m_cascadedShadowMap->Invalidate();
+}
+
+void Context::BakeLightmap(bool forceBake) {
+    // a failed bake keeps the plain meshes and the screen space ao
+    m_lightmap = Lightmap::Create(m_sceneObjects, m_skyboxSh,
+        "./image/lightmap.cache", forceBake);
+}
+
+glm::mat4 Context::GetSpinningBoxTransform(float angle) const {
+    return glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 1.75f, -2.0f)) *
+        glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f)) *
         glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_box2Material->SetToProgram(program);
-    m_box->Draw(program);
-
-    modelTransform =
-        glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 1.75f, -2.0f)) *
-        glm::rotate(glm::mat4(1.0f), glm::radians(50.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
-        glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_box2Material->SetToProgram(program);
-    m_box->Draw(program);
-
-    modelTransform =
-        glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.55f, 0.0f)) *
-        glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f)) *
-        glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
-    transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_model->Draw(program);
+}
+
+void Context::AnimateScene() {
+    for (auto& object : m_sceneObjects)
+        object.prevModelTransform = object.modelTransform;
+    if (!m_animation || m_spinningBoxIndex >= m_sceneObjects.size())
+        return;
+    auto& box = m_sceneObjects[m_spinningBoxIndex];
+    box.modelTransform = GetSpinningBoxTransform(50.0f + (float)glfwGetTime() * 30.0f);
+    box.UpdateBounds();
+    // dynamic objects may leave the bounds every shadow caster is fitted to
+    m_sceneBoundsMin = glm::min(m_sceneBoundsMin, box.boundsMin);
+    m_sceneBoundsMax = glm::max(m_sceneBoundsMax, box.boundsMax);
+    if (m_visibilityBuffer)
+        m_visibilityBuffer->UpdateTransforms(m_sceneObjects);
+}
+
+void Context::DrawScene(const glm::mat4& view,
+    const glm::mat4& projection,
+    const Program* program) {
+
+    program->Use();
+    for (auto& object : m_sceneObjects) {
+        program->SetUniform("transform", projection * view * object.modelTransform);
+        program->SetUniform("modelTransform", object.modelTransform);
+        program->SetUniform("prevModelTransform", object.prevModelTransform);
+        program->SetUniform("lightmapped", object.lightmapped ? 1 : 0);
+        if (object.material)
+            object.material->SetToProgram(program);
+        object.mesh->Draw(program);
+    }
 }
\ No newline at end of file
@@ -11,6 +11,21 @@
 #include "model.h"
 #include "framebuffer.h"
 #include "shadow_map.h"
+#include "cascaded_shadow_map.h"
+#include "shadow_atlas.h"
+#include "gpu_timer.h"
+#include "spherical_harmonics.h"
+#include "prefiltered_env_map.h"
+#include "lightmap.h"
+#include "reflection_probe.h"
+#include "auto_exposure.h"
+#include "multisample_framebuffer.h"
+#include "dynamic_resolution.h"
+#include "grass_field.h"
+#include "particle_system.h"
+#include "depth_pyramid.h"
+#include "visibility_buffer.h"
+#include "render_graph.h"
 
 CLASS_PTR(Context)
 class Context {
@@ -25,15 +40,35 @@ public:
     void DrawScene(const glm::mat4& view,
         const glm::mat4& projection,
         const Program* program);
+    // covers the bound viewport, for programs built on fullscreen.vs
+    void DrawFullscreenTriangle() const;
 
 private:
     Context() {}
     bool Init();
+    void GenerateSsaoKernel(int kernelSize);
+    bool ApplyResize();
+    void CreateAoHistoryTextures();
+    void CreateTaaHistoryTextures();
+    void ApplyQualityLevel();
+    void CreateTransparentWindows(int count);
+    void BuildScene();
+    void BakeLightmap(bool forceBake);
+    void AnimateScene();
+    glm::mat4 GetSpinningBoxTransform(float angle) const;
     ProgramUPtr m_program;
     ProgramUPtr m_simpleProgram;
+    // position only vertex stream, no color output
+    ProgramUPtr m_depthProgram;
     ProgramUPtr m_textureProgram;
-    ProgramUPtr m_postProgram;
+    // one pass over the tone mapped frame, every enabled per pixel
+    // effect is a define of post.fs
+    ProgramVariantsUPtr m_postPrograms;
     float m_gamma {1.0f};
+    bool m_grayscale { false };
+    bool m_invert { false };
+    bool m_useVignette { false };
+    glm::vec2 m_vignette { glm::vec2(0.5f, 0.4f) };
 
     MeshUPtr m_box;
     MeshUPtr m_plane;
@@ -65,6 +100,15 @@ private:
     MaterialPtr m_box1Material;
     MaterialPtr m_box2Material;
     TexturePtr m_windowTexture;
+    // transparent windows, drawn in any order with weighted blended
+    // order independent transparency and composited over the lit frame
+    ProgramUPtr m_oitProgram;
+    ProgramUPtr m_oitCompositeProgram;
+    std::vector<glm::vec4> m_windowInstances;
+    BufferUPtr m_windowInstanceBuffer;
+    VertexLayoutUPtr m_windowInstance;
+    int m_windowCount { 16 };
+    bool m_useTransparency { true };
 
     // camera parameter
     bool m_cameraControl { false };
@@ -75,38 +119,165 @@ private:
     glm::vec3 m_cameraFront { glm::vec3(0.0f, 0.0f, -1.0f) };
     glm::vec3 m_cameraUp { glm::vec3(0.0f, 1.0f, 0.0f) };
 
-    // framebuffer
-    FramebufferUPtr m_framebuffer;
+    // the scene renders into an R11G11B10F target, a luminance histogram
+    // of it drives the exposure and tone mapping writes the srgb backbuffer
+    ProgramUPtr m_luminanceProgram;
+    ProgramUPtr m_histogramProgram;
+    ProgramUPtr m_exposureProgram;
+    AutoExposureUPtr m_autoExposure;
+    bool m_useAutoExposure { true };
+    float m_manualExposure { 1.0f };
+    // in stops, on top of either exposure
+    float m_exposureCompensation { 0.0f };
+    float m_exposureAdaptationRate { 1.5f };
+    double m_prevFrameTime { 0.0 };
+    // bloom: a chain of half sized levels, each downsampled from the
+    // previous with 13 taps, then tent upsampled back onto each other
+    ProgramVariantsUPtr m_bloomDownsamplePrograms;
+    ProgramUPtr m_bloomUpsampleProgram;
+    bool m_useBloom { true };
+    float m_bloomIntensity { 0.04f };
+    float m_bloomRadius { 0.005f };
+    int m_bloomLevelCount { 5 };
+    static constexpr int MAX_BLOOM_LEVEL_COUNT = 8;
+    static constexpr int HISTOGRAM_BIN_COUNT = 64;
+    static constexpr float HISTOGRAM_LOG_MIN = -10.0f;
+    static constexpr float HISTOGRAM_LOG_MAX = 6.0f;
+
+    // bound for draws whose vertex shader needs no attributes
+    VertexLayoutUPtr m_emptyVertexLayout;
+
+    // per frame pass declarations and transient render targets
+    RenderTargetPoolUPtr m_renderTargetPool;
+    RenderGraphUPtr m_renderGraph;
+    int m_gBufferDebugSelect { 0 };
+    int m_ssaoDebugSelect { 0 };
 
     // cubemap
     CubeTextureUPtr m_cubeTexture;
     ProgramUPtr m_skyboxProgram;
     ProgramUPtr m_envMapProgram;
+    // diffuse ambient of the skybox, projected once at load time
+    SphericalHarmonics m_skyboxSh;
+    bool m_useShAmbient { true };
+    float m_shAmbientIntensity { 0.4f };
+    // glossy reflections, one GGX roughness per mip
+    PrefilteredEnvMapUPtr m_prefilteredEnvMap;
+    float m_envRoughness { 0.3f };
+    // dynamic reflections, a budget of probes is re-rendered every frame
+    // and the glossy box reads the nearest valid one
+    std::vector<ReflectionProbeUPtr> m_reflectionProbes;
+    ProgramUPtr m_probeProgram;
+    ProgramUPtr m_probeSkyProgram;
+    bool m_useReflectionProbes { true };
+    int m_probeUpdateBudget { 1 };
+    int m_nextProbe { 0 };
+    int m_probeDrawCount { 0 };
+    GpuTimerUPtr m_probeTimer;
+    static constexpr float PROBE_NEAR = 0.1f;
+    static constexpr float PROBE_FAR = 50.0f;
 
+    // chunked grass over the ground, culled and thinned every frame
     TexturePtr m_grassTexture;
     ProgramUPtr m_grassProgram;
-    std::vector<glm::vec3> m_grassPos;
+    GrassFieldUPtr m_grassField;
+    GpuTimerUPtr m_grassTimer;
+    bool m_useGrass { true };
+    int m_grassBladeCount { 1 << 20 };
+    glm::vec2 m_windDirection { glm::vec2(1.0f, 0.0f) };
+    float m_windStrength { 0.3f };
+    static constexpr float GRASS_FIELD_SIZE = 40.0f;
 
-    BufferUPtr m_grassPosBuffer;
-    VertexLayoutUPtr m_grassInstance;
+    // cpu simulated fountain drawn as additive billboards
+    ProgramUPtr m_particleProgram;
+    ParticleSystemUPtr m_particleSystem;
+    bool m_useParticles { true };
+    int m_particleCapacity { 1 << 20 };
+    float m_particleEmitRate { 100000.0f };
+    // emissions left over from the last frame, below one particle
+    float m_particleEmitCarry { 0.0f };
+    float m_particleSize { 0.03f };
+    float m_particleIntensity { 2.0f };
+    float m_particleBenchmark { 0.0f };
 
     // shadow map
     ShadowMapUPtr m_shadowMap;
-    ProgramUPtr m_lightingShadowProgram;
+    ProgramVariantsUPtr m_lightingShadowPrograms;
+    CascadedShadowMapUPtr m_cascadedShadowMap;
+    int m_cascadeCount { 3 };
+    float m_cascadeSplitLambda { 0.75f };
+    float m_shadowDistance { 40.0f };
+    float m_cascadeBlend { 0.1f };
+    int m_shadowDrawCount { 0 };
+    bool m_shadowTimeSlicing { true };
+    // quality tiers of shadow.glsl, cheapest first
+    enum ShadowFilter {
+        SHADOW_FILTER_SINGLE = 0,
+        SHADOW_FILTER_FOUR_TAP,
+        SHADOW_FILTER_PCF,
+        SHADOW_FILTER_POISSON,
+        SHADOW_FILTER_COUNT,
+    };
+    int m_shadowFilter { SHADOW_FILTER_PCF };
+    GpuTimerUPtr m_forwardTimer;
+    static constexpr int SHADOW_BENCHMARK_FRAMES = 120;
+    static constexpr int SHADOW_BENCHMARK_WARMUP_FRAMES = 20;
+    int m_shadowBenchmarkFrame { -1 };
+    float m_shadowFilterTimes[SHADOW_FILTER_COUNT] { 0.0f, };
+
+    // deferred lighting of the point lights, or the forward pass of the
+    // single shadowed light
+    enum ShadingMode { SHADING_MODE_DEFERRED = 0, SHADING_MODE_FORWARD };
+    int m_shadingMode { SHADING_MODE_DEFERRED };
+    // forward shading only runs for the visible surface, tested GL_EQUAL
+    // against the depth a prepass laid down
+    bool m_useDepthPrepass { true };
 
     // normal map
     TextureUPtr m_brickDiffuseTexture;
     TextureUPtr m_brickNormalTexture;
     ProgramUPtr m_normalProgram;
 
+    // render size, the window size times the dynamic resolution scale,
+    // follows the window once a resize has settled
     int m_width { WINDOW_WIDTH };
     int m_height { WINDOW_HEIGHT };
+    int m_windowWidth { WINDOW_WIDTH };
+    int m_windowHeight { WINDOW_HEIGHT };
+    double m_resizeTime { 0.0 };
+    static constexpr double RESIZE_SETTLE_TIME = 0.2;
+    // the render scale and quality level that hold the gpu frame time,
+    // the post pass upscales to the window
+    DynamicResolutionUPtr m_dynamicResolution;
+    bool m_useDynamicResolution { true };
+    GpuTimerUPtr m_frameTimer;
+    // at quality level 0, every level halves them
+    static constexpr int SHADOW_MAP_RESOLUTION = 1024;
+    static constexpr int CASCADE_RESOLUTION = 2048;
+
+    // every draw of DrawScene
+    std::vector<SceneObject> m_sceneObjects;
+    glm::vec3 m_sceneBoundsMin { glm::vec3(0.0f) };
+    glm::vec3 m_sceneBoundsMax { glm::vec3(0.0f) };
+    size_t m_spinningBoxIndex { 0 };
 
     // deferred shading
-    FramebufferUPtr m_deferGeoFramebuffer;
-    ProgramUPtr m_deferGeoProgram;
+    ProgramVariantsUPtr m_deferGeoPrograms;
+
+    // baked sky occlusion and bounce light of the static objects, replaces
+    // the screen space ambient occlusion of the g-buffer path
+    LightmapUPtr m_lightmap;
+    bool m_useLightmap { true };
 
-    ProgramUPtr m_deferLightProgram;
+    // visibility buffer: only (draw id, triangle id) and depth are
+    // rasterized, materials are resolved into the G-buffer once per pixel
+    enum GeometryMode { GEOMETRY_MODE_GBUFFER = 0, GEOMETRY_MODE_VISIBILITY };
+    int m_geometryMode { GEOMETRY_MODE_GBUFFER };
+    VisibilityBufferUPtr m_visibilityBuffer;
+    ProgramUPtr m_visibilityProgram;
+    ProgramVariantsUPtr m_visibilityResolvePrograms;
+
+    ProgramVariantsUPtr m_deferLightPrograms;
 
     struct DeferLight {
         glm::vec3 position;
@@ -114,17 +285,78 @@ private:
     };
     std::vector<DeferLight> m_deferLights;
 
+    // point light shadows share one atlas, the brightest lights with the
+    // largest screen coverage get the largest tiles
+    ShadowAtlasUPtr m_shadowAtlas;
+    bool m_useShadowAtlas { true };
+    // must match shadow_atlas.glsl, six tiles per light
+    static constexpr int MAX_SHADOW_ATLAS_TILES = 48;
+    static constexpr float POINT_SHADOW_NEAR = 0.1f;
+    // distance within which a point light visibly lights the scene
+    static constexpr float POINT_LIGHT_RADIUS = 5.0f;
+    int m_shadowedLightCount { 4 };
+    float m_pointShadowFar { 25.0f };
+    int m_atlasDrawCount { 0 };
+
     // ssao
-    FramebufferUPtr m_ssaoFramebuffer;
-    ProgramUPtr m_ssaoProgram;
+    ProgramVariantsUPtr m_ssaoPrograms;
     ModelUPtr m_model;  // for test rendering
     TextureUPtr m_ssaoNoiseTexture;
     std::vector<glm::vec3> m_ssaoSamples;
+    int m_ssaoKernelSize { 64 };
     float m_ssaoRadius { 1.0f };
 
-    ProgramUPtr m_blurProgram;
-    FramebufferUPtr m_ssaoBlurFramebuffer;
+    // ambient occlusion is computed at 1 / m_ssaoResolutionScale of the
+    // window size, blurred there and upsampled to full resolution
+    int m_ssaoResolutionScale { 2 };
+    float m_ssaoDepthSharpness { 16.0f };
+    ProgramUPtr m_ssaoBlurProgram;
+    ProgramUPtr m_ssaoUpsampleProgram;
     bool m_useSsao { true };
+
+    // horizon based ambient occlusion, an alternative to the ssao kernel
+    enum AoMode { AO_MODE_SSAO = 0, AO_MODE_GTAO };
+    int m_aoMode { AO_MODE_GTAO };
+    DepthPyramidUPtr m_depthPyramid;
+    ProgramUPtr m_linearDepthProgram;
+    ProgramUPtr m_depthDownsampleProgram;
+    ProgramVariantsUPtr m_gtaoPrograms;
+    ProgramUPtr m_gtaoTemporalProgram;
+    TexturePtr m_gtaoHistory[2];
+    int m_gtaoHistoryIndex { 0 };
+    bool m_gtaoHistoryValid { false };
+    bool m_gtaoTemporal { true };
+    int m_gtaoSliceCount { 2 };
+    int m_gtaoStepCount { 4 };
+    float m_gtaoPower { 1.5f };
+
+    // anti-aliasing of the lit image, msaa is only possible on the
+    // forward path and can be combined with either
+    enum AaMode { AA_MODE_NONE = 0, AA_MODE_FXAA, AA_MODE_TAA, AA_MODE_COUNT };
+    int m_aaMode { AA_MODE_TAA };
+    GpuTimerUPtr m_aaTimer;
+    // temporal anti-aliasing: the projection moves by a sub pixel halton
+    // offset every frame and the resolve accumulates the jittered frames
+    ProgramVariantsUPtr m_taaPrograms;
+    TexturePtr m_taaHistory[2];
+    int m_taaHistoryIndex { 0 };
+    bool m_taaHistoryValid { false };
+    float m_taaHistoryWeight { 0.9f };
+    static constexpr int TAA_JITTER_PHASE_COUNT = 8;
+    // fxaa on the tone mapped image, luma comes in its alpha
+    ProgramUPtr m_fxaaProgram;
+    float m_fxaaEdgeThreshold { 0.125f };
+    float m_fxaaEdgeThresholdMin { 0.0312f };
+    float m_fxaaSubpixelQuality { 0.75f };
+    // forward shading draws into this and resolves, 1 sample draws directly
+    MultisampleFramebufferUPtr m_forwardMsaa;
+    int m_forwardSampleCount { 1 };
+
+    // previous frame state for temporal reprojection, m_prevProjection
+    // is without the taa jitter
+    uint32_t m_frameIndex { 0 };
+    glm::mat4 m_prevView { glm::mat4(1.0f) };
+    glm::mat4 m_prevProjection { glm::mat4(1.0f) };
 };
 
 #endif // __CONTEXT_H__
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "depth_pyramid.h"
+
+DepthPyramidUPtr DepthPyramid::Create(int width, int height, int levelCount) {
+    auto depthPyramid = DepthPyramidUPtr(new DepthPyramid());
+    if (!depthPyramid->Init(width, height, levelCount))
+        return nullptr;
+    return std::move(depthPyramid);
+}
+
+DepthPyramid::~DepthPyramid() {
+    if (!m_framebuffers.empty()) {
+        glDeleteFramebuffers((GLsizei)m_framebuffers.size(), m_framebuffers.data());
+    }
+}
+
+glm::ivec2 DepthPyramid::GetLevelSize(int level) const {
+    return glm::ivec2(
+        std::max(m_texture->GetWidth() >> level, 1),
+        std::max(m_texture->GetHeight() >> level, 1));
+}
+
+void DepthPyramid::BindLevel(int level) const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[level]);
+    auto size = GetLevelSize(level);
+    glViewport(0, 0, size.x, size.y);
+}
+
+void DepthPyramid::SetSourceLevel(int level) const {
+    m_texture->Bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
+}
+
+void DepthPyramid::ResetSourceLevel() const {
+    m_texture->Bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GetLevelCount() - 1);
+}
+
+bool DepthPyramid::Init(int width, int height, int levelCount) {
+    int maxLevelCount = 1;
+    while ((std::max(width, height) >> maxLevelCount) > 0)
+        maxLevelCount++;
+    levelCount = std::min(levelCount, maxLevelCount);
+
+    m_texture = Texture::Create(width, height, GL_R32F, GL_FLOAT);
+    for (int level = 1; level < levelCount; level++) {
+        auto size = glm::ivec2(std::max(width >> level, 1), std::max(height >> level, 1));
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, size.x, size.y, 0,
+            GL_RED, GL_FLOAT, nullptr);
+    }
+    // depth must not be interpolated across silhouettes
+    m_texture->SetFilter(GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST);
+
+    m_framebuffers.resize(levelCount);
+    glGenFramebuffers(levelCount, m_framebuffers.data());
+    for (int level = 0; level < levelCount; level++) {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[level]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, m_texture->Get(), level);
+        auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            SPDLOG_ERROR("failed to complete depth pyramid framebuffer: {:x}", status);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            return false;
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    ResetSourceLevel();
+    return true;
+}
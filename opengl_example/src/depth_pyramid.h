@@ -0,0 +1,33 @@
+#ifndef __DEPTH_PYRAMID_H__
+#define __DEPTH_PYRAMID_H__
+
+#include "texture.h"
+
+// linear view space depth with a mip chain, each level holding the
+// closest depth of the 2x2 texels below it
+CLASS_PTR(DepthPyramid);
+class DepthPyramid {
+public:
+    static DepthPyramidUPtr Create(int width, int height, int levelCount);
+    ~DepthPyramid();
+
+    const TexturePtr GetTexture() const { return m_texture; }
+    int GetLevelCount() const { return (int)m_framebuffers.size(); }
+    glm::ivec2 GetLevelSize(int level) const;
+
+    // bind the framebuffer writing to the given level and set the viewport
+    void BindLevel(int level) const;
+    // restrict sampling of the texture to a single level while the next
+    // level is rendered, to avoid a feedback loop
+    void SetSourceLevel(int level) const;
+    void ResetSourceLevel() const;
+
+private:
+    DepthPyramid() {}
+    bool Init(int width, int height, int levelCount);
+
+    TexturePtr m_texture;
+    std::vector<uint32_t> m_framebuffers;
+};
+
+#endif // __DEPTH_PYRAMID_H__
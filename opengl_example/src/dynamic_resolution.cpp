@@ -0,0 +1,51 @@
+#include "dynamic_resolution.h"
+#include <algorithm>
+
+DynamicResolutionUPtr DynamicResolution::Create(float targetMs) {
+    auto dynamicResolution = DynamicResolutionUPtr(new DynamicResolution());
+    dynamicResolution->m_targetMs = targetMs;
+    return std::move(dynamicResolution);
+}
+
+void DynamicResolution::Reset() {
+    m_scale = 1.0f;
+    m_qualityLevel = 0;
+}
+
+void DynamicResolution::SetMinScale(float minScale) {
+    m_minScale = glm::clamp(minScale, SCALE_STEP, 1.0f);
+    m_scale = std::max(m_scale, m_minScale);
+}
+
+bool DynamicResolution::Update(float frameMs, int sampleCount) {
+    if (sampleCount < MIN_SAMPLE_COUNT || frameMs <= 0.0f)
+        return false;
+
+    float scale = m_scale;
+    int qualityLevel = m_qualityLevel;
+    if (frameMs > m_targetMs) {
+        if (m_scale > m_minScale) {
+            // at least one step down
+            scale = std::min(m_scale * sqrtf(m_targetMs / frameMs), m_scale - SCALE_STEP);
+        }
+        else if (m_qualityLevel < QUALITY_LEVEL_COUNT - 1) {
+            qualityLevel++;
+        }
+    }
+    else if (frameMs < m_targetMs * HEADROOM) {
+        if (m_qualityLevel > 0) {
+            qualityLevel--;
+        }
+        else if (m_scale < 1.0f) {
+            // grows slower than it shrinks
+            scale = std::min(m_scale * sqrtf(m_targetMs * HEADROOM / frameMs),
+                m_scale + 2.0f * SCALE_STEP);
+        }
+    }
+    scale = glm::clamp(roundf(scale / SCALE_STEP) * SCALE_STEP, m_minScale, 1.0f);
+    if (scale == m_scale && qualityLevel == m_qualityLevel)
+        return false;
+    m_scale = scale;
+    m_qualityLevel = qualityLevel;
+    return true;
+}
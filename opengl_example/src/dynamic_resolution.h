@@ -0,0 +1,48 @@
+#ifndef __DYNAMIC_RESOLUTION_H__
+#define __DYNAMIC_RESOLUTION_H__
+
+#include "common.h"
+
+// governor of the internal render scale. gpu time is taken to grow with
+// the pixel count, the scale moves towards the target frame time in
+// quantized steps. once the minimum scale is reached the quality level
+// goes up, lowering secondary settings, and comes back down first
+CLASS_PTR(DynamicResolution)
+class DynamicResolution {
+public:
+    static DynamicResolutionUPtr Create(float targetMs);
+
+    // frameMs is the averaged gpu frame time of sampleCount frames since
+    // the last change. returns true if the scale or the level changed,
+    // the measurement should restart then
+    bool Update(float frameMs, int sampleCount);
+    void Reset();
+
+    void SetTargetMs(float targetMs) { m_targetMs = targetMs; }
+    float GetTargetMs() const { return m_targetMs; }
+    void SetMinScale(float minScale);
+    float GetMinScale() const { return m_minScale; }
+    // fraction of the window size per axis
+    float GetScale() const { return m_scale; }
+    // 0 is full quality
+    int GetQualityLevel() const { return m_qualityLevel; }
+
+    static constexpr int QUALITY_LEVEL_COUNT = 3;
+
+private:
+    DynamicResolution() {}
+
+    float m_targetMs { 16.6f };
+    float m_minScale { 0.5f };
+    float m_scale { 1.0f };
+    int m_qualityLevel { 0 };
+
+    static constexpr float SCALE_STEP = 0.05f;
+    // frames measured before a decision
+    static constexpr int MIN_SAMPLE_COUNT = 10;
+    // the scale only grows while this far under the target, so it does
+    // not oscillate around it
+    static constexpr float HEADROOM = 0.85f;
+};
+
+#endif // __DYNAMIC_RESOLUTION_H__
@@ -1,8 +1,9 @@
 #include "framebuffer.h"
 
-FramebufferUPtr Framebuffer::Create(const std::vector<TexturePtr>& colorAttachments) {
+FramebufferUPtr Framebuffer::Create(const std::vector<TexturePtr>& colorAttachments,
+    TexturePtr depthStencilAttachment) {
     auto framebuffer = FramebufferUPtr(new Framebuffer());
-    if (!framebuffer->InitWithColorAttachments(colorAttachments))
+    if (!framebuffer->InitWithColorAttachments(colorAttachments, depthStencilAttachment))
         return nullptr;
     return std::move(framebuffer);
 }
@@ -24,8 +25,10 @@ void Framebuffer::Bind() const {
     glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
 }
 
-bool Framebuffer::InitWithColorAttachments(const std::vector<TexturePtr>& colorAttachments) {
+bool Framebuffer::InitWithColorAttachments(const std::vector<TexturePtr>& colorAttachments,
+    TexturePtr depthStencilAttachment) {
         m_colorAttachments = colorAttachments;
+        m_depthStencilAttachment = depthStencilAttachment;
         glGenFramebuffers(1, &m_framebuffer);
         glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
 
@@ -46,14 +49,22 @@ bool Framebuffer::InitWithColorAttachments(const std::vector<TexturePtr>& colorA
   int width = m_colorAttachments[0]->GetWidth();
   int height = m_colorAttachments[0]->GetHeight();
 
-    glGenRenderbuffers(1, &m_depthStencilBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencilBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    if (m_depthStencilAttachment) {
+        // sampled depth, e.g. for reconstructing position from the G-buffer
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+            GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
+            m_depthStencilAttachment->Get(), 0);
+    }
+    else {
+        glGenRenderbuffers(1, &m_depthStencilBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencilBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
-    glFramebufferRenderbuffer(
-        GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-        GL_RENDERBUFFER, m_depthStencilBuffer);
+        glFramebufferRenderbuffer(
+            GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+            GL_RENDERBUFFER, m_depthStencilBuffer);
+    }
 
     auto result = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (result != GL_FRAMEBUFFER_COMPLETE) {
@@ -6,7 +6,8 @@
 CLASS_PTR(Framebuffer);
 class Framebuffer {
 public:
-    static FramebufferUPtr Create(const std::vector<TexturePtr>& colorAttachments);
+    static FramebufferUPtr Create(const std::vector<TexturePtr>& colorAttachments,
+        TexturePtr depthStencilAttachment = nullptr);
     static void BindToDefault();
     ~Framebuffer();
 
@@ -14,14 +15,17 @@ public:
     void Bind() const;
     int GetColorAttachmentCount() const { return (int)m_colorAttachments.size(); }
     const TexturePtr GetColorAttachment(int index = 0) const {return m_colorAttachments[index];}
+    const TexturePtr GetDepthStencilAttachment() const { return m_depthStencilAttachment; }
 
 private:
     Framebuffer() {}
-    bool InitWithColorAttachments(const std::vector<TexturePtr>& colorAttachments);
+    bool InitWithColorAttachments(const std::vector<TexturePtr>& colorAttachments,
+        TexturePtr depthStencilAttachment);
 
     uint32_t m_framebuffer { 0 };
     uint32_t m_depthStencilBuffer { 0 };
     std::vector<TexturePtr> m_colorAttachments;
+    TexturePtr m_depthStencilAttachment;
 };
 
 #endif // __FRAMEBUFFER_H__
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include "gpu_timer.h"
+#include <algorithm>
+
+GpuTimerUPtr GpuTimer::Create() {
+    auto timer = GpuTimerUPtr(new GpuTimer());
+    timer->Init();
+    return std::move(timer);
+}
+
+GpuTimer::~GpuTimer() {
+    glDeleteQueries(QUERY_COUNT * 2, m_queries);
+}
+
+void GpuTimer::Init() {
+    glGenQueries(QUERY_COUNT * 2, m_queries);
+}
+
+void GpuTimer::Begin() {
+    // collect whatever has finished, the query about to be reused was
+    // issued QUERY_COUNT frames ago and is waited for if it is still running
+    for (int i = 0; i < QUERY_COUNT; i++) {
+        if (m_pending[i])
+            ReadResult(i, i == m_current);
+    }
+    glQueryCounter(m_queries[m_current * 2], GL_TIMESTAMP);
+}
+
+void GpuTimer::End() {
+    glQueryCounter(m_queries[m_current * 2 + 1], GL_TIMESTAMP);
+    m_pending[m_current] = true;
+    m_current = (m_current + 1) % QUERY_COUNT;
+}
+
+void GpuTimer::Reset() {
+    // work measured before the reset is dropped once it finishes,
+    // waiting for it here would stall the cpu
+    for (int i = 0; i < QUERY_COUNT; i++)
+        m_stale[i] = m_pending[i];
+    m_averageMs = 0.0f;
+    m_sampleCount = 0;
+}
+
+void GpuTimer::ReadResult(int index, bool wait) {
+    if (!wait) {
+        int available = 0;
+        // the end timestamp finishes last
+        glGetQueryObjectiv(m_queries[index * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+    }
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    glGetQueryObjectui64v(m_queries[index * 2], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(m_queries[index * 2 + 1], GL_QUERY_RESULT, &end);
+    m_pending[index] = false;
+    if (m_stale[index]) {
+        m_stale[index] = false;
+        return;
+    }
+
+    float ms = (float)(end - begin) / 1000000.0f;
+    m_sampleCount++;
+    // plain mean for the first samples, then an exponential moving average
+    float weight = std::max(1.0f / (float)m_sampleCount, 0.05f);
+    m_averageMs += (ms - m_averageMs) * weight;
+}
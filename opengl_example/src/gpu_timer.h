@@ -0,0 +1,38 @@
+#ifndef __GPU_TIMER_H__
+#define __GPU_TIMER_H__
+
+#include "common.h"
+
+// gpu time spent between Begin() and End(). results are read back a few
+// frames later, so measuring never makes the cpu wait for the gpu.
+// measured with a pair of timestamps, so timers may nest
+CLASS_PTR(GpuTimer)
+class GpuTimer {
+public:
+    static GpuTimerUPtr Create();
+    ~GpuTimer();
+
+    void Begin();
+    void End();
+    // running average of the finished measurements
+    float GetAverageMs() const { return m_averageMs; }
+    int GetSampleCount() const { return m_sampleCount; }
+    void Reset();
+
+private:
+    GpuTimer() {}
+    void Init();
+    void ReadResult(int index, bool wait);
+
+    static constexpr int QUERY_COUNT = 4;
+    // begin and end timestamp of every measurement in flight
+    uint32_t m_queries[QUERY_COUNT * 2] { 0, };
+    bool m_pending[QUERY_COUNT] { false, };
+    // issued before the last Reset(), read back but not averaged
+    bool m_stale[QUERY_COUNT] { false, };
+    int m_current { 0 };
+    float m_averageMs { 0.0f };
+    int m_sampleCount { 0 };
+};
+
+#endif // __GPU_TIMER_H__
@@ -0,0 +1,194 @@
+#include "grass_field.h"
+#include <algorithm>
+#include <cstring>
+
+GrassFieldUPtr GrassField::Create(const Mesh* bladeMesh, int bladeCount,
+    float fieldSize, const glm::vec2& bladeSize) {
+    auto grassField = GrassFieldUPtr(new GrassField());
+    if (!grassField->Init(bladeMesh, bladeCount, fieldSize, bladeSize))
+        return nullptr;
+    return std::move(grassField);
+}
+
+GrassField::~GrassField() {
+    if (m_instanceBuffer)
+        glDeleteBuffers(1, &m_instanceBuffer);
+}
+
+// integer hash, spreads consecutive indices over the whole range
+static uint32_t HashIndex(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static float HashToUnit(uint32_t x) {
+    return (float)(HashIndex(x) >> 8) / (float)(1u << 24);
+}
+
+bool GrassField::Init(const Mesh* bladeMesh, int bladeCount,
+    float fieldSize, const glm::vec2& bladeSize) {
+    if (bladeCount <= 0 || fieldSize <= 0.0f) {
+        SPDLOG_ERROR("invalid grass field: {} blades over {}", bladeCount, fieldSize);
+        return false;
+    }
+    m_bladeMesh = bladeMesh;
+    m_bladeSize = bladeSize;
+
+    // the same index always gets the same blade, whatever the blade count
+    std::vector<glm::vec4> blades(bladeCount);
+    for (int i = 0; i < bladeCount; i++) {
+        uint32_t seed = (uint32_t)i * 4;
+        blades[i] = glm::vec4(
+            (HashToUnit(seed) - 0.5f) * fieldSize,
+            (HashToUnit(seed + 1) - 0.5f) * fieldSize,
+            HashToUnit(seed + 2) * glm::radians(360.0f),
+            HashToUnit(seed + 3));
+    }
+
+    // counting sort into the chunk grid
+    int gridSize = std::max((int)ceilf(fieldSize / CHUNK_SIZE), 1);
+    float chunkSize = fieldSize / (float)gridSize;
+    auto GetChunkIndex = [&](const glm::vec4& blade) {
+        int x = glm::clamp((int)((blade.x / fieldSize + 0.5f) * gridSize), 0, gridSize - 1);
+        int z = glm::clamp((int)((blade.y / fieldSize + 0.5f) * gridSize), 0, gridSize - 1);
+        return z * gridSize + x;
+    };
+    std::vector<uint32_t> offsets(gridSize * gridSize + 1, 0);
+    for (auto& blade : blades)
+        offsets[GetChunkIndex(blade) + 1]++;
+    for (size_t i = 1; i < offsets.size(); i++)
+        offsets[i] += offsets[i - 1];
+
+    m_blades.resize(bladeCount);
+    auto next = offsets;
+    for (auto& blade : blades)
+        m_blades[next[GetChunkIndex(blade)]++] = blade;
+
+    // a blade leans and turns at most its height away from its root
+    float margin = bladeSize.x * 0.5f + bladeSize.y;
+    m_chunks.clear();
+    for (int z = 0; z < gridSize; z++) {
+        for (int x = 0; x < gridSize; x++) {
+            int index = z * gridSize + x;
+            Chunk chunk;
+            chunk.first = offsets[index];
+            chunk.count = offsets[index + 1] - offsets[index];
+            if (!chunk.count)
+                continue;
+            auto begin = m_blades.begin() + chunk.first;
+            std::sort(begin, begin + chunk.count,
+                [](const glm::vec4& a, const glm::vec4& b) { return a.w < b.w; });
+            auto cellMin = glm::vec2(x, z) * chunkSize - fieldSize * 0.5f;
+            chunk.boundsMin = glm::vec3(cellMin.x - margin, 0.0f, cellMin.y - margin);
+            chunk.boundsMax = glm::vec3(cellMin.x + chunkSize + margin,
+                bladeSize.y, cellMin.y + chunkSize + margin);
+            m_chunks.push_back(chunk);
+        }
+    }
+    m_visibleRanges.reserve(m_chunks.size());
+
+    // sized for the whole field, only the visible prefix is rewritten
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_blades.size() * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+
+    m_vertexLayout = VertexLayout::Create();
+    m_vertexLayout->Bind();
+    bladeMesh->GetVertexBuffer()->Bind();
+    m_vertexLayout->SetAttrib(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+    m_vertexLayout->SetAttrib(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, texCoord));
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    m_vertexLayout->SetAttrib(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+    glVertexAttribDivisor(3, 1);
+    bladeMesh->GetIndexBuffer()->Bind();
+    return true;
+}
+
+void GrassField::SetLodDistances(float lodStart, float lodEnd) {
+    m_lodStart = std::max(lodStart, 0.0f);
+    m_lodEnd = std::max(lodEnd, m_lodStart + 0.1f);
+}
+
+float GrassField::GetDensity(float distance) const {
+    return glm::clamp((m_lodEnd - distance) / (m_lodEnd - m_lodStart), 0.0f, 1.0f);
+}
+
+void GrassField::Update(const glm::mat4& viewProjection, const glm::vec3& cameraPos) {
+    // frustum planes from the rows of the view projection, pointing inside
+    glm::vec4 planes[6];
+    auto row = [&](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i],
+            viewProjection[2][i], viewProjection[3][i]);
+    };
+    for (int i = 0; i < 3; i++) {
+        planes[i * 2] = row(3) + row(i);
+        planes[i * 2 + 1] = row(3) - row(i);
+    }
+
+    m_visibleRanges.clear();
+    m_visibleBladeCount = 0;
+    for (auto& chunk : m_chunks) {
+        bool inside = true;
+        for (auto& plane : planes) {
+            // the corner furthest along the plane normal
+            auto corner = glm::vec3(
+                plane.x > 0.0f ? chunk.boundsMax.x : chunk.boundsMin.x,
+                plane.y > 0.0f ? chunk.boundsMax.y : chunk.boundsMin.y,
+                plane.z > 0.0f ? chunk.boundsMax.z : chunk.boundsMin.z);
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+                inside = false;
+                break;
+            }
+        }
+        if (!inside)
+            continue;
+
+        // the density at the nearest point keeps every blade any part of
+        // the chunk needs, grass.vs fades out the ones past their own cutoff
+        auto nearest = glm::clamp(cameraPos, chunk.boundsMin, chunk.boundsMax);
+        float density = GetDensity(glm::length(nearest - cameraPos));
+        auto begin = m_blades.begin() + chunk.first;
+        uint32_t count = (uint32_t)(std::lower_bound(begin, begin + chunk.count, density,
+            [](const glm::vec4& blade, float value) { return blade.w < value; }) - begin);
+        if (!count)
+            continue;
+        m_visibleRanges.push_back(glm::uvec2(chunk.first, count));
+        m_visibleBladeCount += count;
+    }
+    if (!m_visibleBladeCount)
+        return;
+
+    // invalidating lets the driver hand out fresh storage instead of
+    // waiting for the draw still reading last frame's blades
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    auto instances = (glm::vec4*)glMapBufferRange(GL_ARRAY_BUFFER, 0,
+        m_visibleBladeCount * sizeof(glm::vec4),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!instances) {
+        SPDLOG_ERROR("failed to map grass instance buffer");
+        m_visibleBladeCount = 0;
+        return;
+    }
+    for (auto& range : m_visibleRanges) {
+        memcpy(instances, m_blades.data() + range.x, range.y * sizeof(glm::vec4));
+        instances += range.y;
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void GrassField::SetToProgram(const Program* program) const {
+    program->SetUniform("bladeSize", m_bladeSize);
+    program->SetUniform("lodDistances", glm::vec2(m_lodStart, m_lodEnd));
+}
+
+void GrassField::Draw() const {
+    if (!m_visibleBladeCount)
+        return;
+    m_vertexLayout->Bind();
+    glDrawElementsInstanced(GL_TRIANGLES, m_bladeMesh->GetIndexBuffer()->GetCount(),
+        GL_UNSIGNED_INT, 0, m_visibleBladeCount);
+}
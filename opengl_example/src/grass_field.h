@@ -0,0 +1,67 @@
+#ifndef __GRASS_FIELD_H__
+#define __GRASS_FIELD_H__
+
+#include "common.h"
+#include "mesh.h"
+#include "program.h"
+
+// a square field of grass blades on the ground around the origin.
+// the blades are bucketed into a grid of chunks and sorted by a stable
+// per blade hash inside each chunk, so thinning a chunk down to a density
+// is drawing a prefix of it. every frame the chunks outside the frustum
+// are skipped and the prefixes of the others are streamed into one
+// instance buffer, drawn with a single instanced call
+CLASS_PTR(GrassField)
+class GrassField {
+public:
+    // bladeSize is the width and height of the textured blade quad
+    static GrassFieldUPtr Create(const Mesh* bladeMesh, int bladeCount,
+        float fieldSize, const glm::vec2& bladeSize);
+    ~GrassField();
+
+    // full density up to lodStart, thinned down to nothing at lodEnd
+    void SetLodDistances(float lodStart, float lodEnd);
+    // culls and thins the chunks for the camera, streams the visible blades
+    void Update(const glm::mat4& viewProjection, const glm::vec3& cameraPos);
+    // blade size and distance thinning, grass.vs fades the blades with it
+    void SetToProgram(const Program* program) const;
+    void Draw() const;
+
+    int GetBladeCount() const { return (int)m_blades.size(); }
+    int GetChunkCount() const { return (int)m_chunks.size(); }
+    int GetVisibleChunkCount() const { return (int)m_visibleRanges.size(); }
+    int GetVisibleBladeCount() const { return m_visibleBladeCount; }
+    float GetLodStart() const { return m_lodStart; }
+    float GetLodEnd() const { return m_lodEnd; }
+
+private:
+    GrassField() {}
+    bool Init(const Mesh* bladeMesh, int bladeCount,
+        float fieldSize, const glm::vec2& bladeSize);
+    float GetDensity(float distance) const;
+
+    struct Chunk {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        uint32_t first;
+        uint32_t count;
+    };
+    static constexpr float CHUNK_SIZE = 2.5f;
+
+    const Mesh* m_bladeMesh { nullptr };
+    // x, z, rotation around y, hash in [0, 1). grouped by chunk and
+    // sorted by the hash inside every chunk
+    std::vector<glm::vec4> m_blades;
+    std::vector<Chunk> m_chunks;
+    // first blade and blade count of what survived Update()
+    std::vector<glm::uvec2> m_visibleRanges;
+    int m_visibleBladeCount { 0 };
+    glm::vec2 m_bladeSize { glm::vec2(1.0f) };
+    float m_lodStart { 4.0f };
+    float m_lodEnd { 20.0f };
+
+    uint32_t m_instanceBuffer { 0 };
+    VertexLayoutUPtr m_vertexLayout;
+};
+
+#endif // __GRASS_FIELD_H__
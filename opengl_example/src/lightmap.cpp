@@ -0,0 +1,443 @@
+#include "lightmap.h"
+#include "bvh.h"
+#include "parallel.h"
+// the implementation is compiled into shadow_atlas.cpp
+#include <imstb_rectpack.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x50414d4c; // "LMAP"
+const uint32_t CACHE_VERSION = 1;
+// texel density to start packing with, halved until every chart fits
+const float MAX_TEXELS_PER_UNIT = 16.0f;
+const float MIN_TEXELS_PER_UNIT = 0.25f;
+// texels around every chart, filled by dilation so bilinear lookups at
+// the chart edges never read a neighbouring chart
+const int CHART_PADDING = 2;
+// reflectance every bounce is assumed to have
+const float BOUNCE_ALBEDO = 0.5f;
+// rays start this far off the surface to not hit it again
+const float RAY_BIAS = 0.01f;
+
+// static object geometry in world space
+struct ObjectGeometry {
+    size_t objectIndex { 0 };
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+};
+
+// triangles of one object that are connected and face the same
+// dominant axis, projected onto the plane of that axis
+struct Chart {
+    int object { 0 };
+    int axis { 0 };
+    std::vector<int> triangles;
+    glm::vec2 boundsMin { glm::vec2(std::numeric_limits<float>::max()) };
+    glm::vec2 boundsMax { glm::vec2(-std::numeric_limits<float>::max()) };
+};
+
+int DominantAxis(const glm::vec3& normal) {
+    auto a = glm::abs(normal);
+    int axis = a.x >= a.y && a.x >= a.z ? 0 : (a.y >= a.z ? 1 : 2);
+    return axis * 2 + (normal[axis] < 0.0f ? 1 : 0);
+}
+
+glm::vec2 Project(const glm::vec3& position, int axis) {
+    int a = axis / 2;
+    return glm::vec2(position[(a + 1) % 3], position[(a + 2) % 3]);
+}
+
+int FindRoot(std::vector<int>& parents, int i) {
+    while (parents[i] != i) {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+glm::vec2 Hammersley(uint32_t i, uint32_t count) {
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return glm::vec2((float)i / (float)count, (float)bits * 2.3283064365386963e-10f);
+}
+
+// per texel offset of the sample pattern, trades banding for noise
+glm::vec2 TexelJitter(uint32_t texel) {
+    uint32_t h = texel * 747796405u + 2891336453u;
+    h = ((h >> ((h >> 28u) + 4u)) ^ h) * 277803737u;
+    h = (h >> 22u) ^ h;
+    return glm::vec2((float)(h & 0xffff), (float)(h >> 16)) / 65536.0f;
+}
+
+uint64_t HashSource(const std::vector<ObjectGeometry>& geometries,
+    const SphericalHarmonics& sky, int size, int sampleCount) {
+    uint64_t hash = 14695981039346656037ull;
+    auto Mix = [&](const void* data, size_t byteCount) {
+        auto bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < byteCount; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    Mix(&size, sizeof(size));
+    Mix(&sampleCount, sizeof(sampleCount));
+    for (auto& geometry : geometries) {
+        Mix(geometry.positions.data(), geometry.positions.size() * sizeof(glm::vec3));
+        Mix(geometry.indices.data(), geometry.indices.size() * sizeof(uint32_t));
+    }
+    for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; i++)
+        Mix(&sky.GetCoefficient(i), sizeof(glm::vec3));
+    return hash;
+}
+
+}
+
+LightmapUPtr Lightmap::Create(std::vector<SceneObject>& objects,
+    const SphericalHarmonics& sky, const std::string& cachePath,
+    bool forceBake, int size, int sampleCount) {
+    auto lightmap = LightmapUPtr(new Lightmap());
+    if (!lightmap->Init(objects, sky, cachePath, forceBake, size, sampleCount))
+        return nullptr;
+    return std::move(lightmap);
+}
+
+bool Lightmap::Init(std::vector<SceneObject>& objects, const SphericalHarmonics& sky,
+    const std::string& cachePath, bool forceBake, int size, int sampleCount) {
+    m_size = size;
+    // rays are traced in whole packets
+    m_sampleCount = (std::max(sampleCount, 1) + Bvh::PACKET_SIZE - 1) /
+        Bvh::PACKET_SIZE * Bvh::PACKET_SIZE;
+
+    // read the static meshes back and move them to world space
+    std::vector<ObjectGeometry> geometries;
+    for (size_t i = 0; i < objects.size(); i++) {
+        auto& object = objects[i];
+        if (object.dynamic || !object.mesh || object.mesh->GetPrimitiveType() != GL_TRIANGLES)
+            continue;
+        ObjectGeometry geometry;
+        geometry.objectIndex = i;
+        geometry.vertices.resize(object.mesh->GetVertexBuffer()->GetCount());
+        geometry.indices.resize(object.mesh->GetIndexBuffer()->GetCount());
+        object.mesh->GetVertexBuffer()->GetData(geometry.vertices.data());
+        object.mesh->GetIndexBuffer()->GetData(geometry.indices.data());
+        auto normalTransform = glm::transpose(glm::inverse(glm::mat3(object.modelTransform)));
+        for (auto& vertex : geometry.vertices) {
+            geometry.positions.push_back(
+                glm::vec3(object.modelTransform * glm::vec4(vertex.position, 1.0f)));
+            geometry.normals.push_back(glm::normalize(normalTransform * vertex.normal));
+        }
+        geometries.push_back(std::move(geometry));
+    }
+    if (geometries.empty()) {
+        SPDLOG_ERROR("no static triangle mesh to lightmap");
+        return false;
+    }
+
+    // charts: union the triangles that share a vertex and a dominant axis
+    std::vector<Chart> charts;
+    for (int g = 0; g < (int)geometries.size(); g++) {
+        auto& geometry = geometries[g];
+        int triangleCount = (int)geometry.indices.size() / 3;
+        std::vector<int> axes(triangleCount);
+        std::vector<int> parents(triangleCount);
+        std::vector<int> firstTriangles(geometry.positions.size() * 6, -1);
+        for (int t = 0; t < triangleCount; t++) {
+            auto& p0 = geometry.positions[geometry.indices[t * 3]];
+            auto& p1 = geometry.positions[geometry.indices[t * 3 + 1]];
+            auto& p2 = geometry.positions[geometry.indices[t * 3 + 2]];
+            axes[t] = DominantAxis(glm::cross(p1 - p0, p2 - p0));
+            parents[t] = t;
+            for (int k = 0; k < 3; k++) {
+                auto& first = firstTriangles[geometry.indices[t * 3 + k] * 6 + axes[t]];
+                if (first < 0)
+                    first = t;
+                else
+                    parents[FindRoot(parents, t)] = FindRoot(parents, first);
+            }
+        }
+        std::vector<int> rootCharts(triangleCount, -1);
+        for (int t = 0; t < triangleCount; t++) {
+            int root = FindRoot(parents, t);
+            if (rootCharts[root] < 0) {
+                rootCharts[root] = (int)charts.size();
+                charts.push_back(Chart());
+                charts.back().object = g;
+                charts.back().axis = axes[t];
+            }
+            auto& chart = charts[rootCharts[root]];
+            chart.triangles.push_back(t);
+            for (int k = 0; k < 3; k++) {
+                auto uv = Project(geometry.positions[geometry.indices[t * 3 + k]], chart.axis);
+                chart.boundsMin = glm::min(chart.boundsMin, uv);
+                chart.boundsMax = glm::max(chart.boundsMax, uv);
+            }
+        }
+    }
+    m_chartCount = (int)charts.size();
+
+    // pack every chart into one atlas at the highest density that fits
+    std::vector<stbrp_rect> rects(charts.size());
+    std::vector<stbrp_node> nodes(size);
+    float texelsPerUnit = MAX_TEXELS_PER_UNIT;
+    for (;;) {
+        for (size_t i = 0; i < charts.size(); i++) {
+            auto extent = (charts[i].boundsMax - charts[i].boundsMin) * texelsPerUnit;
+            rects[i].id = (int)i;
+            rects[i].w = std::max((int)ceilf(extent.x), 1) + CHART_PADDING * 2;
+            rects[i].h = std::max((int)ceilf(extent.y), 1) + CHART_PADDING * 2;
+            rects[i].was_packed = 0;
+        }
+        stbrp_context context;
+        stbrp_init_target(&context, size, size, nodes.data(), (int)nodes.size());
+        if (stbrp_pack_rects(&context, rects.data(), (int)rects.size()))
+            break;
+        texelsPerUnit *= 0.5f;
+        if (texelsPerUnit < MIN_TEXELS_PER_UNIT) {
+            SPDLOG_ERROR("lightmap charts do not fit into {}x{}", size, size);
+            return false;
+        }
+    }
+    m_texelsPerUnit = texelsPerUnit;
+
+    // unwrapped copy of every object, vertices are split at chart seams
+    std::vector<glm::vec3> texelPositions((size_t)size * size);
+    std::vector<glm::vec3> texelNormals((size_t)size * size);
+    std::vector<uint8_t> covered((size_t)size * size, 0);
+    std::vector<std::vector<int>> objectCharts(geometries.size());
+    for (int c = 0; c < (int)charts.size(); c++)
+        objectCharts[charts[c].object].push_back(c);
+    for (int g = 0; g < (int)geometries.size(); g++) {
+        auto& geometry = geometries[g];
+        std::vector<Vertex> vertices;
+        std::vector<glm::vec2> lightmapCoords;
+        std::vector<uint32_t> indices;
+        std::vector<int> remap(geometry.vertices.size());
+        for (int c : objectCharts[g]) {
+            auto& chart = charts[c];
+            auto& rect = rects[c];
+            auto offset = glm::vec2(rect.x + CHART_PADDING, rect.y + CHART_PADDING);
+            std::fill(remap.begin(), remap.end(), -1);
+            for (int t : chart.triangles) {
+                glm::vec2 texelCoords[3];
+                for (int k = 0; k < 3; k++) {
+                    uint32_t index = geometry.indices[t * 3 + k];
+                    texelCoords[k] = offset + (Project(geometry.positions[index], chart.axis) -
+                        chart.boundsMin) * texelsPerUnit;
+                    if (remap[index] < 0) {
+                        remap[index] = (int)vertices.size();
+                        vertices.push_back(geometry.vertices[index]);
+                        lightmapCoords.push_back(texelCoords[k] / (float)size);
+                    }
+                    indices.push_back((uint32_t)remap[index]);
+                }
+
+                // rasterize the texel centers the triangle covers
+                float area = (texelCoords[1].x - texelCoords[0].x) * (texelCoords[2].y - texelCoords[0].y) -
+                    (texelCoords[2].x - texelCoords[0].x) * (texelCoords[1].y - texelCoords[0].y);
+                if (fabsf(area) < 1e-8f)
+                    continue;
+                auto boundsMin = glm::min(glm::min(texelCoords[0], texelCoords[1]), texelCoords[2]);
+                auto boundsMax = glm::max(glm::max(texelCoords[0], texelCoords[1]), texelCoords[2]);
+                int x0 = std::max((int)floorf(boundsMin.x), 0);
+                int y0 = std::max((int)floorf(boundsMin.y), 0);
+                int x1 = std::min((int)ceilf(boundsMax.x), size - 1);
+                int y1 = std::min((int)ceilf(boundsMax.y), size - 1);
+                for (int y = y0; y <= y1; y++) {
+                    for (int x = x0; x <= x1; x++) {
+                        auto p = glm::vec2((float)x + 0.5f, (float)y + 0.5f);
+                        float weights[3];
+                        for (int k = 0; k < 3; k++) {
+                            auto& a = texelCoords[(k + 1) % 3];
+                            auto& b = texelCoords[(k + 2) % 3];
+                            weights[k] = ((b.x - a.x) * (p.y - a.y) - (p.x - a.x) * (b.y - a.y)) / area;
+                        }
+                        if (weights[0] < 0.0f || weights[1] < 0.0f || weights[2] < 0.0f)
+                            continue;
+                        size_t texel = (size_t)y * size + x;
+                        auto position = glm::vec3(0.0f);
+                        auto normal = glm::vec3(0.0f);
+                        for (int k = 0; k < 3; k++) {
+                            uint32_t index = geometry.indices[t * 3 + k];
+                            position += geometry.positions[index] * weights[k];
+                            normal += geometry.normals[index] * weights[k];
+                        }
+                        texelPositions[texel] = position;
+                        texelNormals[texel] = glm::normalize(normal);
+                        covered[texel] = 1;
+                    }
+                }
+            }
+        }
+
+        auto& object = objects[geometry.objectIndex];
+        auto mesh = Mesh::Create(vertices, indices, GL_TRIANGLES);
+        mesh->SetMaterial(object.mesh->GetMaterial());
+        mesh->SetLightmapCoords(lightmapCoords);
+        object.mesh = mesh.get();
+        object.lightmapped = true;
+        m_meshes.push_back(std::move(mesh));
+    }
+
+    std::vector<int> texels;
+    for (int i = 0; i < size * size; i++) {
+        if (covered[i])
+            texels.push_back(i);
+    }
+    m_texelCount = (int)texels.size();
+
+    auto sourceHash = HashSource(geometries, sky, size, m_sampleCount);
+    std::vector<glm::vec4> result;
+    m_fromCache = !forceBake && LoadCache(cachePath, sourceHash, result);
+    if (!m_fromCache) {
+        auto startTime = std::chrono::steady_clock::now();
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> faceNormals;
+        for (auto& geometry : geometries) {
+            for (size_t i = 0; i < geometry.indices.size(); i += 3) {
+                auto& p0 = geometry.positions[geometry.indices[i]];
+                auto& p1 = geometry.positions[geometry.indices[i + 1]];
+                auto& p2 = geometry.positions[geometry.indices[i + 2]];
+                positions.insert(positions.end(), { p0, p1, p2 });
+                auto normal = glm::cross(p1 - p0, p2 - p0);
+                float length = glm::length(normal);
+                faceNormals.push_back(length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+        }
+        auto bvh = Bvh::Build(positions);
+
+        // cosine weighted rays over the hemisphere of every texel. the ones
+        // that escape see the sky, the others pick up the sky light the hit
+        // surface reflects
+        result.assign((size_t)size * size, glm::vec4(0.0f));
+        ParallelFor((int)texels.size(), [&](int begin, int end) {
+            Bvh::Ray rays[Bvh::PACKET_SIZE];
+            Bvh::Hit hits[Bvh::PACKET_SIZE];
+            for (int i = begin; i < end; i++) {
+                int texel = texels[i];
+                auto& normal = texelNormals[texel];
+                auto up = fabsf(normal.z) < 0.999f ?
+                    glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                auto tangent = glm::normalize(glm::cross(up, normal));
+                auto bitangent = glm::cross(normal, tangent);
+                auto origin = texelPositions[texel] + normal * RAY_BIAS;
+                auto jitter = TexelJitter((uint32_t)texel);
+                auto bounce = glm::vec3(0.0f);
+                int visibleCount = 0;
+                for (int s = 0; s < m_sampleCount; s += Bvh::PACKET_SIZE) {
+                    for (int k = 0; k < Bvh::PACKET_SIZE; k++) {
+                        auto xi = glm::fract(Hammersley(s + k, m_sampleCount) + jitter);
+                        float r = sqrtf(xi.x);
+                        float phi = 2.0f * glm::pi<float>() * xi.y;
+                        rays[k].origin = origin;
+                        rays[k].direction = tangent * (r * cosf(phi)) +
+                            bitangent * (r * sinf(phi)) + normal * sqrtf(1.0f - xi.x);
+                    }
+                    bvh->IntersectPacket(rays, hits);
+                    for (int k = 0; k < Bvh::PACKET_SIZE; k++) {
+                        if (hits[k].triangle < 0) {
+                            visibleCount++;
+                            continue;
+                        }
+                        auto hitNormal = faceNormals[hits[k].triangle];
+                        if (glm::dot(hitNormal, rays[k].direction) > 0.0f)
+                            hitNormal = -hitNormal;
+                        bounce += BOUNCE_ALBEDO * glm::max(sky.Evaluate(hitNormal), glm::vec3(0.0f));
+                    }
+                }
+                result[texel] = glm::vec4(bounce / (float)m_sampleCount,
+                    (float)visibleCount / (float)m_sampleCount);
+            }
+        });
+
+        // grow the charts into their padding
+        for (int iteration = 0; iteration < CHART_PADDING; iteration++) {
+            auto grown = covered;
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    size_t texel = (size_t)y * size + x;
+                    if (covered[texel])
+                        continue;
+                    auto sum = glm::vec4(0.0f);
+                    int count = 0;
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            int nx = x + dx;
+                            int ny = y + dy;
+                            if (nx < 0 || ny < 0 || nx >= size || ny >= size ||
+                                !covered[(size_t)ny * size + nx])
+                                continue;
+                            sum += result[(size_t)ny * size + nx];
+                            count++;
+                        }
+                    }
+                    if (count > 0) {
+                        result[texel] = sum / (float)count;
+                        grown[texel] = 1;
+                    }
+                }
+            }
+            covered = std::move(grown);
+        }
+        m_bakeTime = std::chrono::duration<float>(
+            std::chrono::steady_clock::now() - startTime).count();
+        SPDLOG_INFO("baked lightmap: {} texels, {} triangles, {:.2f}s",
+            texels.size(), bvh->GetTriangleCount(), m_bakeTime);
+        SaveCache(cachePath, sourceHash, result);
+    }
+
+    m_texture = Texture::Create(size, size, GL_RGBA16F, GL_FLOAT);
+    m_texture->Bind();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_FLOAT, result.data());
+    m_texture->SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    return true;
+}
+
+bool Lightmap::LoadCache(const std::string& cachePath, uint64_t sourceHash,
+    std::vector<glm::vec4>& texels) const {
+    std::ifstream fin(cachePath, std::ios::binary);
+    if (!fin.is_open())
+        return false;
+    uint32_t magic = 0, version = 0;
+    int size = 0;
+    uint64_t hash = 0;
+    fin.read((char*)&magic, sizeof(magic));
+    fin.read((char*)&version, sizeof(version));
+    fin.read((char*)&size, sizeof(size));
+    fin.read((char*)&hash, sizeof(hash));
+    if (!fin || magic != CACHE_MAGIC || version != CACHE_VERSION ||
+        size != m_size || hash != sourceHash) {
+        SPDLOG_INFO("lightmap cache is stale: {}", cachePath);
+        return false;
+    }
+    texels.resize((size_t)m_size * m_size);
+    fin.read((char*)texels.data(), texels.size() * sizeof(glm::vec4));
+    if (!fin) {
+        SPDLOG_ERROR("failed to read lightmap cache: {}", cachePath);
+        texels.clear();
+        return false;
+    }
+    return true;
+}
+
+void Lightmap::SaveCache(const std::string& cachePath, uint64_t sourceHash,
+    const std::vector<glm::vec4>& texels) const {
+    std::ofstream fout(cachePath, std::ios::binary);
+    if (!fout.is_open()) {
+        SPDLOG_ERROR("failed to write lightmap cache: {}", cachePath);
+        return;
+    }
+    fout.write((const char*)&CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    fout.write((const char*)&CACHE_VERSION, sizeof(CACHE_VERSION));
+    fout.write((const char*)&m_size, sizeof(m_size));
+    fout.write((const char*)&sourceHash, sizeof(sourceHash));
+    fout.write((const char*)texels.data(), texels.size() * sizeof(glm::vec4));
+}
@@ -0,0 +1,52 @@
+#ifndef __LIGHTMAP_H__
+#define __LIGHTMAP_H__
+
+#include "mesh.h"
+#include "spherical_harmonics.h"
+
+// baked ambient of the static scene. every static object gets a copy of
+// its mesh with a second uv set into one shared atlas, whose texels are
+// traced on the cpu against the static triangles and cached to disk.
+// rgb is the irradiance / pi of one diffuse bounce of the sky,
+// a the fraction of the sky the texel sees
+CLASS_PTR(Lightmap)
+class Lightmap {
+public:
+    // switches the mesh of every static object to its unwrapped copy.
+    // forceBake traces again even if the cache is up to date
+    static LightmapUPtr Create(std::vector<SceneObject>& objects,
+        const SphericalHarmonics& sky, const std::string& cachePath,
+        bool forceBake = false, int size = 1024, int sampleCount = 64);
+
+    const Texture* GetTexture() const { return m_texture.get(); }
+    int GetSize() const { return m_size; }
+    int GetSampleCount() const { return m_sampleCount; }
+    float GetTexelsPerUnit() const { return m_texelsPerUnit; }
+    int GetObjectCount() const { return (int)m_meshes.size(); }
+    int GetChartCount() const { return m_chartCount; }
+    int GetTexelCount() const { return m_texelCount; }
+    // seconds spent tracing, 0 when loaded from the cache
+    float GetBakeTime() const { return m_bakeTime; }
+    bool IsFromCache() const { return m_fromCache; }
+
+private:
+    Lightmap() {}
+    bool Init(std::vector<SceneObject>& objects, const SphericalHarmonics& sky,
+        const std::string& cachePath, bool forceBake, int size, int sampleCount);
+    bool LoadCache(const std::string& cachePath, uint64_t sourceHash,
+        std::vector<glm::vec4>& texels) const;
+    void SaveCache(const std::string& cachePath, uint64_t sourceHash,
+        const std::vector<glm::vec4>& texels) const;
+
+    int m_size { 0 };
+    int m_sampleCount { 0 };
+    float m_texelsPerUnit { 0.0f };
+    int m_chartCount { 0 };
+    int m_texelCount { 0 };
+    float m_bakeTime { 0.0f };
+    bool m_fromCache { false };
+    std::vector<MeshUPtr> m_meshes;
+    TextureUPtr m_texture;
+};
+
+#endif // __LIGHTMAP_H__
@@ -65,7 +65,11 @@ int main(int argc, const char** argv) {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    // anti-aliasing is done on the lit image, the backbuffer only receives
+    // the post pass
+    glfwWindowHint(GLFW_SAMPLES, 0);
+    // tone mapping writes linear color, the hardware encodes it to srgb
+    glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 
     // glfw 윈도우 생성, 실패하면 에러 출력후 종료
     SPDLOG_INFO("Create glfw window");
@@ -1,4 +1,5 @@
 #include "mesh.h"
+#include <limits>
 
 MeshUPtr Mesh::Create(
     const std::vector<Vertex>& vertices,
@@ -16,6 +17,13 @@ void Mesh::Init(
     if (primitiveType == GL_TRIANGLES) {
         ComputeTangents(const_cast<std::vector<Vertex>&>(vertices), indices);
     }
+    if (!vertices.empty()) {
+        m_boundsMin = m_boundsMax = vertices[0].position;
+        for (auto& vertex : vertices) {
+            m_boundsMin = glm::min(m_boundsMin, vertex.position);
+            m_boundsMax = glm::max(m_boundsMax, vertex.position);
+        }
+    }
 
     m_vertexLayout = VertexLayout::Create();
     m_vertexBuffer = Buffer::CreateWithData(
@@ -28,6 +36,42 @@ void Mesh::Init(
     m_vertexLayout->SetAttrib(1, 3, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, normal));
     m_vertexLayout->SetAttrib(2, 2, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, texCoord));
     m_vertexLayout->SetAttrib(3, 3, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, tangent));
+
+    if (primitiveType == GL_TRIANGLES) {
+        std::vector<glm::vec3> positions(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+            positions[i] = vertices[i].position;
+        m_positionLayout = VertexLayout::Create();
+        m_positionBuffer = Buffer::CreateWithData(
+            GL_ARRAY_BUFFER, GL_STATIC_DRAW,
+            positions.data(), sizeof(glm::vec3), positions.size());
+        m_positionLayout->SetAttrib(0, 3, GL_FLOAT, false, sizeof(glm::vec3), 0);
+        m_indexBuffer->Bind();
+    }
+}
+
+void Mesh::SetLightmapCoords(const std::vector<glm::vec2>& coords) {
+    m_vertexLayout->Bind();
+    m_lightmapCoordBuffer = Buffer::CreateWithData(
+        GL_ARRAY_BUFFER, GL_STATIC_DRAW,
+        coords.data(), sizeof(glm::vec2), coords.size());
+    m_vertexLayout->SetAttrib(4, 2, GL_FLOAT, false, sizeof(glm::vec2), 0);
+}
+
+void SceneObject::UpdateBounds() {
+    auto& meshMin = mesh->GetBoundsMin();
+    auto& meshMax = mesh->GetBoundsMax();
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (int i = 0; i < 8; i++) {
+        auto corner = glm::vec3(
+            i & 1 ? meshMax.x : meshMin.x,
+            i & 2 ? meshMax.y : meshMin.y,
+            i & 4 ? meshMax.z : meshMin.z);
+        auto position = glm::vec3(modelTransform * glm::vec4(corner, 1.0f));
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
 }
 
 void Mesh::Draw(const Program* program) const {
@@ -38,6 +82,14 @@ void Mesh::Draw(const Program* program) const {
     glDrawElements(m_primitiveType, m_indexBuffer->GetCount(), GL_UNSIGNED_INT, 0);
 }
 
+void Mesh::DrawDepth() const {
+    if (m_positionLayout)
+        m_positionLayout->Bind();
+    else
+        m_vertexLayout->Bind();
+    glDrawElements(m_primitiveType, m_indexBuffer->GetCount(), GL_UNSIGNED_INT, 0);
+}
+
 MeshUPtr Mesh::CreateBox() {
     std::vector<Vertex> vertices = {
         Vertex { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec2(0.0f, 0.0f) },
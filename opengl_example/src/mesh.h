@@ -40,14 +40,23 @@ public:
     static MeshUPtr CreateBox();
     static MeshUPtr CreatePlane();
 
+    uint32_t GetPrimitiveType() const { return m_primitiveType; }
+    // object space bounding box of the vertices
+    const glm::vec3& GetBoundsMin() const { return m_boundsMin; }
+    const glm::vec3& GetBoundsMax() const { return m_boundsMax; }
     const VertexLayout* GetVertexLayout() const { return m_vertexLayout.get(); }
     BufferPtr GetVertexBuffer() const { return m_vertexBuffer; }
     BufferPtr GetIndexBuffer() const { return m_indexBuffer; }
+    // second uv set at attribute 4, one per vertex, see Lightmap
+    void SetLightmapCoords(const std::vector<glm::vec2>& coords);
+    bool HasLightmapCoords() const { return m_lightmapCoordBuffer != nullptr; }
 
     void SetMaterial(MaterialPtr material) { m_material = material; }
     MaterialPtr GetMaterial() const { return m_material; }
 
     void Draw(const Program* program) const;
+    // positions only, for passes that write nothing but depth
+    void DrawDepth() const;
 
     static void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
 
@@ -59,11 +68,35 @@ private:
         uint32_t primitiveType);
 
     uint32_t m_primitiveType { GL_TRIANGLES };
+    glm::vec3 m_boundsMin { glm::vec3(0.0f) };
+    glm::vec3 m_boundsMax { glm::vec3(0.0f) };
     VertexLayoutUPtr m_vertexLayout;
     BufferPtr m_vertexBuffer;
+    // de-interleaved copy of the positions, a quarter of the vertex size
+    VertexLayoutUPtr m_positionLayout;
+    BufferPtr m_positionBuffer;
     BufferPtr m_indexBuffer;
+    BufferPtr m_lightmapCoordBuffer;
 
     MaterialPtr m_material;
 };
 
+// one draw of the scene: a mesh, the material it uses and where it is placed
+struct SceneObject {
+    const Mesh* mesh { nullptr };
+    MaterialPtr material;
+    glm::mat4 modelTransform { glm::mat4(1.0f) };
+    // transform of the previous frame, for motion vectors
+    glm::mat4 prevModelTransform { glm::mat4(1.0f) };
+    // moves at runtime, kept out of cached shadow maps
+    bool dynamic { false };
+    // mesh carries lightmap coords into Lightmap's texture
+    bool lightmapped { false };
+    // world space bounding box
+    glm::vec3 boundsMin { glm::vec3(0.0f) };
+    glm::vec3 boundsMax { glm::vec3(0.0f) };
+
+    void UpdateBounds();
+};
+
 #endif // __MESH_H__
\ No newline at end of file
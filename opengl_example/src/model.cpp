@@ -17,7 +17,7 @@ bool Model::LoadByAssimp(const std::string& filename) {
     }
 
     auto dirname = filename.substr(0, filename.find_last_of("/"));
-    auto LoadTexture = [&](aiMaterial* material, aiTextureType type) -> TexturePtr {
+    auto LoadTexture = [&](aiMaterial* material, aiTextureType type, bool srgb) -> TexturePtr {
         if (material->GetTextureCount(type) <= 0)
             return nullptr;
         aiString filepath;
@@ -25,14 +25,14 @@ bool Model::LoadByAssimp(const std::string& filename) {
         auto image = Image::Load(fmt::format("{}/{}", dirname, filepath.C_Str()));
         if (!image)
             return nullptr;
-        return Texture::CreateFromImage(image.get());
+        return Texture::CreateFromImage(image.get(), srgb);
     };
 
     for (uint32_t i = 0; i < scene->mNumMaterials; i++) {
         auto material = scene->mMaterials[i];
         auto glMaterial = Material::Create();
-        glMaterial->diffuse = LoadTexture(material, aiTextureType_DIFFUSE);
-        glMaterial->specular = LoadTexture(material, aiTextureType_SPECULAR);
+        glMaterial->diffuse = LoadTexture(material, aiTextureType_DIFFUSE, true);
+        glMaterial->specular = LoadTexture(material, aiTextureType_SPECULAR, false);
         m_materials.push_back(std::move(glMaterial));
     }
 
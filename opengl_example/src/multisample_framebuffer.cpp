@@ -0,0 +1,65 @@
+#include "multisample_framebuffer.h"
+#include <algorithm>
+
+MultisampleFramebufferUPtr MultisampleFramebuffer::Create(int width, int height,
+    int sampleCount, uint32_t colorFormat) {
+    auto framebuffer = MultisampleFramebufferUPtr(new MultisampleFramebuffer());
+    if (!framebuffer->Init(width, height, sampleCount, colorFormat))
+        return nullptr;
+    return std::move(framebuffer);
+}
+
+MultisampleFramebuffer::~MultisampleFramebuffer() {
+    if (m_colorBuffer)
+        glDeleteRenderbuffers(1, &m_colorBuffer);
+    if (m_depthStencilBuffer)
+        glDeleteRenderbuffers(1, &m_depthStencilBuffer);
+    if (m_framebuffer)
+        glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+void MultisampleFramebuffer::Bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void MultisampleFramebuffer::Resolve(uint32_t framebuffer) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    // depth can not be averaged, each pixel keeps one of its samples
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height,
+        GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+bool MultisampleFramebuffer::Init(int width, int height, int sampleCount, uint32_t colorFormat) {
+    int maxSampleCount = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSampleCount);
+    m_width = width;
+    m_height = height;
+    m_sampleCount = std::min(sampleCount, maxSampleCount);
+    m_colorFormat = colorFormat;
+
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_sampleCount, m_colorFormat,
+        m_width, m_height);
+    glGenRenderbuffers(1, &m_depthStencilBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencilBuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_sampleCount, GL_DEPTH24_STENCIL8,
+        m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_RENDERBUFFER, m_colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+        GL_RENDERBUFFER, m_depthStencilBuffer);
+    auto result = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (result != GL_FRAMEBUFFER_COMPLETE) {
+        SPDLOG_ERROR("failed to create multisample framebuffer: {}", result);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef __MULTISAMPLE_FRAMEBUFFER_H__
+#define __MULTISAMPLE_FRAMEBUFFER_H__
+
+#include "common.h"
+
+// multisampled color and depth / stencil renderbuffers, drawn into and
+// then resolved into single sampled textures with a blit
+CLASS_PTR(MultisampleFramebuffer)
+class MultisampleFramebuffer {
+public:
+    static MultisampleFramebufferUPtr Create(int width, int height,
+        int sampleCount, uint32_t colorFormat);
+    ~MultisampleFramebuffer();
+
+    uint32_t Get() const { return m_framebuffer; }
+    void Bind() const;
+    // resolves color and depth into framebuffer, which must have the same
+    // size and formats, and leaves it bound
+    void Resolve(uint32_t framebuffer) const;
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetSampleCount() const { return m_sampleCount; }
+    uint32_t GetColorFormat() const { return m_colorFormat; }
+
+private:
+    MultisampleFramebuffer() {}
+    bool Init(int width, int height, int sampleCount, uint32_t colorFormat);
+
+    uint32_t m_framebuffer { 0 };
+    uint32_t m_colorBuffer { 0 };
+    uint32_t m_depthStencilBuffer { 0 };
+    int m_width { 0 };
+    int m_height { 0 };
+    int m_sampleCount { 0 };
+    uint32_t m_colorFormat { 0 };
+};
+
+#endif // __MULTISAMPLE_FRAMEBUFFER_H__
@@ -0,0 +1,25 @@
+#include "parallel.h"
+#include <algorithm>
+#include <thread>
+
+int GetWorkerCount() {
+    return std::max((int)std::thread::hardware_concurrency(), 1);
+}
+
+void ParallelFor(int count, const std::function<void(int, int)>& func) {
+    int workerCount = std::min(GetWorkerCount(), count);
+    if (workerCount <= 1) {
+        if (count > 0)
+            func(0, count);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workerCount; i++) {
+        int begin = count * i / workerCount;
+        int end = count * (i + 1) / workerCount;
+        threads.emplace_back(func, begin, end);
+    }
+    func(0, count / workerCount);
+    for (auto& thread : threads)
+        thread.join();
+}
@@ -0,0 +1,14 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include "common.h"
+#include <functional>
+
+// number of threads ParallelFor splits its work over
+int GetWorkerCount();
+// runs func(begin, end) over contiguous ranges of [0, count), one per
+// worker, and returns once every range is done. the calling thread
+// takes the first range
+void ParallelFor(int count, const std::function<void(int, int)>& func);
+
+#endif // __PARALLEL_H__
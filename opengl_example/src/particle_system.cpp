@@ -0,0 +1,309 @@
+#include "particle_system.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#if defined(__x86_64__) || defined(_M_X64)
+#define PARTICLE_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// msvc emits any intrinsic without a target switch
+#define AVX2_TARGET
+#else
+// only this function is built for avx2, the rest of the program keeps
+// running on any x86-64
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+static bool HasAvx2() {
+#if !defined(PARTICLE_AVX2)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    // the os also has to save the ymm registers
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    return avx2 && osSavesYmm;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+ParticleSystemUPtr ParticleSystem::Create(const Mesh* quadMesh, int capacity) {
+    auto particleSystem = ParticleSystemUPtr(new ParticleSystem());
+    if (!particleSystem->Init(quadMesh, capacity))
+        return nullptr;
+    return std::move(particleSystem);
+}
+
+float ParticleSystem::Benchmark(const Mesh* quadMesh, int particleCount, int frameCount) {
+    auto particleSystem = Create(quadMesh, particleCount);
+    if (!particleSystem)
+        return 0.0f;
+    particleSystem->SetLifetime(std::numeric_limits<float>::max());
+    particleSystem->Emit(particleCount);
+    float totalMs = 0.0f;
+    for (int i = 0; i < frameCount; i++) {
+        particleSystem->Update(1.0f / 60.0f);
+        totalMs += particleSystem->GetUpdateMs();
+    }
+    return totalMs > 0.0f ? (float)particleCount * frameCount / totalMs : 0.0f;
+}
+
+ParticleSystem::~ParticleSystem() {
+    for (int i = 0; i < RING_SIZE; i++) {
+        if (m_fences[i])
+            glDeleteSync(m_fences[i]);
+    }
+    if (m_instanceBuffer) {
+        if (m_persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        glDeleteBuffers(1, &m_instanceBuffer);
+    }
+}
+
+bool ParticleSystem::Init(const Mesh* quadMesh, int capacity) {
+    if (capacity <= 0) {
+        SPDLOG_ERROR("invalid particle capacity: {}", capacity);
+        return false;
+    }
+    m_quadMesh = quadMesh;
+    m_capacity = capacity;
+    m_useAvx2 = HasAvx2();
+
+    // padded so the last simd step of the alive range stays in bounds
+    size_t paddedCapacity = (capacity + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT;
+    for (auto array : { &m_positionX, &m_positionY, &m_positionZ,
+        &m_velocityX, &m_velocityY, &m_velocityZ, &m_life })
+        array->assign(paddedCapacity, 0.0f);
+    m_color.assign(paddedCapacity, 0);
+
+    // one segment per frame in flight
+    size_t bufferSize = (size_t)RING_SIZE * capacity * sizeof(Instance);
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    m_persistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+    if (m_persistent) {
+        uint32_t flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, flags);
+        m_mappedInstances = (Instance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags);
+        if (!m_mappedInstances) {
+            SPDLOG_ERROR("failed to map particle instance buffer");
+            return false;
+        }
+    }
+    else {
+        // mapped unsynchronized every frame instead, the fences keep the
+        // writes off the segments the gpu still reads
+        glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    m_vertexLayout = VertexLayout::Create();
+    m_vertexLayout->Bind();
+    quadMesh->GetVertexBuffer()->Bind();
+    m_vertexLayout->SetAttrib(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+    m_vertexLayout->SetAttrib(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, texCoord));
+    // the instance attributes point into the current segment, see Draw()
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    m_vertexLayout->SetAttrib(3, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), 0);
+    m_vertexLayout->SetAttrib(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance),
+        offsetof(Instance, color));
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribDivisor(4, 1);
+    quadMesh->GetIndexBuffer()->Bind();
+    return true;
+}
+
+void ParticleSystem::SetEmitter(const glm::vec3& position, float speed, float spread) {
+    m_emitterPosition = position;
+    m_emitSpeed = speed;
+    m_emitSpread = spread;
+}
+
+uint32_t ParticleSystem::NextRandom() {
+    // xorshift32
+    m_randomState ^= m_randomState << 13;
+    m_randomState ^= m_randomState >> 17;
+    m_randomState ^= m_randomState << 5;
+    return m_randomState;
+}
+
+void ParticleSystem::Emit(int count) {
+    auto NextUnit = [&]() {
+        return (float)(NextRandom() >> 8) / (float)(1u << 24);
+    };
+    count = std::min(count, m_capacity - m_aliveCount);
+    for (int n = 0; n < count; n++) {
+        int i = m_aliveCount++;
+        // inside a cone around +y
+        float angle = NextUnit() * glm::radians(360.0f);
+        float radius = m_emitSpread * sqrtf(NextUnit());
+        auto velocity = glm::normalize(glm::vec3(cosf(angle) * radius, 1.0f, sinf(angle) * radius)) *
+            m_emitSpeed * (0.75f + 0.5f * NextUnit());
+        m_positionX[i] = m_emitterPosition.x;
+        m_positionY[i] = m_emitterPosition.y;
+        m_positionZ[i] = m_emitterPosition.z;
+        m_velocityX[i] = velocity.x;
+        m_velocityY[i] = velocity.y;
+        m_velocityZ[i] = velocity.z;
+        m_life[i] = m_lifetime * (0.5f + 0.5f * NextUnit());
+        // warm colors, red fixed and green / blue varied
+        uint32_t green = 80 + (NextRandom() >> 24) * 140 / 255;
+        uint32_t blue = 20 + (NextRandom() >> 24) * 60 / 255;
+        m_color[i] = 255u | green << 8 | blue << 16 | 255u << 24;
+    }
+}
+
+#ifdef PARTICLE_AVX2
+AVX2_TARGET int ParticleSystem::SimulateAvx2(int begin, int end, float deltaTime) {
+    auto dt = _mm256_set1_ps(deltaTime);
+    auto drag = _mm256_set1_ps(std::max(1.0f - m_drag * deltaTime, 0.0f));
+    auto gravity = _mm256_set1_ps(m_gravity * deltaTime);
+    auto bounce = _mm256_set1_ps(-m_restitution);
+    auto zero = _mm256_setzero_ps();
+    float* positionX = m_positionX.data();
+    float* positionY = m_positionY.data();
+    float* positionZ = m_positionZ.data();
+    float* velocityX = m_velocityX.data();
+    float* velocityY = m_velocityY.data();
+    float* velocityZ = m_velocityZ.data();
+    float* life = m_life.data();
+    int i = begin;
+    for (; i + LANE_COUNT <= end; i += LANE_COUNT) {
+        auto vx = _mm256_mul_ps(_mm256_loadu_ps(velocityX + i), drag);
+        auto vy = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(velocityY + i), gravity), drag);
+        auto vz = _mm256_mul_ps(_mm256_loadu_ps(velocityZ + i), drag);
+        auto px = _mm256_add_ps(_mm256_loadu_ps(positionX + i), _mm256_mul_ps(vx, dt));
+        auto py = _mm256_add_ps(_mm256_loadu_ps(positionY + i), _mm256_mul_ps(vy, dt));
+        auto pz = _mm256_add_ps(_mm256_loadu_ps(positionZ + i), _mm256_mul_ps(vz, dt));
+        // bounce off the ground at y = 0, losing some speed
+        auto below = _mm256_cmp_ps(py, zero, _CMP_LT_OQ);
+        py = _mm256_blendv_ps(py, _mm256_sub_ps(zero, py), below);
+        vy = _mm256_blendv_ps(vy, _mm256_mul_ps(vy, bounce), below);
+        _mm256_storeu_ps(velocityX + i, vx);
+        _mm256_storeu_ps(velocityY + i, vy);
+        _mm256_storeu_ps(velocityZ + i, vz);
+        _mm256_storeu_ps(positionX + i, px);
+        _mm256_storeu_ps(positionY + i, py);
+        _mm256_storeu_ps(positionZ + i, pz);
+        _mm256_storeu_ps(life + i, _mm256_sub_ps(_mm256_loadu_ps(life + i), dt));
+    }
+    return i;
+}
+#endif
+
+void ParticleSystem::Simulate(int begin, int end, float deltaTime) {
+    float drag = std::max(1.0f - m_drag * deltaTime, 0.0f);
+    float gravity = m_gravity * deltaTime;
+    int i = begin;
+#ifdef PARTICLE_AVX2
+    if (m_useAvx2)
+        i = SimulateAvx2(begin, end, deltaTime);
+#endif
+    // the whole range without avx2, otherwise only a partial last step
+    for (; i < end; i++) {
+        m_velocityX[i] *= drag;
+        m_velocityY[i] = (m_velocityY[i] + gravity) * drag;
+        m_velocityZ[i] *= drag;
+        m_positionX[i] += m_velocityX[i] * deltaTime;
+        m_positionY[i] += m_velocityY[i] * deltaTime;
+        m_positionZ[i] += m_velocityZ[i] * deltaTime;
+        if (m_positionY[i] < 0.0f) {
+            m_positionY[i] = -m_positionY[i];
+            m_velocityY[i] *= -m_restitution;
+        }
+        m_life[i] -= deltaTime;
+    }
+}
+
+void ParticleSystem::Compact() {
+    // order does not matter to additive blending, so fill every hole with
+    // the last alive particle instead of shifting the rest down
+    int i = 0;
+    while (i < m_aliveCount) {
+        if (m_life[i] > 0.0f) {
+            i++;
+            continue;
+        }
+        int last = --m_aliveCount;
+        m_positionX[i] = m_positionX[last];
+        m_positionY[i] = m_positionY[last];
+        m_positionZ[i] = m_positionZ[last];
+        m_velocityX[i] = m_velocityX[last];
+        m_velocityY[i] = m_velocityY[last];
+        m_velocityZ[i] = m_velocityZ[last];
+        m_life[i] = m_life[last];
+        m_color[i] = m_color[last];
+    }
+}
+
+void ParticleSystem::Update(float deltaTime) {
+    auto startTime = std::chrono::steady_clock::now();
+    // whole simd steps per task
+    int paddedCount = (m_aliveCount + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT;
+    int taskCount = (paddedCount + TASK_SIZE - 1) / TASK_SIZE;
+    ParallelFor(taskCount, [&](int begin, int end) {
+        Simulate(begin * TASK_SIZE, std::min(end * TASK_SIZE, paddedCount), deltaTime);
+    });
+    Compact();
+    m_updateMs = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void ParticleSystem::Upload() {
+    m_segment = (m_segment + 1) % RING_SIZE;
+    // written RING_SIZE frames ago, normally long done
+    if (m_fences[m_segment]) {
+        glClientWaitSync(m_fences[m_segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(m_fences[m_segment]);
+        m_fences[m_segment] = nullptr;
+    }
+    m_drawCount = m_aliveCount;
+    if (!m_drawCount)
+        return;
+
+    size_t first = (size_t)m_segment * m_capacity;
+    Instance* instances = m_mappedInstances + first;
+    if (!m_persistent) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+        instances = (Instance*)glMapBufferRange(GL_ARRAY_BUFFER,
+            first * sizeof(Instance), m_drawCount * sizeof(Instance),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!instances) {
+            SPDLOG_ERROR("failed to map particle instance buffer");
+            m_drawCount = 0;
+            return;
+        }
+    }
+    ParallelFor((m_drawCount + TASK_SIZE - 1) / TASK_SIZE, [&](int begin, int end) {
+        for (int i = begin * TASK_SIZE; i < std::min(end * TASK_SIZE, m_drawCount); i++) {
+            instances[i] = Instance { glm::vec3(m_positionX[i], m_positionY[i], m_positionZ[i]),
+                m_life[i], m_color[i] };
+        }
+    });
+    if (!m_persistent)
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void ParticleSystem::Draw() {
+    if (!m_drawCount)
+        return;
+    m_vertexLayout->Bind();
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    uint64_t offset = (uint64_t)m_segment * m_capacity * sizeof(Instance);
+    m_vertexLayout->SetAttrib(3, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), offset);
+    m_vertexLayout->SetAttrib(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance),
+        offset + offsetof(Instance, color));
+    glDrawElementsInstanced(GL_TRIANGLES, m_quadMesh->GetIndexBuffer()->GetCount(),
+        GL_UNSIGNED_INT, 0, m_drawCount);
+    m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
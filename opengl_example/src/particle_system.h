@@ -0,0 +1,95 @@
+#ifndef __PARTICLE_SYSTEM_H__
+#define __PARTICLE_SYSTEM_H__
+
+#include "common.h"
+#include "mesh.h"
+#include "program.h"
+
+// a fountain of up to capacity particles kept as structure of arrays.
+// Update() integrates them on every worker, eight lanes at a time when
+// the cpu has avx2, then compacts the dead ones away by moving the last alive
+// particle into their slot. the alive particles are written into one
+// segment of a ring of instance buffers and drawn as camera facing quads
+CLASS_PTR(ParticleSystem)
+class ParticleSystem {
+public:
+    static ParticleSystemUPtr Create(const Mesh* quadMesh, int capacity);
+    // simulates particleCount immortal particles for frameCount frames in a
+    // system of its own and returns the particles updated per millisecond
+    static float Benchmark(const Mesh* quadMesh, int particleCount, int frameCount);
+    ~ParticleSystem();
+
+    void SetEmitter(const glm::vec3& position, float speed, float spread);
+    void SetLifetime(float lifetime) { m_lifetime = lifetime; }
+    // spawns up to count particles, fewer if the system is full
+    void Emit(int count);
+    // simulates deltaTime seconds and removes the particles that died
+    void Update(float deltaTime);
+    // writes the alive particles into the next ring segment
+    void Upload();
+    // fences the segment it reads for the Upload() that comes back to it
+    void Draw();
+
+    int GetCapacity() const { return m_capacity; }
+    int GetAliveCount() const { return m_aliveCount; }
+    // cpu time of the last Update(), simulation and compaction
+    float GetUpdateMs() const { return m_updateMs; }
+    // whether the ring stays mapped for the lifetime of the buffer
+    bool IsPersistentlyMapped() const { return m_persistent; }
+    bool IsUsingAvx2() const { return m_useAvx2; }
+
+private:
+    ParticleSystem() {}
+    bool Init(const Mesh* quadMesh, int capacity);
+    void Simulate(int begin, int end, float deltaTime);
+    // returns where the scalar loop picks up
+    int SimulateAvx2(int begin, int end, float deltaTime);
+    void Compact();
+    uint32_t NextRandom();
+
+    struct Instance {
+        glm::vec3 position;
+        float life;
+        uint32_t color;
+    };
+    static constexpr int RING_SIZE = 3;
+    // particles per simd step, the arrays are padded to a multiple of it
+    static constexpr int LANE_COUNT = 8;
+    // particles per ParallelFor task, large enough to be worth a thread
+    static constexpr int TASK_SIZE = 8192;
+
+    int m_capacity { 0 };
+    int m_aliveCount { 0 };
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_velocityX;
+    std::vector<float> m_velocityY;
+    std::vector<float> m_velocityZ;
+    // seconds left
+    std::vector<float> m_life;
+    // rgba8
+    std::vector<uint32_t> m_color;
+
+    glm::vec3 m_emitterPosition { glm::vec3(0.0f) };
+    float m_emitSpeed { 5.0f };
+    float m_emitSpread { 0.3f };
+    float m_lifetime { 3.0f };
+    float m_gravity { -9.8f };
+    float m_drag { 0.1f };
+    float m_restitution { 0.4f };
+    uint32_t m_randomState { 0x9e3779b9u };
+    float m_updateMs { 0.0f };
+    bool m_useAvx2 { false };
+
+    const Mesh* m_quadMesh { nullptr };
+    uint32_t m_instanceBuffer { 0 };
+    VertexLayoutUPtr m_vertexLayout;
+    bool m_persistent { false };
+    Instance* m_mappedInstances { nullptr };
+    GLsync m_fences[RING_SIZE] { nullptr, };
+    int m_segment { 0 };
+    int m_drawCount { 0 };
+};
+
+#endif // __PARTICLE_SYSTEM_H__
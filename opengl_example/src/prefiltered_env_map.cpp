@@ -0,0 +1,309 @@
+#include "prefiltered_env_map.h"
+#include "texture.h"
+#include "parallel.h"
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+const uint32_t CACHE_MAGIC = 0x564e4550; // "PENV"
+const uint32_t CACHE_VERSION = 2;
+const int SAMPLE_COUNT = 128;
+
+// one mip of a float cube map
+struct CubeLevel {
+    int size { 0 };
+    std::vector<glm::vec3> texels;
+
+    glm::vec3& At(int face, int x, int y) {
+        return texels[((size_t)face * size + y) * size + x];
+    }
+    const glm::vec3& At(int face, int x, int y) const {
+        return texels[((size_t)face * size + y) * size + x];
+    }
+
+    // bilinear within the face, clamped at its edges
+    glm::vec3 Sample(const glm::vec3& direction) const {
+        float u, v;
+        int face = CubeTexture::GetFaceCoord(direction, u, v);
+        float x = glm::clamp((u * 0.5f + 0.5f) * size - 0.5f, 0.0f, (float)(size - 1));
+        float y = glm::clamp((v * 0.5f + 0.5f) * size - 0.5f, 0.0f, (float)(size - 1));
+        int x0 = (int)x;
+        int y0 = (int)y;
+        int x1 = std::min(x0 + 1, size - 1);
+        int y1 = std::min(y0 + 1, size - 1);
+        float fx = x - (float)x0;
+        float fy = y - (float)y0;
+        return glm::mix(
+            glm::mix(At(face, x0, y0), At(face, x1, y0), fx),
+            glm::mix(At(face, x0, y1), At(face, x1, y1), fx), fy);
+    }
+};
+
+glm::vec3 TexelDirection(int face, int x, int y, int size) {
+    float u = ((float)x + 0.5f) * 2.0f / (float)size - 1.0f;
+    float v = ((float)y + 0.5f) * 2.0f / (float)size - 1.0f;
+    return glm::normalize(CubeTexture::GetFaceDirection(face, u, v));
+}
+
+// box filter of the source face images down to size, in linear space
+CubeLevel Downsample(const std::vector<const Image*>& faces, int size) {
+    CubeLevel level;
+    level.size = size;
+    level.texels.resize((size_t)6 * size * size);
+    ParallelFor(6 * size, [&](int begin, int end) {
+        for (int row = begin; row < end; row++) {
+            int face = row / size;
+            int y = row % size;
+            auto image = faces[face];
+            int channelCount = image->GetChannelCount();
+            int y0 = y * image->GetHeight() / size;
+            int y1 = std::max((y + 1) * image->GetHeight() / size, y0 + 1);
+            for (int x = 0; x < size; x++) {
+                int x0 = x * image->GetWidth() / size;
+                int x1 = std::max((x + 1) * image->GetWidth() / size, x0 + 1);
+                auto sum = glm::vec3(0.0f);
+                for (int sy = y0; sy < y1; sy++) {
+                    auto texel = image->GetData() +
+                        ((size_t)sy * image->GetWidth() + x0) * channelCount;
+                    for (int sx = x0; sx < x1; sx++, texel += channelCount) {
+                        for (int c = 0; c < 3; c++)
+                            sum[c] += SrgbToLinear(texel[std::min(c, channelCount - 1)]);
+                    }
+                }
+                level.At(face, x, y) = sum / (float)((x1 - x0) * (y1 - y0));
+            }
+        }
+    });
+    return level;
+}
+
+CubeLevel HalveLevel(const CubeLevel& source) {
+    CubeLevel level;
+    level.size = std::max(source.size / 2, 1);
+    level.texels.resize((size_t)6 * level.size * level.size);
+    for (int face = 0; face < 6; face++) {
+        for (int y = 0; y < level.size; y++) {
+            for (int x = 0; x < level.size; x++) {
+                int sx = std::min(x * 2 + 1, source.size - 1);
+                int sy = std::min(y * 2 + 1, source.size - 1);
+                level.At(face, x, y) = 0.25f * (
+                    source.At(face, x * 2, y * 2) + source.At(face, sx, y * 2) +
+                    source.At(face, x * 2, sy) + source.At(face, sx, sy));
+            }
+        }
+    }
+    return level;
+}
+
+glm::vec2 Hammersley(uint32_t i, uint32_t count) {
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return glm::vec2((float)i / (float)count, (float)bits * 2.3283064365386963e-10f);
+}
+
+uint64_t HashSource(const std::vector<const Image*>& faces) {
+    // fnv-1a over the sizes and a sparse sample of the texels
+    uint64_t hash = 14695981039346656037ull;
+    auto Mix = [&](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+    for (auto face : faces) {
+        Mix(face->GetWidth());
+        Mix(face->GetHeight());
+        Mix(face->GetChannelCount());
+        size_t byteCount = (size_t)face->GetWidth() * face->GetHeight() * face->GetChannelCount();
+        for (size_t i = 0; i < byteCount; i += 61)
+            Mix(face->GetData()[i]);
+    }
+    return hash;
+}
+
+}
+
+PrefilteredEnvMapUPtr PrefilteredEnvMap::Create(const std::vector<const Image*>& faces,
+    const std::string& cachePath, int size, int levelCount) {
+    auto envMap = PrefilteredEnvMapUPtr(new PrefilteredEnvMap());
+    if (!envMap->Init(faces, cachePath, size, levelCount))
+        return nullptr;
+    return std::move(envMap);
+}
+
+PrefilteredEnvMap::~PrefilteredEnvMap() {
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+}
+
+void PrefilteredEnvMap::Bind() const {
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture);
+}
+
+bool PrefilteredEnvMap::Init(const std::vector<const Image*>& faces,
+    const std::string& cachePath, int size, int levelCount) {
+    if (faces.size() != 6) {
+        SPDLOG_ERROR("cube map needs 6 faces, got {}", faces.size());
+        return false;
+    }
+    for (auto face : faces) {
+        if (!face) {
+            SPDLOG_ERROR("missing cube map face");
+            return false;
+        }
+    }
+    if (size < 1 || levelCount < 1 || (size >> (levelCount - 1)) < 1) {
+        SPDLOG_ERROR("invalid prefiltered env map size: {}, levels: {}", size, levelCount);
+        return false;
+    }
+    m_size = size;
+    m_levelCount = levelCount;
+
+    auto sourceHash = HashSource(faces);
+    if (!LoadCache(cachePath, sourceHash)) {
+        Prefilter(faces);
+        SaveCache(cachePath, sourceHash);
+    }
+    Upload();
+    // the cpu copy was only needed for the cache
+    m_levels.clear();
+    return true;
+}
+
+void PrefilteredEnvMap::Prefilter(const std::vector<const Image*>& faces) {
+    // the source as a mip chain, so the samples of wide lobes read
+    // pre-averaged texels instead of aliasing (filtered importance sampling)
+    std::vector<CubeLevel> source;
+    source.push_back(Downsample(faces, m_size));
+    while (source.back().size > 1)
+        source.push_back(HalveLevel(source.back()));
+    auto SampleSource = [&](const glm::vec3& direction, float lod) {
+        lod = glm::clamp(lod, 0.0f, (float)(source.size() - 1));
+        int lod0 = (int)lod;
+        int lod1 = std::min(lod0 + 1, (int)source.size() - 1);
+        return glm::mix(source[lod0].Sample(direction),
+            source[lod1].Sample(direction), lod - (float)lod0);
+    };
+    float texelSolidAngle = 4.0f * glm::pi<float>() / (6.0f * m_size * m_size);
+
+    m_levels.resize(m_levelCount);
+    m_levels[0] = source[0].texels;
+    for (int l = 1; l < m_levelCount; l++) {
+        CubeLevel level;
+        level.size = m_size >> l;
+        level.texels.resize((size_t)6 * level.size * level.size);
+        float roughness = (float)l / (float)(m_levelCount - 1);
+        float alpha = roughness * roughness;
+        // the lobe is centered on the reflection vector, n = v = r
+        ParallelFor(6 * level.size, [&](int begin, int end) {
+            for (int row = begin; row < end; row++) {
+                int face = row / level.size;
+                int y = row % level.size;
+                for (int x = 0; x < level.size; x++) {
+                    auto n = TexelDirection(face, x, y, level.size);
+                    auto up = fabsf(n.z) < 0.999f ?
+                        glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                    auto tangent = glm::normalize(glm::cross(up, n));
+                    auto bitangent = glm::cross(n, tangent);
+                    auto sum = glm::vec3(0.0f);
+                    float weight = 0.0f;
+                    for (int i = 0; i < SAMPLE_COUNT; i++) {
+                        auto xi = Hammersley(i, SAMPLE_COUNT);
+                        float phi = 2.0f * glm::pi<float>() * xi.x;
+                        float cosTheta = sqrtf((1.0f - xi.y) /
+                            (1.0f + (alpha * alpha - 1.0f) * xi.y));
+                        float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+                        auto h = tangent * (cosf(phi) * sinTheta) +
+                            bitangent * (sinf(phi) * sinTheta) + n * cosTheta;
+                        auto lightDir = 2.0f * glm::dot(n, h) * h - n;
+                        float nDotL = glm::dot(n, lightDir);
+                        if (nDotL <= 0.0f)
+                            continue;
+                        // pdf of l is D / 4 since n = v, read the source mip
+                        // whose texels cover the solid angle of one sample
+                        float d = alpha * alpha / (glm::pi<float>() *
+                            powf(cosTheta * cosTheta * (alpha * alpha - 1.0f) + 1.0f, 2.0f));
+                        float sampleSolidAngle = 4.0f / ((float)SAMPLE_COUNT * d + 0.0001f);
+                        float lod = 0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f;
+                        sum += SampleSource(lightDir, lod) * nDotL;
+                        weight += nDotL;
+                    }
+                    level.At(face, x, y) = weight > 0.0f ? sum / weight : sum;
+                }
+            }
+        });
+        m_levels[l] = std::move(level.texels);
+    }
+}
+
+bool PrefilteredEnvMap::LoadCache(const std::string& cachePath, uint64_t sourceHash) {
+    std::ifstream fin(cachePath, std::ios::binary);
+    if (!fin.is_open())
+        return false;
+    uint32_t magic = 0, version = 0;
+    int size = 0, levelCount = 0;
+    uint64_t hash = 0;
+    fin.read((char*)&magic, sizeof(magic));
+    fin.read((char*)&version, sizeof(version));
+    fin.read((char*)&size, sizeof(size));
+    fin.read((char*)&levelCount, sizeof(levelCount));
+    fin.read((char*)&hash, sizeof(hash));
+    if (!fin || magic != CACHE_MAGIC || version != CACHE_VERSION ||
+        size != m_size || levelCount != m_levelCount || hash != sourceHash) {
+        SPDLOG_INFO("prefiltered env map cache is stale: {}", cachePath);
+        return false;
+    }
+    m_levels.resize(m_levelCount);
+    for (int l = 0; l < m_levelCount; l++) {
+        int levelSize = m_size >> l;
+        m_levels[l].resize((size_t)6 * levelSize * levelSize);
+        fin.read((char*)m_levels[l].data(), m_levels[l].size() * sizeof(glm::vec3));
+    }
+    if (!fin) {
+        SPDLOG_ERROR("failed to read prefiltered env map cache: {}", cachePath);
+        m_levels.clear();
+        return false;
+    }
+    return true;
+}
+
+void PrefilteredEnvMap::SaveCache(const std::string& cachePath, uint64_t sourceHash) const {
+    std::ofstream fout(cachePath, std::ios::binary);
+    if (!fout.is_open()) {
+        SPDLOG_ERROR("failed to write prefiltered env map cache: {}", cachePath);
+        return;
+    }
+    fout.write((const char*)&CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    fout.write((const char*)&CACHE_VERSION, sizeof(CACHE_VERSION));
+    fout.write((const char*)&m_size, sizeof(m_size));
+    fout.write((const char*)&m_levelCount, sizeof(m_levelCount));
+    fout.write((const char*)&sourceHash, sizeof(sourceHash));
+    for (auto& level : m_levels)
+        fout.write((const char*)level.data(), level.size() * sizeof(glm::vec3));
+}
+
+void PrefilteredEnvMap::Upload() {
+    // filter across face edges, otherwise the blurry mips show the seams
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    glGenTextures(1, &m_texture);
+    Bind();
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1);
+    for (int l = 0; l < m_levelCount; l++) {
+        int levelSize = m_size >> l;
+        for (int face = 0; face < 6; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, l, GL_RGB16F,
+                levelSize, levelSize, 0, GL_RGB, GL_FLOAT,
+                m_levels[l].data() + (size_t)face * levelSize * levelSize);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef __PREFILTERED_ENV_MAP_H__
+#define __PREFILTERED_ENV_MAP_H__
+
+#include "image.h"
+
+// glossy reflections of a cube map. mip i holds the environment convolved
+// with the GGX lobe of roughness i / (levels - 1), so a reflection of any
+// roughness is a single textureLod. the convolution runs on the cpu at
+// load time and is cached to disk, later runs only upload the cache
+CLASS_PTR(PrefilteredEnvMap)
+class PrefilteredEnvMap {
+public:
+    // faces in cube map order +x -x +y -y +z -z, see CubeTexture
+    static PrefilteredEnvMapUPtr Create(const std::vector<const Image*>& faces,
+        const std::string& cachePath, int size = 256, int levelCount = 7);
+    ~PrefilteredEnvMap();
+
+    const uint32_t Get() const { return m_texture; }
+    void Bind() const;
+    int GetLevelCount() const { return m_levelCount; }
+
+private:
+    PrefilteredEnvMap() {}
+    bool Init(const std::vector<const Image*>& faces,
+        const std::string& cachePath, int size, int levelCount);
+    void Prefilter(const std::vector<const Image*>& faces);
+    bool LoadCache(const std::string& cachePath, uint64_t sourceHash);
+    void SaveCache(const std::string& cachePath, uint64_t sourceHash) const;
+    void Upload();
+
+    int m_size { 0 };
+    int m_levelCount { 0 };
+    // rgb of every level, faces one after another, rows top to bottom
+    std::vector<std::vector<glm::vec3>> m_levels;
+    uint32_t m_texture { 0 };
+};
+
+#endif // __PREFILTERED_ENV_MAP_H__
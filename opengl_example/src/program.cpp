@@ -1,4 +1,5 @@
 #include "program.h"
+#include <algorithm>
 
 ProgramUPtr Program::Create(const std::vector<ShaderPtr>& shaders) {
     auto program = ProgramUPtr(new Program());
@@ -8,14 +9,27 @@ ProgramUPtr Program::Create(const std::vector<ShaderPtr>& shaders) {
 }
 
 ProgramUPtr Program::Create(const std::string& vertShaderFilename,
-    const std::string& fragShaderFilename) {
-    ShaderPtr vs = Shader::CreateFromFile(vertShaderFilename, GL_VERTEX_SHADER);
-    ShaderPtr fs = Shader::CreateFromFile(fragShaderFilename, GL_FRAGMENT_SHADER);
+    const std::string& fragShaderFilename,
+    const std::vector<std::string>& defines) {
+    ShaderPtr vs = Shader::CreateFromFile(vertShaderFilename, GL_VERTEX_SHADER, defines);
+    ShaderPtr fs = Shader::CreateFromFile(fragShaderFilename, GL_FRAGMENT_SHADER, defines);
     if (!vs || !fs)
         return nullptr;
     return std::move(Create({vs, fs}));
 }
 
+ProgramUPtr Program::Create(const std::string& vertShaderFilename,
+    const std::string& geomShaderFilename,
+    const std::string& fragShaderFilename,
+    const std::vector<std::string>& defines) {
+    ShaderPtr vs = Shader::CreateFromFile(vertShaderFilename, GL_VERTEX_SHADER, defines);
+    ShaderPtr gs = Shader::CreateFromFile(geomShaderFilename, GL_GEOMETRY_SHADER, defines);
+    ShaderPtr fs = Shader::CreateFromFile(fragShaderFilename, GL_FRAGMENT_SHADER, defines);
+    if (!vs || !gs || !fs)
+        return nullptr;
+    return std::move(Create({vs, gs, fs}));
+}
+
 
 
 Program::~Program() {
@@ -73,4 +87,54 @@ void Program::SetUniform(const std::string& name, const glm::vec3& value) const
 void Program::SetUniform(const std::string& name, const glm::vec4& value) const {
     auto loc = glGetUniformLocation(m_program, name.c_str());
     glUniform4fv(loc, 1, glm::value_ptr(value));
+}
+
+ProgramVariantsUPtr ProgramVariants::Create(const std::string& vertShaderFilename,
+    const std::string& fragShaderFilename) {
+    auto variants = ProgramVariantsUPtr(new ProgramVariants());
+    variants->m_vertShaderFilename = vertShaderFilename;
+    variants->m_fragShaderFilename = fragShaderFilename;
+    return std::move(variants);
+}
+
+std::string ProgramVariants::MakeKey(const std::vector<std::string>& defines) {
+    auto sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+    std::string key;
+    for (auto& define : sorted) {
+        if (define.empty())
+            continue;
+        key += define;
+        key += ';';
+    }
+    return key;
+}
+
+const Program* ProgramVariants::Get(const std::vector<std::string>& defines) {
+    auto key = MakeKey(defines);
+    auto it = m_variants.find(key);
+    if (it != m_variants.end())
+        return it->second.get();
+
+    std::vector<std::string> usedDefines;
+    for (auto& define : defines) {
+        if (!define.empty())
+            usedDefines.push_back(define);
+    }
+    SPDLOG_INFO("compile program variant: {} / {} [{}]",
+        m_vertShaderFilename, m_fragShaderFilename, key);
+    // a failed variant is kept as nullptr so it is not recompiled every frame
+    auto program = Program::Create(m_vertShaderFilename, m_fragShaderFilename, usedDefines);
+    auto result = program.get();
+    m_variants[key] = std::move(program);
+    return result;
+}
+
+bool ProgramVariants::Prewarm(const std::vector<std::vector<std::string>>& defineSets) {
+    bool success = true;
+    for (auto& defines : defineSets) {
+        if (!Get(defines))
+            success = false;
+    }
+    return success;
 }
\ No newline at end of file
@@ -3,13 +3,20 @@
 
 #include "common.h"
 #include "shader.h"
+#include <unordered_map>
 
 CLASS_PTR(Program)
 class Program {
 public:
     static ProgramUPtr Create(const std::vector<ShaderPtr>& shaders);
     static ProgramUPtr Create(const std::string& vertShaderFilename,
-        const std::string& fragShaderFilename);
+        const std::string& fragShaderFilename,
+        const std::vector<std::string>& defines = {});
+    // with a geometry shader between the two
+    static ProgramUPtr Create(const std::string& vertShaderFilename,
+        const std::string& geomShaderFilename,
+        const std::string& fragShaderFilename,
+        const std::vector<std::string>& defines);
 
     ~Program();
     uint32_t Get() const { return m_program; }
@@ -28,4 +35,26 @@ private:
     uint32_t m_program { 0 };
 };
 
+// compiled permutations of one vertex/fragment shader pair,
+// keyed by the set of #defines they were built with
+CLASS_PTR(ProgramVariants)
+class ProgramVariants {
+public:
+    static ProgramVariantsUPtr Create(const std::string& vertShaderFilename,
+        const std::string& fragShaderFilename);
+
+    // returns the variant for the given feature set, compiling it on first use
+    const Program* Get(const std::vector<std::string>& defines);
+    bool Prewarm(const std::vector<std::vector<std::string>>& defineSets);
+    size_t GetVariantCount() const { return m_variants.size(); }
+
+private:
+    ProgramVariants() {}
+    static std::string MakeKey(const std::vector<std::string>& defines);
+
+    std::string m_vertShaderFilename;
+    std::string m_fragShaderFilename;
+    std::unordered_map<std::string, ProgramUPtr> m_variants;
+};
+
 #endif // __PROGRAM_H__
\ No newline at end of file
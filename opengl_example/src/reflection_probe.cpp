@@ -0,0 +1,85 @@
+#include "reflection_probe.h"
+#include "shadow_atlas.h"
+
+ReflectionProbeUPtr ReflectionProbe::Create(const glm::vec3& position, int resolution) {
+    auto probe = ReflectionProbeUPtr(new ReflectionProbe());
+    if (!probe->Init(position, resolution))
+        return nullptr;
+    return std::move(probe);
+}
+
+ReflectionProbe::~ReflectionProbe() {
+    if (m_framebuffer)
+        glDeleteFramebuffers(1, &m_framebuffer);
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+    if (m_depthTexture)
+        glDeleteTextures(1, &m_depthTexture);
+}
+
+void ReflectionProbe::Bind() const {
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture);
+}
+
+bool ReflectionProbe::Init(const glm::vec3& position, int resolution) {
+    m_position = position;
+    m_resolution = resolution;
+    m_levelCount = (int)floorf(log2f((float)resolution)) + 1;
+
+    glGenTextures(1, &m_texture);
+    Bind();
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    for (int face = 0; face < 6; face++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB16F,
+            resolution, resolution, 0, GL_RGB, GL_FLOAT, nullptr);
+    }
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+    glGenTextures(1, &m_depthTexture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_depthTexture);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    for (int face = 0; face < 6; face++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24,
+            resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    }
+
+    // whole cube maps attached, gl_Layer picks the face
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_texture, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0);
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        SPDLOG_ERROR("failed to complete reflection probe framebuffer: {:x}", status);
+        return false;
+    }
+    return true;
+}
+
+void ReflectionProbe::Begin() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_resolution, m_resolution);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void ReflectionProbe::End() {
+    Bind();
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    m_valid = true;
+}
+
+void ReflectionProbe::SetToProgram(const Program* program, float nearPlane, float farPlane,
+    bool rotationOnly) const {
+    auto projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+    auto position = rotationOnly ? glm::vec3(0.0f) : m_position;
+    for (int face = 0; face < 6; face++) {
+        program->SetUniform(fmt::format("faceViewProjections[{}]", face),
+            projection * ShadowAtlas::GetCubeFaceView(position, face));
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef __REFLECTION_PROBE_H__
+#define __REFLECTION_PROBE_H__
+
+#include "program.h"
+
+// the scene as seen from one point, rendered into a cube map. all six
+// faces are drawn in one pass: the framebuffer attaches the whole cube
+// and a geometry shader sends every triangle to the faces it touches,
+// see probe.gs. mips are generated after each update for rough reflections
+CLASS_PTR(ReflectionProbe)
+class ReflectionProbe {
+public:
+    static ReflectionProbeUPtr Create(const glm::vec3& position, int resolution);
+    ~ReflectionProbe();
+
+    const glm::vec3& GetPosition() const { return m_position; }
+    int GetResolution() const { return m_resolution; }
+    int GetLevelCount() const { return m_levelCount; }
+    // false until the first update has finished
+    bool IsValid() const { return m_valid; }
+
+    // binds the layered framebuffer and clears every face
+    void Begin() const;
+    void End();
+    // faceViewProjections[6] of the probe. rotationOnly keeps the probe at
+    // the origin, for the skybox
+    void SetToProgram(const Program* program, float nearPlane, float farPlane,
+        bool rotationOnly = false) const;
+
+    uint32_t Get() const { return m_texture; }
+    void Bind() const;
+
+private:
+    ReflectionProbe() {}
+    bool Init(const glm::vec3& position, int resolution);
+
+    glm::vec3 m_position { glm::vec3(0.0f) };
+    int m_resolution { 0 };
+    int m_levelCount { 0 };
+    bool m_valid { false };
+    uint32_t m_texture { 0 };
+    uint32_t m_depthTexture { 0 };
+    uint32_t m_framebuffer { 0 };
+};
+
+#endif // __REFLECTION_PROBE_H__
@@ -0,0 +1,320 @@
+#include "render_graph.h"
+#include <algorithm>
+
+// cached framebuffers unused for this many frames are deleted
+static const int MAX_UNUSED_FRAMES = 4;
+
+void RenderGraph::PassBuilder::Read(Handle resource) {
+    m_graph->m_passes[m_passIndex].reads.push_back(resource);
+}
+
+void RenderGraph::PassBuilder::WriteColor(Handle resource,
+    std::optional<glm::vec4> clearColor) {
+    auto& pass = m_graph->m_passes[m_passIndex];
+    pass.writes.push_back(resource);
+    pass.colors.push_back(resource);
+    pass.clearColors.push_back(clearColor);
+}
+
+void RenderGraph::PassBuilder::WriteDepthStencil(Handle resource, bool clear) {
+    auto& pass = m_graph->m_passes[m_passIndex];
+    pass.writes.push_back(resource);
+    pass.depthStencil = resource;
+    pass.clearDepthStencil = clear;
+}
+
+void RenderGraph::PassBuilder::Write(Handle resource) {
+    m_graph->m_passes[m_passIndex].writes.push_back(resource);
+}
+
+void RenderGraph::PassBuilder::SetSideEffect() {
+    m_graph->m_passes[m_passIndex].sideEffect = true;
+}
+
+RenderGraphUPtr RenderGraph::Create(RenderTargetPool* pool) {
+    auto renderGraph = RenderGraphUPtr(new RenderGraph());
+    renderGraph->m_pool = pool;
+    return std::move(renderGraph);
+}
+
+RenderGraph::~RenderGraph() {
+    Reset();
+    for (auto& cached : m_framebuffers)
+        glDeleteFramebuffers(1, &cached.framebuffer);
+}
+
+void RenderGraph::Reset() {
+    for (auto& texture : m_textures)
+        m_pool->Release(texture.texture);
+    m_textures.clear();
+    m_resources.clear();
+    m_passes.clear();
+}
+
+RenderGraph::Handle RenderGraph::Import(const std::string& name, TexturePtr texture) {
+    Resource resource;
+    resource.name = name;
+    resource.desc = { texture->GetWidth(), texture->GetHeight(),
+        texture->GetFormat(), texture->GetType() };
+    resource.imported = texture;
+    m_resources.push_back(resource);
+    return (Handle)m_resources.size() - 1;
+}
+
+RenderGraph::Handle RenderGraph::ImportBackbuffer(int width, int height) {
+    Resource resource;
+    resource.name = "backbuffer";
+    resource.desc.width = width;
+    resource.desc.height = height;
+    resource.backbuffer = true;
+    resource.output = true;
+    m_resources.push_back(resource);
+    return (Handle)m_resources.size() - 1;
+}
+
+RenderGraph::Handle RenderGraph::ImportExternal(const std::string& name) {
+    Resource resource;
+    resource.name = name;
+    resource.external = true;
+    m_resources.push_back(resource);
+    return (Handle)m_resources.size() - 1;
+}
+
+RenderGraph::Handle RenderGraph::CreateTexture(const std::string& name,
+    const RenderTargetDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    m_resources.push_back(resource);
+    return (Handle)m_resources.size() - 1;
+}
+
+void RenderGraph::AddPass(const std::string& name,
+    const std::function<void(PassBuilder&)>& setup,
+    const std::function<void()>& execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = execute;
+    m_passes.push_back(pass);
+    PassBuilder builder(this, (int)m_passes.size() - 1);
+    setup(builder);
+}
+
+void RenderGraph::MarkOutput(Handle resource) {
+    if (resource != INVALID_HANDLE)
+        m_resources[resource].output = true;
+}
+
+TexturePtr RenderGraph::GetTexture(Handle resource) const {
+    if (resource == INVALID_HANDLE)
+        return nullptr;
+    auto& r = m_resources[resource];
+    if (r.imported)
+        return r.imported;
+    if (r.physical < 0)
+        return nullptr;
+    return m_textures[r.physical].texture;
+}
+
+void RenderGraph::Compile() {
+    for (int i = 0; i < (int)m_passes.size(); i++) {
+        auto& pass = m_passes[i];
+        pass.refCount = (int)pass.writes.size();
+        for (auto resource : pass.writes)
+            m_resources[resource].writers.push_back(i);
+        for (auto resource : pass.reads)
+            m_resources[resource].refCount++;
+    }
+
+    // cull passes whose writes are never read, walking back from unused resources
+    std::vector<Handle> unused;
+    for (int i = 0; i < (int)m_resources.size(); i++) {
+        if (m_resources[i].refCount == 0 && !m_resources[i].output)
+            unused.push_back(i);
+    }
+    while (!unused.empty()) {
+        auto& resource = m_resources[unused.back()];
+        unused.pop_back();
+        for (auto writer : resource.writers) {
+            auto& pass = m_passes[writer];
+            if (--pass.refCount > 0 || pass.sideEffect || pass.culled)
+                continue;
+            pass.culled = true;
+            for (auto read : pass.reads) {
+                auto& readResource = m_resources[read];
+                if (--readResource.refCount == 0 && !readResource.output)
+                    unused.push_back(read);
+            }
+        }
+    }
+
+    // lifetimes of the resources over the remaining passes
+    m_culledPassCount = 0;
+    for (int i = 0; i < (int)m_passes.size(); i++) {
+        auto& pass = m_passes[i];
+        if (pass.culled) {
+            m_culledPassCount++;
+            continue;
+        }
+        auto Touch = [&](Handle handle) {
+            auto& resource = m_resources[handle];
+            if (resource.firstPass < 0)
+                resource.firstPass = i;
+            resource.lastPass = i;
+        };
+        for (auto resource : pass.reads)
+            Touch(resource);
+        for (auto resource : pass.writes)
+            Touch(resource);
+    }
+    for (auto& resource : m_resources) {
+        if (resource.output && resource.firstPass >= 0)
+            resource.lastPass = (int)m_passes.size();
+    }
+
+    // assign physical textures in pass order. a texture of the same
+    // desc is reused once the resource holding it has been read for the last time
+    m_transientCount = 0;
+    for (int i = 0; i < (int)m_passes.size(); i++) {
+        for (auto& resource : m_resources) {
+            if (resource.firstPass != i || resource.imported ||
+                resource.backbuffer || resource.external)
+                continue;
+            m_transientCount++;
+            int physical = -1;
+            for (int t = 0; t < (int)m_textures.size(); t++) {
+                if (m_textures[t].desc == resource.desc && m_textures[t].busyUntil < i) {
+                    physical = t;
+                    break;
+                }
+            }
+            if (physical < 0) {
+                PhysicalTexture texture;
+                texture.desc = resource.desc;
+                texture.texture = m_pool->Acquire(resource.desc);
+                m_textures.push_back(texture);
+                physical = (int)m_textures.size() - 1;
+            }
+            m_textures[physical].busyUntil = resource.lastPass;
+            resource.physical = physical;
+        }
+    }
+}
+
+uint32_t RenderGraph::GetFramebuffer(const std::vector<Handle>& colors,
+    Handle depthStencil) {
+    std::vector<TexturePtr> attachments;
+    for (auto color : colors) {
+        if (m_resources[color].backbuffer)
+            return 0;
+        attachments.push_back(GetTexture(color));
+    }
+    if (depthStencil != INVALID_HANDLE) {
+        if (m_resources[depthStencil].backbuffer)
+            return 0;
+        attachments.push_back(GetTexture(depthStencil));
+    }
+
+    std::vector<uint32_t> key;
+    for (auto& attachment : attachments)
+        key.push_back(attachment->Get());
+    key.push_back(depthStencil != INVALID_HANDLE ? 1 : 0);
+
+    for (auto& cached : m_framebuffers) {
+        if (cached.key != key)
+            continue;
+        // texture names are recycled, make sure these are the same textures
+        bool valid = true;
+        for (size_t i = 0; i < attachments.size(); i++)
+            valid = valid && cached.attachments[i].lock() == attachments[i];
+        if (valid) {
+            cached.unusedFrames = 0;
+            return cached.framebuffer;
+        }
+    }
+
+    CachedFramebuffer cached;
+    cached.key = key;
+    glGenFramebuffers(1, &cached.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, cached.framebuffer);
+    std::vector<GLenum> drawBuffers;
+    for (size_t i = 0; i < colors.size(); i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (GLenum)i,
+            GL_TEXTURE_2D, attachments[i]->Get(), 0);
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)i);
+    }
+    if (depthStencil != INVALID_HANDLE) {
+        auto format = attachments.back()->GetFormat();
+        glFramebufferTexture2D(GL_FRAMEBUFFER,
+            format == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+            GL_TEXTURE_2D, attachments.back()->Get(), 0);
+    }
+    if (drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else {
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+    }
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        SPDLOG_ERROR("failed to complete render graph framebuffer: {:x}", status);
+    m_boundFramebuffer = cached.framebuffer;
+
+    for (auto& attachment : attachments)
+        cached.attachments.push_back(attachment);
+    m_framebuffers.push_back(cached);
+    return cached.framebuffer;
+}
+
+void RenderGraph::BindPassTargets(int passIndex) {
+    auto& pass = m_passes[passIndex];
+    if (pass.colors.empty() && pass.depthStencil == INVALID_HANDLE) {
+        // the pass binds its own targets, whatever it leaves bound is unknown
+        m_boundFramebuffer = 0xffffffff;
+        return;
+    }
+
+    auto framebuffer = GetFramebuffer(pass.colors, pass.depthStencil);
+    if (framebuffer != m_boundFramebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        m_boundFramebuffer = framebuffer;
+    }
+    auto& desc = m_resources[
+        pass.colors.empty() ? pass.depthStencil : pass.colors[0]].desc;
+    glViewport(0, 0, desc.width, desc.height);
+
+    for (size_t i = 0; i < pass.colors.size(); i++) {
+        if (pass.clearColors[i].has_value())
+            glClearBufferfv(GL_COLOR, (GLint)i, glm::value_ptr(pass.clearColors[i].value()));
+    }
+    if (pass.clearDepthStencil)
+        glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+}
+
+void RenderGraph::Execute() {
+    Compile();
+    m_boundFramebuffer = 0xffffffff;
+    for (int i = 0; i < (int)m_passes.size(); i++) {
+        if (m_passes[i].culled)
+            continue;
+        BindPassTargets(i);
+        m_passes[i].execute();
+        // passes may bind other framebuffers, e.g. for blits
+        GLint bound = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+        if ((uint32_t)bound != m_boundFramebuffer)
+            m_boundFramebuffer = 0xffffffff;
+    }
+
+    for (int i = (int)m_framebuffers.size() - 1; i >= 0; i--) {
+        auto& cached = m_framebuffers[i];
+        bool expired = false;
+        for (auto& attachment : cached.attachments)
+            expired = expired || attachment.expired();
+        if (expired || ++cached.unusedFrames > MAX_UNUSED_FRAMES) {
+            glDeleteFramebuffers(1, &cached.framebuffer);
+            m_framebuffers.erase(m_framebuffers.begin() + i);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef __RENDER_GRAPH_H__
+#define __RENDER_GRAPH_H__
+
+#include "common.h"
+#include "texture.h"
+#include "render_target_pool.h"
+#include <functional>
+
+// frame graph. every frame the passes are declared with the virtual
+// resources they read and write, then Execute() culls passes nobody
+// consumes, lets transient textures with disjoint lifetimes share memory
+// and binds / clears targets only where a pass asks for it
+CLASS_PTR(RenderGraph)
+class RenderGraph {
+public:
+    using Handle = int;
+    static constexpr Handle INVALID_HANDLE = -1;
+
+    class PassBuilder {
+    public:
+        void Read(Handle resource);
+        // color attachments are bound in declaration order.
+        // clearColor is applied before the pass runs (float formats only)
+        void WriteColor(Handle resource,
+            std::optional<glm::vec4> clearColor = std::nullopt);
+        void WriteDepthStencil(Handle resource, bool clear = false);
+        // written through the pass' own binding, e.g. per mip level
+        void Write(Handle resource);
+        // never culled, e.g. the pass updates state outside of the graph
+        void SetSideEffect();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph* graph, int passIndex) :
+            m_graph(graph), m_passIndex(passIndex) {}
+        RenderGraph* m_graph;
+        int m_passIndex;
+    };
+
+    // transient textures are borrowed from pool for the frame
+    static RenderGraphUPtr Create(RenderTargetPool* pool);
+    ~RenderGraph();
+
+    // drop last frame's declarations and return its textures to the pool
+    void Reset();
+    Handle Import(const std::string& name, TexturePtr texture);
+    Handle ImportBackbuffer(int width, int height);
+    // state bound outside of the graph, e.g. a texture array.
+    // only orders and culls the passes touching it, GetTexture() is null
+    Handle ImportExternal(const std::string& name);
+    Handle CreateTexture(const std::string& name, const RenderTargetDesc& desc);
+    void AddPass(const std::string& name,
+        const std::function<void(PassBuilder&)>& setup,
+        const std::function<void()>& execute);
+    // keep the contents until the end of the frame, e.g. for debug views
+    void MarkOutput(Handle resource);
+
+    void Execute();
+
+    // valid after Execute() until the next Reset(), null if culled
+    TexturePtr GetTexture(Handle resource) const;
+    // framebuffer with the given attachments, e.g. for glBlitFramebuffer
+    uint32_t GetFramebuffer(const std::vector<Handle>& colors,
+        Handle depthStencil = INVALID_HANDLE);
+
+    int GetPassCount() const { return (int)m_passes.size(); }
+    int GetCulledPassCount() const { return m_culledPassCount; }
+    int GetTransientTextureCount() const { return m_transientCount; }
+    int GetPhysicalTextureCount() const { return (int)m_textures.size(); }
+
+private:
+    RenderGraph() {}
+    void Compile();
+    void BindPassTargets(int passIndex);
+
+    struct Resource {
+        std::string name;
+        RenderTargetDesc desc;
+        TexturePtr imported;
+        bool backbuffer { false };
+        bool external { false };
+        bool output { false };
+        std::vector<int> writers;
+        int refCount { 0 };
+        int firstPass { -1 };
+        int lastPass { -1 };
+        int physical { -1 };
+    };
+    struct Pass {
+        std::string name;
+        std::function<void()> execute;
+        std::vector<Handle> reads;
+        std::vector<Handle> writes;
+        std::vector<Handle> colors;
+        std::vector<std::optional<glm::vec4>> clearColors;
+        Handle depthStencil { INVALID_HANDLE };
+        bool clearDepthStencil { false };
+        bool sideEffect { false };
+        bool culled { false };
+        int refCount { 0 };
+    };
+    struct PhysicalTexture {
+        RenderTargetDesc desc;
+        TexturePtr texture;
+        int busyUntil { -1 };
+    };
+    struct CachedFramebuffer {
+        std::vector<std::weak_ptr<Texture>> attachments;
+        std::vector<uint32_t> key;
+        uint32_t framebuffer { 0 };
+        int unusedFrames { 0 };
+    };
+
+    RenderTargetPool* m_pool { nullptr };
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<PhysicalTexture> m_textures;
+    std::vector<CachedFramebuffer> m_framebuffers;
+    uint32_t m_boundFramebuffer { 0xffffffff };
+    int m_culledPassCount { 0 };
+    int m_transientCount { 0 };
+};
+
+#endif // __RENDER_GRAPH_H__
@@ -0,0 +1,73 @@
+#include "render_target_pool.h"
+
+// free textures unused for this many frames are deleted
+static const int MAX_UNUSED_FRAMES = 8;
+
+static size_t GetBytesPerPixel(uint32_t format) {
+    switch (format) {
+        case GL_RED: case GL_R8: return 1;
+        case GL_R16F: return 2;
+        case GL_RG16F: case GL_RG16: case GL_R32F: case GL_R32UI:
+        case GL_RGBA: case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_DEPTH24_STENCIL8: case GL_R11F_G11F_B10F:
+        case GL_DEPTH_COMPONENT: return 4;
+        case GL_RGB16F: return 6;
+        case GL_RGBA16F: return 8;
+        case GL_RGBA32F: return 16;
+        default: return 4;
+    }
+}
+
+RenderTargetPoolUPtr RenderTargetPool::Create() {
+    return RenderTargetPoolUPtr(new RenderTargetPool());
+}
+
+TexturePtr RenderTargetPool::Acquire(const RenderTargetDesc& desc) {
+    for (auto& entry : m_entries) {
+        if (!entry.inUse && entry.desc == desc) {
+            entry.inUse = true;
+            entry.unusedFrames = 0;
+            return entry.texture;
+        }
+    }
+
+    Entry entry;
+    entry.desc = desc;
+    entry.texture = Texture::Create(desc.width, desc.height, desc.format, desc.type);
+    entry.texture->SetFilter(desc.filter, desc.filter);
+    entry.inUse = true;
+    m_entries.push_back(entry);
+    return entry.texture;
+}
+
+void RenderTargetPool::Release(const TexturePtr& texture) {
+    for (auto& entry : m_entries) {
+        if (entry.texture == texture) {
+            entry.inUse = false;
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::EndFrame() {
+    for (int i = (int)m_entries.size() - 1; i >= 0; i--) {
+        auto& entry = m_entries[i];
+        if (entry.inUse)
+            continue;
+        if (++entry.unusedFrames > MAX_UNUSED_FRAMES)
+            m_entries.erase(m_entries.begin() + i);
+    }
+}
+
+int RenderTargetPool::GetFreeTextureCount() const {
+    int count = 0;
+    for (auto& entry : m_entries)
+        count += entry.inUse ? 0 : 1;
+    return count;
+}
+
+size_t RenderTargetPool::GetAllocatedBytes() const {
+    size_t bytes = 0;
+    for (auto& entry : m_entries)
+        bytes += (size_t)entry.desc.width * entry.desc.height * GetBytesPerPixel(entry.desc.format);
+    return bytes;
+}
@@ -0,0 +1,53 @@
+#ifndef __RENDER_TARGET_POOL_H__
+#define __RENDER_TARGET_POOL_H__
+
+#include "common.h"
+#include "texture.h"
+
+// size, format and min / mag filter of a render target texture
+struct RenderTargetDesc {
+    int width { 0 };
+    int height { 0 };
+    uint32_t format { GL_RGBA };
+    uint32_t type { GL_UNSIGNED_BYTE };
+    // linear for targets read between texel centers
+    uint32_t filter { GL_NEAREST };
+
+    bool operator==(const RenderTargetDesc& other) const {
+        return width == other.width && height == other.height &&
+            format == other.format && type == other.type && filter == other.filter;
+    }
+};
+
+// render target textures shared by descriptor. users borrow a texture
+// with Acquire() and hand it back with Release(), so targets of the same
+// size and format are allocated once instead of per effect.
+// free textures are kept for a few frames, e.g. to survive toggling a pass
+CLASS_PTR(RenderTargetPool)
+class RenderTargetPool {
+public:
+    static RenderTargetPoolUPtr Create();
+
+    // clamped texture with the filter of desc nobody else holds
+    TexturePtr Acquire(const RenderTargetDesc& desc);
+    void Release(const TexturePtr& texture);
+    // ages free textures and deletes the ones unused for too long
+    void EndFrame();
+
+    int GetTextureCount() const { return (int)m_entries.size(); }
+    int GetFreeTextureCount() const;
+    size_t GetAllocatedBytes() const;
+
+private:
+    RenderTargetPool() {}
+
+    struct Entry {
+        RenderTargetDesc desc;
+        TexturePtr texture;
+        bool inUse { false };
+        int unusedFrames { 0 };
+    };
+    std::vector<Entry> m_entries;
+};
+
+#endif // __RENDER_TARGET_POOL_H__
@@ -1,8 +1,11 @@
 #include "shader.h"
+#include <sstream>
+#include <algorithm>
 
-ShaderUPtr Shader::CreateFromFile(const std::string& filename, GLenum shaderType) {
+ShaderUPtr Shader::CreateFromFile(const std::string& filename, GLenum shaderType,
+    const std::vector<std::string>& defines) {
     auto shader = std::unique_ptr<Shader>(new Shader());
-    if (!shader->LoadFile(filename, shaderType))
+    if (!shader->LoadFile(filename, shaderType, defines))
         return nullptr;
     return std::move(shader);
 }
@@ -14,8 +17,10 @@ Shader::~Shader() {
     }
 }
 
-bool Shader::LoadFile(const std::string& filename, GLenum shaderType) {
-    auto result = LoadTextFile(filename);
+bool Shader::LoadFile(const std::string& filename, GLenum shaderType,
+    const std::vector<std::string>& defines) {
+    std::vector<std::string> sourceFiles;
+    auto result = PreprocessShaderSource(filename, defines, &sourceFiles);
     if (!result.has_value())
         return false;
 
@@ -35,8 +40,94 @@ bool Shader::LoadFile(const std::string& filename, GLenum shaderType) {
         char infoLog[1024];
         glGetShaderInfoLog(m_shader, 1024, nullptr, infoLog);
         SPDLOG_ERROR("failed to compile shader: \"{}\"", filename);
+        for (size_t i = 0; i < defines.size(); i++)
+            SPDLOG_ERROR("define: {}", defines[i]);
+        for (size_t i = 0; i < sourceFiles.size(); i++)
+            SPDLOG_ERROR("source {}: {}", i, sourceFiles[i]);
         SPDLOG_ERROR("reason: {}", infoLog);
         return false;
     }
     return true;
-}
\ No newline at end of file
+}
+
+static bool ExpandShaderIncludes(const std::string& filename,
+    const std::vector<std::string>& defines,
+    std::vector<std::string>& sourceFiles,
+    std::vector<std::string>& includeStack,
+    std::string& output) {
+    if (std::find(includeStack.begin(), includeStack.end(), filename) != includeStack.end()) {
+        SPDLOG_ERROR("recursive shader include: {}", filename);
+        return false;
+    }
+    // every file is expanded once, like #pragma once
+    if (std::find(sourceFiles.begin(), sourceFiles.end(), filename) != sourceFiles.end())
+        return true;
+
+    auto result = LoadTextFile(filename);
+    if (!result.has_value())
+        return false;
+
+    int sourceIndex = (int)sourceFiles.size();
+    sourceFiles.push_back(filename);
+    includeStack.push_back(filename);
+    auto dirname = filename.substr(0, filename.find_last_of("/") + 1);
+
+    std::istringstream lines(result.value());
+    std::string line;
+    int lineNumber = 0;
+    bool isRoot = includeStack.size() == 1;
+    if (!isRoot)
+        output += fmt::format("#line 1 {}\n", sourceIndex);
+
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        auto first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] != '#') {
+            output += line + "\n";
+            continue;
+        }
+
+        auto directive = line.substr(first + 1);
+        directive = directive.substr(std::min(directive.size(),
+            directive.find_first_not_of(" \t")));
+        if (isRoot && directive.compare(0, 7, "version") == 0) {
+            // defines should come after #version, which must be the first statement
+            output += line + "\n";
+            for (auto& define : defines)
+                output += fmt::format("#define {}\n", define);
+            output += fmt::format("#line {} {}\n", lineNumber + 1, sourceIndex);
+        }
+        else if (directive.compare(0, 7, "include") == 0) {
+            auto begin = directive.find('"');
+            auto end = directive.find('"', begin + 1);
+            if (begin == std::string::npos || end == std::string::npos) {
+                SPDLOG_ERROR("invalid include in {}({}): {}", filename, lineNumber, line);
+                return false;
+            }
+            auto includeFilename = dirname + directive.substr(begin + 1, end - begin - 1);
+            if (!ExpandShaderIncludes(includeFilename, defines,
+                sourceFiles, includeStack, output))
+                return false;
+            output += fmt::format("#line {} {}\n", lineNumber + 1, sourceIndex);
+        }
+        else {
+            output += line + "\n";
+        }
+    }
+
+    includeStack.pop_back();
+    return true;
+}
+
+std::optional<std::string> PreprocessShaderSource(const std::string& filename,
+    const std::vector<std::string>& defines,
+    std::vector<std::string>* sourceFiles) {
+    std::vector<std::string> files;
+    std::vector<std::string> includeStack;
+    std::string output;
+    if (!ExpandShaderIncludes(filename, defines, files, includeStack, output))
+        return {};
+    if (sourceFiles)
+        *sourceFiles = std::move(files);
+    return output;
+}
@@ -6,14 +6,22 @@
 CLASS_PTR(Shader);
 class Shader {
 public:
-    static ShaderUPtr CreateFromFile(const std::string& filename, GLenum shaderType);
+    static ShaderUPtr CreateFromFile(const std::string& filename, GLenum shaderType,
+        const std::vector<std::string>& defines = {});
 
     ~Shader();
-    uint32_t Get() const { return m_shader; }    
+    uint32_t Get() const { return m_shader; }
 private:
     Shader() {}
-    bool LoadFile(const std::string& filename, GLenum shaderType);
+    bool LoadFile(const std::string& filename, GLenum shaderType,
+        const std::vector<std::string>& defines);
     uint32_t m_shader { 0 };
 };
 
-#endif // __SHADER_H__
\ No newline at end of file
+// expand #include "..." directives and insert defines right after #version
+// sourceFiles[i] is the file that #line source string number i refers to
+std::optional<std::string> PreprocessShaderSource(const std::string& filename,
+    const std::vector<std::string>& defines,
+    std::vector<std::string>* sourceFiles = nullptr);
+
+#endif // __SHADER_H__
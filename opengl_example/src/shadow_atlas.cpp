@@ -0,0 +1,141 @@
+#include "shadow_atlas.h"
+// imgui builds its copy of stb_rect_pack static, the project's own
+// implementation lives here and is shared with the lightmap packer
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <imstb_rectpack.h>
+#include <algorithm>
+#include <numeric>
+
+ShadowAtlasUPtr ShadowAtlas::Create(int size, int minTileSize, int maxTileSize) {
+    auto atlas = ShadowAtlasUPtr(new ShadowAtlas());
+    if (!atlas->Init(size, minTileSize, maxTileSize))
+        return nullptr;
+    return std::move(atlas);
+}
+
+ShadowAtlas::~ShadowAtlas() {
+    if (m_framebuffer)
+        glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+bool ShadowAtlas::Init(int size, int minTileSize, int maxTileSize) {
+    if (minTileSize < 1 || minTileSize > maxTileSize || maxTileSize > size) {
+        SPDLOG_ERROR("invalid shadow atlas tile sizes: {} - {}", minTileSize, maxTileSize);
+        return false;
+    }
+    m_size = size;
+    m_minTileSize = minTileSize;
+    m_maxTileSize = maxTileSize;
+
+    m_texture = Texture::Create(size, size, GL_DEPTH_COMPONENT, GL_FLOAT);
+    m_texture->Bind();
+    m_texture->SetFilter(GL_LINEAR, GL_LINEAR);
+    m_texture->SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    m_texture->SetCompareMode(GL_LEQUAL);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+        GL_TEXTURE_2D, m_texture->Get(), 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        SPDLOG_ERROR("failed to complete shadow atlas framebuffer: {:x}", status);
+        return false;
+    }
+    return true;
+}
+
+void ShadowAtlas::Allocate(const std::vector<Request>& requests) {
+    m_tiles.clear();
+    m_firstTiles.assign(requests.size(), -1);
+
+    // most important first, so running out of space drops the least important
+    std::vector<int> order;
+    for (int i = 0; i < (int)requests.size(); i++) {
+        if (requests[i].importance > 0.0f && requests[i].faceCount > 0)
+            order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return requests[a].importance > requests[b].importance;
+    });
+
+    // power of two tiles pack without gaps
+    std::vector<int> sizes(requests.size(), 0);
+    for (auto i : order) {
+        float wanted = std::min(requests[i].importance, 1.0f) * (float)m_maxTileSize;
+        int size = m_maxTileSize;
+        while (size > m_minTileSize && (float)(size / 2) >= wanted)
+            size /= 2;
+        sizes[i] = size;
+    }
+
+    std::vector<stbrp_node> nodes(m_size);
+    std::vector<stbrp_rect> rects;
+    for (int count = (int)order.size(); count > 0; count--) {
+        for (int shift = 0; ; shift++) {
+            rects.clear();
+            bool shrunk = false;
+            for (int o = 0; o < count; o++) {
+                int size = std::max(sizes[order[o]] >> shift, m_minTileSize);
+                shrunk = shrunk || size > m_minTileSize;
+                for (int face = 0; face < requests[order[o]].faceCount; face++) {
+                    stbrp_rect rect = {};
+                    rect.id = o;
+                    rect.w = size;
+                    rect.h = size;
+                    rects.push_back(rect);
+                }
+            }
+
+            stbrp_context context;
+            stbrp_init_target(&context, m_size, m_size, nodes.data(), (int)nodes.size());
+            if (stbrp_pack_rects(&context, rects.data(), (int)rects.size())) {
+                // rects keep their order, the faces of a request stay together
+                for (auto& rect : rects) {
+                    int request = order[rect.id];
+                    if (m_firstTiles[request] < 0)
+                        m_firstTiles[request] = (int)m_tiles.size();
+                    m_tiles.push_back({ rect.x, rect.y, rect.w });
+                }
+                return;
+            }
+            if (!shrunk)
+                break;
+        }
+    }
+}
+
+glm::vec4 ShadowAtlas::GetTileRect(int tile) const {
+    auto& t = m_tiles[tile];
+    float scale = 1.0f / (float)m_size;
+    return glm::vec4(t.x * scale, t.y * scale, t.size * scale, t.size * scale);
+}
+
+void ShadowAtlas::Begin() {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_size, m_size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::BeginTile(int tile) {
+    auto& t = m_tiles[tile];
+    glViewport(t.x, t.y, t.size, t.size);
+}
+
+glm::mat4 ShadowAtlas::GetCubeFaceView(const glm::vec3& position, int face) {
+    // same orientations as the faces of a cube map
+    static const glm::vec3 targets[6] = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+    };
+    static const glm::vec3 ups[6] = {
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+    };
+    return glm::lookAt(position, position + targets[face], ups[face]);
+}
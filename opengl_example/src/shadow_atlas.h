@@ -0,0 +1,62 @@
+#ifndef __SHADOW_ATLAS_H__
+#define __SHADOW_ATLAS_H__
+
+#include "texture.h"
+
+// shadow maps of many lights packed into square tiles of one depth texture.
+// tiles are sized by the importance of their light and rect packed every
+// frame, so every light renders through the same framebuffer and only
+// the viewport changes between them
+CLASS_PTR(ShadowAtlas)
+class ShadowAtlas {
+public:
+    struct Request {
+        // 1 asks for the largest tile, smaller values for smaller tiles
+        float importance { 1.0f };
+        // 1 for a spot light, 6 for the cube faces of a point light
+        int faceCount { 1 };
+    };
+    struct Tile {
+        int x { 0 };
+        int y { 0 };
+        int size { 0 };
+    };
+
+    static ShadowAtlasUPtr Create(int size, int minTileSize, int maxTileSize);
+    ~ShadowAtlas();
+
+    // pack the requests, halving the tiles until they fit and dropping
+    // the least important requests if even the smallest tiles do not
+    void Allocate(const std::vector<Request>& requests);
+    // the faces of a request are consecutive tiles, -1 if it was dropped
+    int GetFirstTile(int request) const { return m_firstTiles[request]; }
+    int GetTileCount() const { return (int)m_tiles.size(); }
+    const Tile& GetTile(int tile) const { return m_tiles[tile]; }
+    // uv offset in xy and uv scale in zw
+    glm::vec4 GetTileRect(int tile) const;
+
+    // bind and clear the atlas before drawing the tiles
+    void Begin();
+    // draw into a tile with a 90 degree square projection per face
+    void BeginTile(int tile);
+    // view of a cube face, +x -x +y -y +z -z
+    static glm::mat4 GetCubeFaceView(const glm::vec3& position, int face);
+
+    // depth compare enabled, bind to a sampler2DShadow
+    const TexturePtr GetTexture() const { return m_texture; }
+    int GetSize() const { return m_size; }
+
+private:
+    ShadowAtlas() {}
+    bool Init(int size, int minTileSize, int maxTileSize);
+
+    int m_size { 0 };
+    int m_minTileSize { 0 };
+    int m_maxTileSize { 0 };
+    uint32_t m_framebuffer { 0 };
+    TexturePtr m_texture;
+    std::vector<Tile> m_tiles;
+    std::vector<int> m_firstTiles;
+};
+
+#endif // __SHADOW_ATLAS_H__
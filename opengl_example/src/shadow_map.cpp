@@ -11,23 +11,72 @@ ShadowMap::~ShadowMap() {
     if (m_framebuffer) {
         glDeleteFramebuffers(1, &m_framebuffer);
     }
+    if (m_staticFramebuffer) {
+        glDeleteFramebuffers(1, &m_staticFramebuffer);
+    }
 }
 
 void ShadowMap::Bind() const {
     glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
 }
 
-bool ShadowMap::Init(int width, int height) {
-    glGenFramebuffers(1, &m_framebuffer);
+void ShadowMap::SetLightTransform(const glm::mat4& lightTransform) {
+    if (lightTransform == m_lightTransform)
+        return;
+    m_lightTransform = lightTransform;
+    m_staticValid = false;
+}
+
+void ShadowMap::BeginStatic() {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_staticFramebuffer);
+    glViewport(0, 0, m_shadowMap->GetWidth(), m_shadowMap->GetHeight());
+    glClear(GL_DEPTH_BUFFER_BIT);
+    m_staticValid = true;
+    m_upToDate = false;
+}
+
+bool ShadowMap::BeginDynamic(bool hasDynamicCasters) {
+    if (m_upToDate && !hasDynamicCasters && !m_dynamicDrawn)
+        return false;
+    int width = m_shadowMap->GetWidth();
+    int height = m_shadowMap->GetHeight();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+        GL_DEPTH_BUFFER_BIT, GL_NEAREST);
     Bind();
+    glViewport(0, 0, width, height);
+    m_upToDate = true;
+    m_dynamicDrawn = hasDynamicCasters;
+    return true;
+}
 
+bool ShadowMap::Init(int width, int height) {
     m_shadowMap = Texture::Create(width, height, GL_DEPTH_COMPONENT, GL_FLOAT);
-    m_shadowMap->SetFilter(GL_NEAREST, GL_NEAREST);  	
-    m_shadowMap->SetWrap(GL_CLAMP_TO_BORDER, GL_CLAMP_TO_BORDER);
-    m_shadowMap->SetBorderColor(glm::vec4(1.0f));
+    m_staticShadowMap = Texture::Create(width, height, GL_DEPTH_COMPONENT, GL_FLOAT);
+    glGenFramebuffers(1, &m_framebuffer);
+    glGenFramebuffers(1, &m_staticFramebuffer);
+    if (!InitFramebuffer(m_framebuffer, m_shadowMap) ||
+        !InitFramebuffer(m_staticFramebuffer, m_staticShadowMap))
+        return false;
+
+    // the sampled map is read through sampler2DShadow, every tap is a
+    // bilinear 2x2 comparison done by the hardware
+    m_shadowMap->Bind();
+    m_shadowMap->SetFilter(GL_LINEAR, GL_LINEAR);
+    m_shadowMap->SetCompareMode(GL_LEQUAL);
+    return true;
+}
+
+bool ShadowMap::InitFramebuffer(uint32_t framebuffer, TexturePtr shadowMap) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    shadowMap->Bind();
+    shadowMap->SetFilter(GL_NEAREST, GL_NEAREST);  	
+    shadowMap->SetWrap(GL_CLAMP_TO_BORDER, GL_CLAMP_TO_BORDER);
+    shadowMap->SetBorderColor(glm::vec4(1.0f));
 
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-        GL_TEXTURE_2D, m_shadowMap->Get(), 0);
+        GL_TEXTURE_2D, shadowMap->Get(), 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -38,4 +87,4 @@ bool ShadowMap::Init(int width, int height) {
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     return true;
-}
\ No newline at end of file
+}
@@ -3,6 +3,9 @@
 
 #include "texture.h"
 
+// static casters are rendered into a cached depth map only when the light
+// or a static object moved. every frame that has dynamic casters starts
+// from a copy of the cache and draws just those on top
 CLASS_PTR(ShadowMap);
 class ShadowMap {
 public:
@@ -11,14 +14,39 @@ public:
 
     const uint32_t Get() const { return m_framebuffer; }
     void Bind() const;
+    // depth compare enabled, bind to a sampler2DShadow
     const TexturePtr GetShadowMap() const { return m_shadowMap; }
+    // plain depth of the static casters, e.g. for debug views
+    const TexturePtr GetStaticShadowMap() const { return m_staticShadowMap; }
+
+    // drops the static cache if the light moved
+    void SetLightTransform(const glm::mat4& lightTransform);
+    const glm::mat4& GetLightTransform() const { return m_lightTransform; }
+    // a static object moved
+    void Invalidate() { m_staticValid = false; }
+
+    bool IsStaticValid() const { return m_staticValid; }
+    // bind and clear the static cache, draw the static casters after this
+    void BeginStatic();
+    // copy the cache into the shadow map and bind it for the dynamic
+    // casters. false if the shadow map is already up to date
+    bool BeginDynamic(bool hasDynamicCasters);
 
 private:
     ShadowMap() {}
     bool Init(int width, int height);
+    bool InitFramebuffer(uint32_t framebuffer, TexturePtr shadowMap);
 
     uint32_t m_framebuffer { 0 };
     TexturePtr m_shadowMap;
+    uint32_t m_staticFramebuffer { 0 };
+    TexturePtr m_staticShadowMap;
+
+    glm::mat4 m_lightTransform { glm::mat4(1.0f) };
+    bool m_staticValid { false };
+    // the shadow map holds the current static cache
+    bool m_upToDate { false };
+    bool m_dynamicDrawn { false };
 };
 
-#endif // __SHADOW_MAP_H__
\ No newline at end of file
+#endif // __SHADOW_MAP_H__
@@ -0,0 +1,220 @@
+#include "spherical_harmonics.h"
+#include "parallel.h"
+#include "texture.h"
+#include <algorithm>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SH_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// real L2 basis functions
+void EvaluateBasis(float x, float y, float z, float* basis) {
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * y;
+    basis[2] = 0.488603f * z;
+    basis[3] = 0.488603f * x;
+    basis[4] = 1.092548f * x * y;
+    basis[5] = 1.092548f * y * z;
+    basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+    basis[7] = 1.092548f * x * z;
+    basis[8] = 0.546274f * (x * x - y * y);
+}
+
+// direction of a texel is major + u * uAxis + v * vAxis
+struct FaceAxes {
+    glm::vec3 major;
+    glm::vec3 uAxis;
+    glm::vec3 vAxis;
+};
+
+FaceAxes GetFaceAxes(int face) {
+    FaceAxes axes;
+    axes.major = CubeTexture::GetFaceDirection(face, 0.0f, 0.0f);
+    axes.uAxis = CubeTexture::GetFaceDirection(face, 1.0f, 0.0f) - axes.major;
+    axes.vAxis = CubeTexture::GetFaceDirection(face, 0.0f, 1.0f) - axes.major;
+    return axes;
+}
+
+// radiance weighted by solid angle, summed per basis function
+struct Accumulator {
+    float sums[SphericalHarmonics::COEFFICIENT_COUNT][3] {};
+    float weight { 0.0f };
+
+    void Add(const Accumulator& other) {
+        for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; i++) {
+            for (int c = 0; c < 3; c++)
+                sums[i][c] += other.sums[i][c];
+        }
+        weight += other.weight;
+    }
+};
+
+// the images are srgb encoded, the projection integrates linear radiance
+void ReadColor(const Image* image, int x, int y, float* color) {
+    int channelCount = image->GetChannelCount();
+    auto texel = image->GetData() + ((size_t)y * image->GetWidth() + x) * channelCount;
+    for (int c = 0; c < 3; c++)
+        color[c] = SrgbToLinear(texel[std::min(c, channelCount - 1)]);
+}
+
+void ProjectTexel(const FaceAxes& axes, const Image* image,
+    int x, int y, float u, float v, Accumulator& accumulator) {
+    // the solid angle of a texel shrinks towards the face corners
+    float lengthSquared = 1.0f + u * u + v * v;
+    float invLength = 1.0f / sqrtf(lengthSquared);
+    float weight = invLength / lengthSquared;
+    auto direction = (axes.major + u * axes.uAxis + v * axes.vAxis) * invLength;
+    float basis[SphericalHarmonics::COEFFICIENT_COUNT];
+    EvaluateBasis(direction.x, direction.y, direction.z, basis);
+    float color[3];
+    ReadColor(image, x, y, color);
+    for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; i++) {
+        for (int c = 0; c < 3; c++)
+            accumulator.sums[i][c] += basis[i] * color[c] * weight;
+    }
+    accumulator.weight += weight;
+}
+
+void ProjectRow(int face, const Image* image, int y, Accumulator& accumulator) {
+    auto axes = GetFaceAxes(face);
+    int width = image->GetWidth();
+    float uStep = 2.0f / (float)width;
+    float v = ((float)y + 0.5f) * 2.0f / (float)image->GetHeight() - 1.0f;
+    int x = 0;
+#ifdef SH_USE_SSE
+    // 4 texels of the row at a time
+    auto Fma = [](__m128 a, __m128 b, __m128 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); };
+    auto one = _mm_set1_ps(1.0f);
+    auto vv = _mm_set1_ps(v);
+    auto uOffsets = _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(uStep));
+    __m128 sums[SphericalHarmonics::COEFFICIENT_COUNT][3];
+    for (auto& sum : sums)
+        sum[0] = sum[1] = sum[2] = _mm_setzero_ps();
+    auto weightSum = _mm_setzero_ps();
+    for (; x + 4 <= width; x += 4) {
+        auto u = _mm_add_ps(_mm_set1_ps(((float)x + 0.5f) * uStep - 1.0f), uOffsets);
+        auto lengthSquared = Fma(u, u, Fma(vv, vv, one));
+        auto invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+        auto weight = _mm_div_ps(invLength, lengthSquared);
+        __m128 d[3];
+        for (int k = 0; k < 3; k++) {
+            d[k] = Fma(u, _mm_set1_ps(axes.uAxis[k]),
+                _mm_set1_ps(axes.major[k] + v * axes.vAxis[k]));
+            d[k] = _mm_mul_ps(d[k], invLength);
+        }
+        auto& dx = d[0];
+        auto& dy = d[1];
+        auto& dz = d[2];
+        __m128 basis[SphericalHarmonics::COEFFICIENT_COUNT] = {
+            _mm_set1_ps(0.282095f),
+            _mm_mul_ps(_mm_set1_ps(0.488603f), dy),
+            _mm_mul_ps(_mm_set1_ps(0.488603f), dz),
+            _mm_mul_ps(_mm_set1_ps(0.488603f), dx),
+            _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(dx, dy)),
+            _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(dy, dz)),
+            _mm_mul_ps(_mm_set1_ps(0.315392f),
+                _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.0f), _mm_mul_ps(dz, dz)), one)),
+            _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(dx, dz)),
+            _mm_mul_ps(_mm_set1_ps(0.546274f),
+                _mm_sub_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))),
+        };
+        float colors[4][3];
+        for (int t = 0; t < 4; t++)
+            ReadColor(image, x + t, y, colors[t]);
+        __m128 weighted[3];
+        for (int c = 0; c < 3; c++) {
+            weighted[c] = _mm_mul_ps(weight,
+                _mm_set_ps(colors[3][c], colors[2][c], colors[1][c], colors[0][c]));
+        }
+        for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; i++) {
+            for (int c = 0; c < 3; c++)
+                sums[i][c] = Fma(basis[i], weighted[c], sums[i][c]);
+        }
+        weightSum = _mm_add_ps(weightSum, weight);
+    }
+    auto HorizontalSum = [](__m128 value) {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, value);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    };
+    for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; i++) {
+        for (int c = 0; c < 3; c++)
+            accumulator.sums[i][c] += HorizontalSum(sums[i][c]);
+    }
+    accumulator.weight += HorizontalSum(weightSum);
+#endif
+    for (; x < width; x++) {
+        float u = ((float)x + 0.5f) * uStep - 1.0f;
+        ProjectTexel(axes, image, x, y, u, v, accumulator);
+    }
+}
+
+}
+
+SphericalHarmonics::SphericalHarmonics() {
+    for (auto& coefficient : m_coefficients)
+        coefficient = glm::vec3(0.0f);
+}
+
+std::optional<SphericalHarmonics> SphericalHarmonics::ProjectCubeMap(
+    const std::vector<const Image*>& faces) {
+    if (faces.size() != 6) {
+        SPDLOG_ERROR("cube map needs 6 faces, got {}", faces.size());
+        return {};
+    }
+    for (auto face : faces) {
+        if (!face || face->GetWidth() <= 0 || face->GetHeight() <= 0) {
+            SPDLOG_ERROR("invalid cube map face");
+            return {};
+        }
+    }
+
+    // every row of every face is an independent task
+    std::vector<int> rowOffsets = { 0 };
+    for (auto face : faces)
+        rowOffsets.push_back(rowOffsets.back() + face->GetHeight());
+    Accumulator total;
+    std::mutex mutex;
+    ParallelFor(rowOffsets.back(), [&](int begin, int end) {
+        Accumulator accumulator;
+        int face = 0;
+        for (int row = begin; row < end; row++) {
+            while (row >= rowOffsets[face + 1])
+                face++;
+            ProjectRow(face, faces[face], row - rowOffsets[face], accumulator);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        total.Add(accumulator);
+    });
+
+    // the weights sum up to the full sphere, 4 pi. convolving with the
+    // clamped cosine scales the bands by pi, 2pi/3 and pi/4, which is then
+    // divided by pi to get the diffuse response
+    const float bandScales[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+    float normalization = 4.0f * glm::pi<float>() / total.weight;
+    SphericalHarmonics sh;
+    for (int i = 0; i < COEFFICIENT_COUNT; i++) {
+        float scale = normalization * bandScales[i == 0 ? 0 : i < 4 ? 1 : 2];
+        sh.m_coefficients[i] = glm::vec3(
+            total.sums[i][0], total.sums[i][1], total.sums[i][2]) * scale;
+    }
+    return sh;
+}
+
+glm::vec3 SphericalHarmonics::Evaluate(const glm::vec3& normal) const {
+    float basis[COEFFICIENT_COUNT];
+    EvaluateBasis(normal.x, normal.y, normal.z, basis);
+    auto result = glm::vec3(0.0f);
+    for (int i = 0; i < COEFFICIENT_COUNT; i++)
+        result += m_coefficients[i] * basis[i];
+    return glm::max(result, glm::vec3(0.0f));
+}
+
+void SphericalHarmonics::SetToProgram(const Program* program) const {
+    for (int i = 0; i < COEFFICIENT_COUNT; i++)
+        program->SetUniform(fmt::format("shCoefficients[{}]", i), m_coefficients[i]);
+}
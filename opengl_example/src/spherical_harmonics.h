@@ -0,0 +1,32 @@
+#ifndef __SPHERICAL_HARMONICS_H__
+#define __SPHERICAL_HARMONICS_H__
+
+#include "image.h"
+#include "program.h"
+
+// diffuse irradiance of an environment as 9 rgb coefficients of an L2
+// spherical harmonics projection, already convolved with the cosine lobe
+// and divided by pi. shading a normal then only needs the 9 basis
+// functions, see spherical_harmonics.glsl
+class SphericalHarmonics {
+public:
+    static constexpr int COEFFICIENT_COUNT = 9;
+
+    // no environment, evaluates to black
+    SphericalHarmonics();
+
+    // faces in cube map order +x -x +y -y +z -z, rows top to bottom
+    static std::optional<SphericalHarmonics> ProjectCubeMap(
+        const std::vector<const Image*>& faces);
+
+    // irradiance / pi for a unit normal, the same as the shader
+    glm::vec3 Evaluate(const glm::vec3& normal) const;
+    void SetToProgram(const Program* program) const;
+
+    const glm::vec3& GetCoefficient(int index) const { return m_coefficients[index]; }
+
+private:
+    glm::vec3 m_coefficients[COEFFICIENT_COUNT];
+};
+
+#endif // __SPHERICAL_HARMONICS_H__
@@ -8,10 +8,10 @@ TextureUPtr Texture::Create(int width, int height, uint32_t format, uint32_t typ
     return std::move(texture);
 }
 
-TextureUPtr Texture::CreateFromImage(const Image* image) {
+TextureUPtr Texture::CreateFromImage(const Image* image, bool srgb) {
     auto texture = TextureUPtr(new Texture());
     texture->CreateTexture();
-    texture->SetTextureFromImage(image);
+    texture->SetTextureFromImage(image, srgb);
     return std::move(texture);
 }
 
@@ -39,6 +39,11 @@ void Texture::SetBorderColor(const glm::vec4& color) const {
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(color));
 }
 
+void Texture::SetCompareMode(uint32_t func) const {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, func);
+}
+
 void Texture::SetTextureFormat(int width, int height, uint32_t format, uint32_t type) {
     m_width = width;
     m_height = height;
@@ -49,16 +54,24 @@ void Texture::SetTextureFormat(int width, int height, uint32_t format, uint32_t
     if (m_format == GL_DEPTH_COMPONENT) {
         imageFormat = GL_DEPTH_COMPONENT;        
     }
+    else if (m_format == GL_DEPTH24_STENCIL8) {
+        imageFormat = GL_DEPTH_STENCIL;
+    }
     else if (m_format == GL_RGB ||
         m_format == GL_RGB16F ||
-        m_format == GL_RGB32F) {
+        m_format == GL_RGB32F ||
+        m_format == GL_R11F_G11F_B10F) {
         imageFormat = GL_RGB;
     }
     else if (m_format == GL_RG ||
+        m_format == GL_RG16 ||
         m_format == GL_RG16F ||
         m_format == GL_RG32F) {
         imageFormat = GL_RG;
     }
+    else if (m_format == GL_R32UI) {
+        imageFormat = GL_RED_INTEGER;
+    }
     else if (m_format == GL_RED ||
         m_format == GL_R ||
         m_format == GL_R16F ||
@@ -80,7 +93,7 @@ void Texture::CreateTexture() {
     SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 }
 
-void Texture::SetTextureFromImage(const Image* image) {
+void Texture::SetTextureFromImage(const Image* image, bool srgb) {
     GLenum format = GL_RGBA;
     switch (image->GetChannelCount()) {
         default: break;
@@ -93,6 +106,11 @@ void Texture::SetTextureFromImage(const Image* image) {
     m_height = image->GetHeight();
     m_format = format;
     m_type = GL_UNSIGNED_BYTE;
+    // there are no srgb red / rg formats, those stay as they are
+    if (srgb && format == GL_RGB)
+        m_format = GL_SRGB8;
+    else if (srgb && format == GL_RGBA)
+        m_format = GL_SRGB8_ALPHA8;
  
     glTexImage2D(GL_TEXTURE_2D, 0, m_format,
         m_width, m_height, 0,
@@ -120,6 +138,34 @@ void CubeTexture::Bind() const {
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture);    
 }
 
+glm::vec3 CubeTexture::GetFaceDirection(int face, float u, float v) {
+    switch (face) {
+        case 0: return glm::vec3(1.0f, -v, -u);
+        case 1: return glm::vec3(-1.0f, -v, u);
+        case 2: return glm::vec3(u, 1.0f, v);
+        case 3: return glm::vec3(u, -1.0f, -v);
+        case 4: return glm::vec3(u, -v, 1.0f);
+        default: return glm::vec3(-u, -v, -1.0f);
+    }
+}
+
+int CubeTexture::GetFaceCoord(const glm::vec3& direction, float& u, float& v) {
+    auto a = glm::abs(direction);
+    if (a.x >= a.y && a.x >= a.z) {
+        u = (direction.x > 0.0f ? -direction.z : direction.z) / a.x;
+        v = -direction.y / a.x;
+        return direction.x > 0.0f ? 0 : 1;
+    }
+    if (a.y >= a.z) {
+        u = direction.x / a.y;
+        v = (direction.y > 0.0f ? direction.z : -direction.z) / a.y;
+        return direction.y > 0.0f ? 2 : 3;
+    }
+    u = (direction.z > 0.0f ? direction.x : -direction.x) / a.z;
+    v = -direction.y / a.z;
+    return direction.z > 0.0f ? 4 : 5;
+}
+
 bool CubeTexture::InitFromImages(const std::vector<Image*>& images) {
     glGenTextures(1, &m_texture);
     Bind();
@@ -140,11 +186,35 @@ bool CubeTexture::InitFromImages(const std::vector<Image*>& images) {
             case 3: format = GL_RGB; break;
         }
 
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB,
+        // the skybox is color, sampling decodes it to linear
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_SRGB8,
             image->GetWidth(), image->GetHeight(), 0,
             format, GL_UNSIGNED_BYTE,
             image->GetData());
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+BufferTextureUPtr BufferTexture::Create(BufferPtr buffer, uint32_t format) {
+    auto texture = BufferTextureUPtr(new BufferTexture());
+    texture->Init(buffer, format);
+    return std::move(texture);
+}
+
+BufferTexture::~BufferTexture() {
+    if (m_texture) {
+        glDeleteTextures(1, &m_texture);
+    }
+}
+
+void BufferTexture::Bind() const {
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+}
+
+void BufferTexture::Init(BufferPtr buffer, uint32_t format) {
+    m_buffer = buffer;
+    glGenTextures(1, &m_texture);
+    Bind();
+    glTexBuffer(GL_TEXTURE_BUFFER, format, m_buffer->Get());
+}
@@ -2,13 +2,16 @@
 #define __TEXTURE_H__
 
 #include "image.h"
+#include "buffer.h"
 
 CLASS_PTR(Texture)
 class Texture {
 public:
     static TextureUPtr Create(int width, int height,
         uint32_t format, uint32_t type = GL_UNSIGNED_BYTE);
-    static TextureUPtr CreateFromImage(const Image* image);
+    // srgb for color images, sampling then returns linear values.
+    // data such as specular or normal maps stays linear
+    static TextureUPtr CreateFromImage(const Image* image, bool srgb = false);
     ~Texture();
 
     const uint32_t Get() const { return m_texture; }
@@ -16,6 +19,9 @@ public:
     void SetFilter(uint32_t minFilter, uint32_t magFilter) const;
     void SetWrap(uint32_t sWrap, uint32_t tWrap) const;
     void SetBorderColor(const glm::vec4& color) const;
+    // depth textures: texture() on a shadow sampler returns the filtered
+    // result of comparing the reference against the texels with func
+    void SetCompareMode(uint32_t func) const;
 
     int GetWidth() const { return m_width; }
     int GetHeight() const { return m_height; }
@@ -25,7 +31,7 @@ public:
 private:
     Texture() {}
     void CreateTexture();
-    void SetTextureFromImage(const Image* image);
+    void SetTextureFromImage(const Image* image, bool srgb);
     void SetTextureFormat(int width, int height, uint32_t format, uint32_t type);
 
     uint32_t m_texture { 0 };
@@ -44,10 +50,33 @@ public:
 
     const uint32_t Get() const { return m_texture; }
     void Bind() const;
+
+    // direction through a face, +x -x +y -y +z -z, at u / v in [-1, 1].
+    // v points down the rows of the face image as CreateFromImages uploads it
+    static glm::vec3 GetFaceDirection(int face, float u, float v);
+    // face and u / v a direction passes through
+    static int GetFaceCoord(const glm::vec3& direction, float& u, float& v);
 private:
     CubeTexture() {}
     bool InitFromImages(const std::vector<Image*>& images);
     uint32_t m_texture { 0 };
 };
 
+// texture view of a buffer object, read with texelFetch in shaders
+CLASS_PTR(BufferTexture)
+class BufferTexture {
+public:
+    static BufferTextureUPtr Create(BufferPtr buffer, uint32_t format);
+    ~BufferTexture();
+
+    const uint32_t Get() const { return m_texture; }
+    void Bind() const;
+    BufferPtr GetBuffer() const { return m_buffer; }
+private:
+    BufferTexture() {}
+    void Init(BufferPtr buffer, uint32_t format);
+    uint32_t m_texture { 0 };
+    BufferPtr m_buffer;
+};
+
 #endif // __TEXTURE_H__
\ No newline at end of file
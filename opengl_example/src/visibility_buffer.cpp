@@ -0,0 +1,180 @@
+#include "visibility_buffer.h"
+#include <cstring>
+#include <algorithm>
+
+VisibilityBufferUPtr VisibilityBuffer::Create(const std::vector<SceneObject>& objects) {
+    auto visibilityBuffer = VisibilityBufferUPtr(new VisibilityBuffer());
+    if (!visibilityBuffer->Init(objects))
+        return nullptr;
+    return std::move(visibilityBuffer);
+}
+
+void VisibilityBuffer::Draw(const glm::mat4& viewProjection, const Program* program) const {
+    // no material state at all, only the ids are written
+    program->Use();
+    for (size_t i = 0; i < m_objects.size(); i++) {
+        auto& object = m_objects[i];
+        program->SetUniform("drawId", (int)i);
+        program->SetUniform("transform", viewProjection * object.modelTransform);
+        object.mesh->GetVertexLayout()->Bind();
+        glDrawElements(GL_TRIANGLES,
+            (GLsizei)object.mesh->GetIndexBuffer()->GetCount(), GL_UNSIGNED_INT, 0);
+    }
+}
+
+// model matrix, then normal matrix
+static void PackTransform(const glm::mat4& modelTransform, glm::vec4* texels) {
+    auto normalMatrix = glm::transpose(glm::inverse(modelTransform));
+    for (int i = 0; i < 4; i++)
+        texels[i] = modelTransform[i];
+    for (int i = 0; i < 3; i++)
+        texels[4 + i] = glm::vec4(glm::vec3(normalMatrix[i]), 0.0f);
+}
+
+void VisibilityBuffer::UpdateTransforms(const std::vector<SceneObject>& objects) {
+    auto buffer = m_drawData->GetBuffer();
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer->Get());
+    for (size_t i = 0; i < m_objects.size(); i++) {
+        auto& modelTransform = objects[m_objectIndices[i]].modelTransform;
+        if (m_objects[i].modelTransform == modelTransform)
+            continue;
+        m_objects[i].modelTransform = modelTransform;
+        glm::vec4 texels[7];
+        PackTransform(modelTransform, texels);
+        glBufferSubData(GL_TEXTURE_BUFFER, i * DRAW_DATA_TEXELS * sizeof(glm::vec4),
+            sizeof(texels), texels);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void VisibilityBuffer::SetToProgram(const Program* program, int textureUnit) const {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    m_vertexData->Bind();
+    program->SetUniform("vertexData", textureUnit++);
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    m_indexData->Bind();
+    program->SetUniform("indexData", textureUnit++);
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    m_drawData->Bind();
+    program->SetUniform("drawData", textureUnit++);
+    program->SetUniform("vertexStride", (int)(sizeof(Vertex) / sizeof(float)));
+
+    for (size_t i = 0; i < m_materials.size(); i++) {
+        auto& material = m_materials[i];
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        if (material && material->diffuse)
+            material->diffuse->Bind();
+        else
+            m_defaultTexture->Bind();
+        program->SetUniform(fmt::format("materialDiffuse[{}]", i), textureUnit++);
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        if (material && material->specular)
+            material->specular->Bind();
+        else
+            m_defaultTexture->Bind();
+        program->SetUniform(fmt::format("materialSpecular[{}]", i), textureUnit++);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+bool VisibilityBuffer::Init(const std::vector<SceneObject>& objects) {
+    const int maxDrawCount = (1 << (32 - TRIANGLE_ID_BITS)) - 1;
+    const size_t maxTriangleCount = (size_t)1 << TRIANGLE_ID_BITS;
+
+    // every mesh is stored once, draws refer to it by base vertex / first index
+    std::vector<const Mesh*> meshes;
+    std::vector<uint32_t> meshBaseVertices;
+    std::vector<uint32_t> meshFirstIndices;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    std::vector<glm::vec4> drawData;
+    for (size_t objectIndex = 0; objectIndex < objects.size(); objectIndex++) {
+        auto& object = objects[objectIndex];
+        if (!object.mesh || object.mesh->GetPrimitiveType() != GL_TRIANGLES)
+            continue;
+        if ((int)m_objects.size() >= maxDrawCount) {
+            SPDLOG_ERROR("too many draws for visibility buffer: {}", objects.size());
+            return false;
+        }
+        if (object.mesh->GetIndexBuffer()->GetCount() / 3 > maxTriangleCount) {
+            SPDLOG_ERROR("too many triangles in a visibility buffer draw: {}",
+                object.mesh->GetIndexBuffer()->GetCount() / 3);
+            return false;
+        }
+
+        size_t meshIndex = std::find(meshes.begin(), meshes.end(), object.mesh) - meshes.begin();
+        if (meshIndex == meshes.size()) {
+            meshes.push_back(object.mesh);
+            meshBaseVertices.push_back((uint32_t)vertexCount);
+            meshFirstIndices.push_back((uint32_t)indexCount);
+            vertexCount += object.mesh->GetVertexBuffer()->GetCount();
+            indexCount += object.mesh->GetIndexBuffer()->GetCount();
+        }
+
+        size_t materialSlot = std::find(m_materials.begin(), m_materials.end(),
+            object.material) - m_materials.begin();
+        if (materialSlot == m_materials.size()) {
+            if ((int)m_materials.size() < MAX_MATERIAL_COUNT) {
+                m_materials.push_back(object.material);
+            }
+            else {
+                SPDLOG_ERROR("visibility buffer supports up to {} materials", MAX_MATERIAL_COUNT);
+                materialSlot = 0;
+            }
+        }
+
+        // model matrix, normal matrix, then (first index, base vertex, material)
+        drawData.resize(drawData.size() + DRAW_DATA_TEXELS);
+        PackTransform(object.modelTransform, &drawData[drawData.size() - DRAW_DATA_TEXELS]);
+        glm::vec4 info(0.0f, 0.0f, (float)materialSlot, 0.0f);
+        memcpy(&info.x, &meshFirstIndices[meshIndex], sizeof(uint32_t));
+        memcpy(&info.y, &meshBaseVertices[meshIndex], sizeof(uint32_t));
+        drawData.back() = info;
+
+        m_objects.push_back(object);
+        m_objectIndices.push_back(objectIndex);
+    }
+    if (m_objects.empty()) {
+        SPDLOG_ERROR("no triangle mesh for visibility buffer");
+        return false;
+    }
+
+    int maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    size_t vertexFloatCount = vertexCount * sizeof(Vertex) / sizeof(float);
+    if (vertexFloatCount > (size_t)maxTexels || indexCount > (size_t)maxTexels) {
+        SPDLOG_ERROR("scene exceeds max texture buffer size: {}", maxTexels);
+        return false;
+    }
+
+    // concatenate the mesh buffers on the gpu
+    auto vertexBuffer = Buffer::CreateWithData(GL_TEXTURE_BUFFER, GL_STATIC_DRAW,
+        nullptr, sizeof(Vertex), vertexCount);
+    auto indexBuffer = Buffer::CreateWithData(GL_TEXTURE_BUFFER, GL_STATIC_DRAW,
+        nullptr, sizeof(uint32_t), indexCount);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        auto CopyBuffer = [](const Buffer* src, const Buffer* dst, size_t dstOffset) {
+            glBindBuffer(GL_COPY_READ_BUFFER, src->Get());
+            glBindBuffer(GL_COPY_WRITE_BUFFER, dst->Get());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                0, dstOffset * src->GetStride(), src->GetCount() * src->GetStride());
+        };
+        CopyBuffer(meshes[i]->GetVertexBuffer().get(), vertexBuffer.get(), meshBaseVertices[i]);
+        CopyBuffer(meshes[i]->GetIndexBuffer().get(), indexBuffer.get(), meshFirstIndices[i]);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_vertexData = BufferTexture::Create(std::move(vertexBuffer), GL_R32F);
+    m_indexData = BufferTexture::Create(std::move(indexBuffer), GL_R32UI);
+    m_drawData = BufferTexture::Create(Buffer::CreateWithData(GL_TEXTURE_BUFFER,
+        GL_DYNAMIC_DRAW, drawData.data(), sizeof(glm::vec4), drawData.size()),
+        GL_RGBA32F);
+    m_defaultTexture = Texture::CreateFromImage(
+        Image::CreateSingleColorImage(1, 1, glm::vec4(1.0f)).get());
+
+    SPDLOG_INFO("visibility buffer: {} draws, {} meshes, {} materials",
+        m_objects.size(), meshes.size(), m_materials.size());
+    return true;
+}
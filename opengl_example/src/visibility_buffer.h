@@ -0,0 +1,48 @@
+#ifndef __VISIBILITY_BUFFER_H__
+#define __VISIBILITY_BUFFER_H__
+
+#include "common.h"
+#include "mesh.h"
+#include "texture.h"
+#include "program.h"
+
+// scene geometry packed into buffer textures, so a full screen pass can
+// fetch any triangle by the (draw id, triangle id) in the visibility target
+CLASS_PTR(VisibilityBuffer)
+class VisibilityBuffer {
+public:
+    // the resolve pass has one diffuse / specular sampler pair per material
+    static constexpr int MAX_MATERIAL_COUNT = 6;
+    // must match visibility.glsl
+    static constexpr int TRIANGLE_ID_BITS = 22;
+    // must match visibility_resolve.fs
+    static constexpr int DRAW_DATA_TEXELS = 8;
+
+    static VisibilityBufferUPtr Create(const std::vector<SceneObject>& objects);
+
+    int GetDrawCount() const { return (int)m_objects.size(); }
+    int GetMaterialCount() const { return (int)m_materials.size(); }
+
+    // rasterize the draw / triangle id of every object
+    void Draw(const glm::mat4& viewProjection, const Program* program) const;
+    // bind the packed geometry and material textures from textureUnit on
+    void SetToProgram(const Program* program, int textureUnit) const;
+    // re-upload the matrices of draws that moved, objects is the list
+    // the buffer was created from
+    void UpdateTransforms(const std::vector<SceneObject>& objects);
+
+private:
+    VisibilityBuffer() {}
+    bool Init(const std::vector<SceneObject>& objects);
+
+    std::vector<SceneObject> m_objects;
+    // index in the list passed to Create() of every draw
+    std::vector<size_t> m_objectIndices;
+    std::vector<MaterialPtr> m_materials;
+    TexturePtr m_defaultTexture;
+    BufferTextureUPtr m_vertexData;
+    BufferTextureUPtr m_indexData;
+    BufferTextureUPtr m_drawData;
+};
+
+#endif // __VISIBILITY_BUFFER_H__